@@ -59,6 +59,45 @@ class BigLevel : public Level
   }
 };
 
+// Benchmark for partitions that have to deal with objects of very different sizes. Cubes
+// range from 0.01 (debris) to 100 (level geometry), with more of them the smaller they are.
+class MixedScaleLevel : public Level
+{
+  void Load(Application* application) override
+  {
+    const size_t scaleCount = 5;
+    float scales[scaleCount] = {100.0f, 10.0f, 1.0f, 0.1f, 0.01f};
+    size_t counts[scaleCount] = {2, 20, 200, 1000, 1000};
+
+    // A fixed linear congruential generator so every run places the objects the same way
+    unsigned int seed = 12345;
+    auto random = [&seed](float min, float max)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      return min + (max - min) * ((seed >> 8) / 16777216.0f);
+    };
+
+    size_t index = 0;
+    for(size_t i = 0; i < scaleCount; ++i)
+    {
+      for(size_t j = 0; j < counts[i]; ++j)
+      {
+        // Keep everything inside a 100 unit region so the small objects land on and in the big ones
+        Vector3 translation(random(-50, 50), random(-50, 50), random(-50, 50));
+        std::string objName = "Cube" + std::to_string(index++);
+        GameObject* gameObject = application->CreateObject(objName, application->mMeshes[0], Vector3(scales[i]), Quaternion::cIdentity, translation);
+        // The two biggest sizes are the level geometry which never moves
+        gameObject->has(Model)->mStatic = (scales[i] >= 10.0f);
+      }
+    }
+  }
+
+  std::string GetName() const override
+  {
+    return "MixedScaleLevel";
+  }
+};
+
 Statistics::Statistics()
 {
   mFps = 1 / 60.0f;
@@ -69,11 +108,15 @@ void Statistics::Clear()
 {
   mAabbAabbTests = 0;
   mRayAabbTests = 0;
+  mRayPacketAabbTests = 0;
+  mWideAabbTests = 0;
   mSphereSphereTests = 0;
+  mSphereAabbTests = 0;
   mRaySphereTests = 0;
   mPlaneSphereTests = 0;
   mPlaneAabbTests = 0;
   mSelfCollisionsCount = 0;
+  mBroadphaseSahCost = 0;
 
   mRayPlaneTests = 0;
   mRayTriangleTests = 0;
@@ -81,6 +124,11 @@ void Statistics::Clear()
   mFrustumTriangleTests = 0;
   mFrustumSphereTests = 0;
   mFrustumAabbTests = 0;
+
+#if SPATIAL_PARTITION_STATISTICS
+  for(int i = 0; i <= SpatialPartitionTypes::Unknown; ++i)
+    mPartitionStatistics[i].Clear();
+#endif
 }
 
 void Statistics::DisplayProperties(TwBar* bar)
@@ -90,6 +138,8 @@ void Statistics::DisplayProperties(TwBar* bar)
   TwAddVarRO(bar, "RayPlaneTests", TW_TYPE_INT32, &mRayPlaneTests, "");
   TwAddVarRO(bar, "RayTriangleTests", TW_TYPE_INT32, &mRayTriangleTests, "");
   TwAddVarRO(bar, "RayAabbTests", TW_TYPE_INT32, &mRayAabbTests, "");
+  TwAddVarRO(bar, "RayPacketAabbTests", TW_TYPE_INT32, &mRayPacketAabbTests, "");
+  TwAddVarRO(bar, "WideAabbTests", TW_TYPE_INT32, &mWideAabbTests, "");
   TwAddVarRO(bar, "RaySphereTests", TW_TYPE_INT32, &mRaySphereTests, "");
   TwAddVarRO(bar, "PlaneTriangleTests", TW_TYPE_INT32, &mPlaneTriangleTests, "");
   TwAddVarRO(bar, "PlaneSphereTests", TW_TYPE_INT32, &mPlaneSphereTests, "");
@@ -99,12 +149,56 @@ void Statistics::DisplayProperties(TwBar* bar)
   TwAddVarRO(bar, "FrustumAabbTests", TW_TYPE_INT32, &mFrustumAabbTests, "");
   TwAddVarRO(bar, "AabbAabbTests", TW_TYPE_INT32, &mAabbAabbTests, "");
   TwAddVarRO(bar, "SphereSphereTests", TW_TYPE_INT32, &mSphereSphereTests, "");
+  TwAddVarRO(bar, "SphereAabbTests", TW_TYPE_INT32, &mSphereAabbTests, "");
   TwAddVarRO(bar, "SelfCollisions", TW_TYPE_INT32, &mSelfCollisionsCount, "");
+  TwAddVarRO(bar, "BroadphaseSahCost", TW_TYPE_FLOAT, &mBroadphaseSahCost, "");
+
+#if SPATIAL_PARTITION_STATISTICS
+  // One closed group per partition type with each kind of query's counters
+  for(int i = 0; i < SpatialPartitionTypes::Unknown; ++i)
+  {
+    std::string typeName = SpatialPartitionTypes::Names[i];
+    std::string group = " group=" + typeName;
+    for(int j = 0; j < QueryStatisticsTypes::Count; ++j)
+    {
+      QueryStatistics& query = mPartitionStatistics[i].mQueries[j];
+      std::string name = typeName + "." + QueryStatisticsTypes::Names[j];
+      std::string label = std::string(" label=") + QueryStatisticsTypes::Names[j];
+      TwAddVarRO(bar, (name + ".Queries").c_str(), TW_TYPE_INT32, &query.mQueries, (label + "Queries" + group).c_str());
+      TwAddVarRO(bar, (name + ".NodesVisited").c_str(), TW_TYPE_INT32, &query.mNodesVisited, (label + "NodesVisited" + group).c_str());
+      TwAddVarRO(bar, (name + ".LeavesVisited").c_str(), TW_TYPE_INT32, &query.mLeavesVisited, (label + "LeavesVisited" + group).c_str());
+      TwAddVarRO(bar, (name + ".MaxStackDepth").c_str(), TW_TYPE_INT32, &query.mMaxStackDepth, (label + "MaxStackDepth" + group).c_str());
+      TwAddVarRO(bar, (name + ".Results").c_str(), TW_TYPE_INT32, &query.mResults, (label + "Results" + group).c_str());
+    }
+    TwDefine((" Statistics/" + typeName + " opened=false").c_str());
+  }
+#endif
 }
 
 //-----------------------------------------------------------------------------
 Statistics Application::mStatistics = Statistics();
 
+// Keys live on the models so batched broadphase calls copy them into a contiguous array and back.
+static void GatherBroadphaseData(const std::vector<Model*>& models, std::vector<SpatialPartitionKey>& keys, std::vector<SpatialPartitionData>& data)
+{
+  keys.resize(models.size());
+  data.resize(models.size());
+  for(size_t i = 0; i < models.size(); ++i)
+  {
+    Model* model = models[i];
+    keys[i] = model->mSpatialPartitionKey;
+    data[i].mAabb = model->mAabb;
+    data[i].mBoundingSphere = model->mBoundingSphere;
+    data[i].mClientData = model;
+  }
+}
+
+static void ScatterBroadphaseKeys(const std::vector<Model*>& models, const std::vector<SpatialPartitionKey>& keys)
+{
+  for(size_t i = 0; i < models.size(); ++i)
+    models[i]->mSpatialPartitionKey = keys[i];
+}
+
 Application::Application()
 {
   mAssignmentNumber = 0;
@@ -118,18 +212,29 @@ Application::Application()
   mMouseDown = false;
   mDynamicDebugDrawLevel = 0;
   mDebuggingIndex = -1;
+  mPairCacheMaxIterations = mMaxIterations;
+  mPairCacheDebuggingIndex = mDebuggingIndex;
   mRefineCasts = false;
   mDebugDraw = true;
   mDrawGjk = false;
   mRunGjk = false;
   mBoundSphereType = BoundingSphereType::Centroid;
   mFrustumCull = true;
+  mRefitBroadphase = false;
+  mTreeRotations = false;
+  mRotationBudget = 0;
+  mRayBenchmark.mRayCount = 100000;
+  mRayBenchmark.mBlockedCount = 0;
+  mRayBenchmark.mCastRayTime = 0;
+  mRayBenchmark.mCastRayAnyTime = 0;
 
   mGizmos.push_back(new TranslationGizmo());
   mActiveGizmo = mGizmos[0];
   
 
   mDynamicBroadphase = new NSquaredSpatialPartition();
+  mStaticBroadphase = new WideBvh();
+  mStaticBroadphaseDirty = false;
 
   mSelectionBar = TwNewBar("Selection");
   TwDefine(" Selection refresh = 0.01 size='200 255' position='0 346'");
@@ -157,7 +262,7 @@ Application::Application()
   // Bind misc. tweakables (these are auto-changed when the assignment number is changed but can be further tweaked if desired)
   const char* miscPropertiesGroup = "group=MiscProperties";
   // Bind what spatial partion is being used
-  TwType spatialPartitionType = TwDefineEnumFromString("SpatialPartitionType", "NSquared,NSquaredSphere,NSquaredAabb,DynamicAabbTree");
+  TwType spatialPartitionType = TwDefineEnumFromString("SpatialPartitionType", "NSquared,NSquaredSphere,DynamicAabbTree,LinearBvh,SweepAndPrune,HashGrid,HierarchicalHashGrid,LooseOctree,WideBvh");
   BindPropertyInGroup(mBar, Application, BroadphaseType, int, spatialPartitionType, miscPropertiesGroup);
   // Bind what method of bounding sphere computation is used
   mBoundingSphereTypeEnum = TwDefineEnumFromString("BoundingSphereType", "Centroid,Ritter,PCA");
@@ -169,6 +274,9 @@ Application::Application()
   TwAddVarRW(mBar, "MaxIterations", TW_TYPE_INT32, &mMaxIterations, miscPropertiesGroup);
   TwAddVarRW(mBar, "FrustumCulling", TW_TYPE_BOOLCPP, &mFrustumCull, miscPropertiesGroup);
   TwAddVarRW(mBar, "Gjk", TW_TYPE_BOOLCPP, &mRunGjk, miscPropertiesGroup);
+  TwAddVarRW(mBar, "RefitBroadphase", TW_TYPE_BOOLCPP, &mRefitBroadphase, miscPropertiesGroup);
+  TwAddVarRW(mBar, "TreeRotations", TW_TYPE_BOOLCPP, &mTreeRotations, miscPropertiesGroup);
+  TwAddVarRW(mBar, "RotationBudget", TW_TYPE_INT32, &mRotationBudget, miscPropertiesGroup);
   // Put all of these properties under a group that is closed by default
   TwDefine("Application/MiscProperties label=MiscProperties opened=false");
 
@@ -182,12 +290,21 @@ Application::Application()
 
   BindMethod(mBar, Application, "CreateCube", OnCreateCube, "");
 
+  const char* rayBenchmarkGroup = "group=RayBenchmark";
+  BindMethod(mBar, Application, "RunRayBenchmark", OnRayBenchmark, rayBenchmarkGroup);
+  TwAddVarRW(mBar, "RayCount", TW_TYPE_INT32, &mRayBenchmark.mRayCount, rayBenchmarkGroup);
+  TwAddVarRO(mBar, "BlockedCount", TW_TYPE_INT32, &mRayBenchmark.mBlockedCount, rayBenchmarkGroup);
+  TwAddVarRO(mBar, "CastRayTime", TW_TYPE_FLOAT, &mRayBenchmark.mCastRayTime, (std::string(rayBenchmarkGroup) + " label='CastRay(ms)'").c_str());
+  TwAddVarRO(mBar, "CastRayAnyTime", TW_TYPE_FLOAT, &mRayBenchmark.mCastRayAnyTime, (std::string(rayBenchmarkGroup) + " label='CastRayAny(ms)'").c_str());
+  TwDefine("Application/RayBenchmark label=RayBenchmark opened=false");
+
   mStatistics.DisplayProperties(mStatisticsBar);
 
   LoadMeshes(); 
 
   mLevels.push_back(new Level1());
   mLevels.push_back(new BigLevel());
+  mLevels.push_back(new MixedScaleLevel());
 
   // Add all of the unit test levels
   for(size_t i = 0; i < mTestFns.size(); ++i)
@@ -215,6 +332,7 @@ Application::Application()
 Application::~Application()
 {
   delete mDynamicBroadphase;
+  delete mStaticBroadphase;
   for(size_t i = 0; i < mLevels.size(); ++i)
     delete mLevels[i];
   for(size_t i = 0; i < mGameObjects.size(); ++i)
@@ -457,6 +575,7 @@ void Application::Update(float frameTime)
     GameObject* gameObject = mGameObjects[i];
     gameObject->Update(frameTime);
   }
+  FlushBroadphaseChanges();
 
   if (mDragging)
   {
@@ -493,46 +612,46 @@ void Application::Update(float frameTime)
       model->mOverlap = 0;
   }
 
-  QueryResults results;
-  mDynamicBroadphase->SelfQuery(results);
-
-  for(size_t i = 0; i < results.mResults.size(); ++i)
+  // Refit every object that moved this frame in one pass and spend the rotation budget before querying
+  if(mDynamicBroadphase->mType == SpatialPartitionTypes::AabbTree)
   {
-    for(size_t j = i + 1; j < results.mResults.size(); ++j)
-    {
-      QueryResult& r0 = results.mResults[i];
-      QueryResult& r1 = results.mResults[j];
-
-      if((r0.mClientData0 == r1.mClientData0 && r0.mClientData1 == r1.mClientData1) ||
-         (r0.mClientData0 == r1.mClientData1 && r0.mClientData1 == r1.mClientData0))
-         __debugbreak();
-    }
+    DynamicAabbTree* tree = static_cast<DynamicAabbTree*>(mDynamicBroadphase);
+    tree->SetRefitMode(mRefitBroadphase);
+    tree->mUseRotations = mTreeRotations;
+    tree->RefitDirty();
+    tree->Optimize(mRotationBudget);
+    mStatistics.mBroadphaseSahCost = tree->GetSahCost();
   }
 
+  QueryResults results;
+  QueryBroadphasePairs(results);
 
-  mStatistics.mSelfCollisionsCount = results.mResults.size();
-  for(size_t i = 0; i < results.mResults.size(); ++i)
+  // A partition should never report the same pair twice
+  size_t duplicatePairs = mPairCache.Update(results);
+  ErrorIf(duplicatePairs != 0, "The broadphase reported %d pairs more than once", (int)duplicatePairs);
+
+  // Cached gjk results are only valid for the settings they were computed with
+  if(mMaxIterations != mPairCacheMaxIterations || mDebuggingIndex != mPairCacheDebuggingIndex)
   {
-    QueryResult& result = results.mResults[i];
-    Model* model0 = static_cast<Model*>(result.mClientData0);
-    Model* model1 = static_cast<Model*>(result.mClientData1);
+    mPairCache.ClearUserData();
+    mPairCacheMaxIterations = mMaxIterations;
+    mPairCacheDebuggingIndex = mDebuggingIndex;
+  }
 
-    model0->mOverlap = 1;
-    model1->mOverlap = 1;
+  mStatistics.mSelfCollisionsCount = results.mResults.size();
+  for(size_t i = 0; i < mPairCache.mBegan.size(); ++i)
+    RunNarrowPhase(mPairCache.mPairs[mPairCache.mBegan[i]], false);
 
-    ModelSupportShape shape0;
-    shape0.mModel = model0;
-    ModelSupportShape shape1;
-    shape1.mModel = model1;
-    
-    Gjk gjk;
-    Gjk::CsoPoint closestPoints;
-    float epsilon = 0.001f;
-    if(mRunGjk && gjk.Intersect(&shape0, &shape1, mMaxIterations, closestPoints, epsilon, mDebuggingIndex, mDrawGjk))
-    {
-      model0->mOverlap = model1->mOverlap = 2;
-    }
+  // Persistent pairs only have to be tested again if one of their models moved
+  std::sort(mMovedModels.begin(), mMovedModels.end());
+  for(size_t i = 0; i < mPairCache.mPersisted.size(); ++i)
+  {
+    PairCache::Pair& pair = mPairCache.mPairs[mPairCache.mPersisted[i]];
+    bool moved = std::binary_search(mMovedModels.begin(), mMovedModels.end(), static_cast<Model*>(pair.mResult.mClientData0)) ||
+                 std::binary_search(mMovedModels.begin(), mMovedModels.end(), static_cast<Model*>(pair.mResult.mClientData1));
+    RunNarrowPhase(pair, !moved);
   }
+  mMovedModels.clear();
 
   TwRefreshBar(mBar);
   int value = TwRefreshBar(mStatisticsBar);
@@ -600,14 +719,23 @@ int Application::GetBroadphaseType()
 
 void Application::SetBroadphaseType(const int& type)
 {
+  FlushBroadphaseChanges();
+
+  // Only the dynamic broadphase changes type
+  std::vector<Model*> models;
   for(size_t i = 0; i < mGameObjects.size(); ++i)
   {
     GameObject* gameObject = mGameObjects[i];
     Model* model = gameObject->has(Model);
-    if(model != nullptr)
-      mDynamicBroadphase->RemoveData(model->mSpatialPartitionKey);
+    if(model != nullptr && !model->mStatic)
+      models.push_back(model);
   }
 
+  std::vector<SpatialPartitionKey> keys;
+  std::vector<SpatialPartitionData> data;
+  GatherBroadphaseData(models, keys, data);
+  mDynamicBroadphase->RemoveBatch(keys.data(), keys.size());
+
   delete mDynamicBroadphase;
   
   if(type == SpatialPartitionTypes::NSquared)
@@ -616,20 +744,21 @@ void Application::SetBroadphaseType(const int& type)
     mDynamicBroadphase = new BoundingSphereSpatialPartition();
   else if(type == SpatialPartitionTypes::AabbTree)
     mDynamicBroadphase = new DynamicAabbTree();
-
-  for(size_t i = 0; i < mGameObjects.size(); ++i)
-  {
-    GameObject* gameObject = mGameObjects[i];
-    Model* model = gameObject->has(Model);
-    if(model != nullptr)
-    {
-      SpatialPartitionData data;
-      data.mAabb = model->mAabb;
-      data.mBoundingSphere = model->mBoundingSphere;
-      data.mClientData = model;
-      mDynamicBroadphase->InsertData(model->mSpatialPartitionKey, data);
-    }
-  }
+  else if(type == SpatialPartitionTypes::LinearBvh)
+    mDynamicBroadphase = new LinearBvh();
+  else if(type == SpatialPartitionTypes::SweepAndPrune)
+    mDynamicBroadphase = new SweepAndPrune();
+  else if(type == SpatialPartitionTypes::HashGrid)
+    mDynamicBroadphase = new HashGridSpatialPartition();
+  else if(type == SpatialPartitionTypes::HierarchicalHashGrid)
+    mDynamicBroadphase = new HierarchicalHashGrid();
+  else if(type == SpatialPartitionTypes::LooseOctree)
+    mDynamicBroadphase = new LooseOctree();
+  else if(type == SpatialPartitionTypes::WideBvh)
+    mDynamicBroadphase = new WideBvh();
+
+  mDynamicBroadphase->InsertBatch(keys.data(), data.data(), keys.size());
+  ScatterBroadphaseKeys(models, keys);
 }
 
 int Application::GetBoundingSphereType()
@@ -684,6 +813,7 @@ void Application::Draw()
   //glRotatef(mRotation, 0.0f, 1.0f, 0.0f);
   //glRotatef(mRotationX, 1.0f, 0.0f, 0.0f);
 
+  FlushBroadphaseChanges();
   if(mFrustumCull)
   {
     Frustum worldFrustum = BuildFrustum(Vector2(0, 0), mSize - Vector2(1, 1));
@@ -691,6 +821,7 @@ void Application::Draw()
 
     CastResults results;
     mDynamicBroadphase->CastFrustum(worldFrustum, results);
+    mStaticBroadphase->CastFrustum(worldFrustum, results);
     for(size_t i = 0; i < results.mResults.size(); ++i)
     {
       Model* model = static_cast<Model*>(results.mResults[i].mClientData);
@@ -720,6 +851,7 @@ void Application::Draw()
   {
     Matrix4 transform = Matrix4::cIdentity;
     mDynamicBroadphase->DebugDraw(mDynamicDebugDrawLevel, transform);
+    mStaticBroadphase->DebugDraw(mDynamicDebugDrawLevel, transform, Vector4(0.5f, 0.5f, 0.5f, 1));
   }
 
   glDisable (GL_LIGHTING);
@@ -792,11 +924,7 @@ void Application::AddGameObject(GameObject* gameObject)
     model->UpdateAabb();
     model->UpdateBoundingSphere();
 
-    SpatialPartitionData data;
-    data.mAabb = model->mAabb;
-    data.mBoundingSphere = model->mBoundingSphere;
-    data.mClientData = model;
-    mDynamicBroadphase->InsertData(model->mSpatialPartitionKey, data);
+    mPendingInserts.push_back(model);
   }
 }
 
@@ -804,13 +932,7 @@ void Application::UpdateGameObject(GameObject* gameObject)
 {
   Model* model = gameObject->has(Model);
   if(model != nullptr)
-  {
-    SpatialPartitionData data;
-    data.mAabb = model->mAabb;
-    data.mBoundingSphere = model->mBoundingSphere;
-    data.mClientData = model;
-    mDynamicBroadphase->UpdateData(model->mSpatialPartitionKey, data);
-  }
+    mPendingUpdates.push_back(model);
 }
 
 void Application::DestroyGameObject(GameObject* gameObject)
@@ -829,13 +951,128 @@ void Application::DestroyGameObject(GameObject* gameObject)
     }
   }
 
+  FlushBroadphaseChanges();
   Model* model = gameObject->has(Model);
   if(model != nullptr)
-    mDynamicBroadphase->RemoveData(model->mSpatialPartitionKey);
+  {
+    if(model->mStatic)
+    {
+      mStaticModels.erase(std::remove(mStaticModels.begin(), mStaticModels.end(), model), mStaticModels.end());
+      mStaticBroadphaseDirty = true;
+    }
+    else
+      mDynamicBroadphase->RemoveData(model->mSpatialPartitionKey);
+    mPairCache.RemoveClientData(model);
+    mMovedModels.erase(std::remove(mMovedModels.begin(), mMovedModels.end(), model), mMovedModels.end());
+  }
 
   delete gameObject;
 }
 
+void Application::FlushBroadphaseChanges()
+{
+  std::vector<SpatialPartitionKey> keys;
+  std::vector<SpatialPartitionData> data;
+  if(!mPendingInserts.empty())
+  {
+    // Static models just join the static set, the rest are inserted as one batch
+    std::vector<Model*>::iterator staticBegin = std::stable_partition(mPendingInserts.begin(), mPendingInserts.end(), [](Model* model) { return !model->mStatic; });
+    if(staticBegin != mPendingInserts.end())
+    {
+      mStaticModels.insert(mStaticModels.end(), staticBegin, mPendingInserts.end());
+      mStaticBroadphaseDirty = true;
+      mPendingInserts.erase(staticBegin, mPendingInserts.end());
+    }
+
+    GatherBroadphaseData(mPendingInserts, keys, data);
+    mDynamicBroadphase->InsertBatch(keys.data(), data.data(), keys.size());
+    ScatterBroadphaseKeys(mPendingInserts, keys);
+    mPendingInserts.clear();
+  }
+
+  if(!mPendingUpdates.empty())
+  {
+    // An object can be moved several times in a frame but only its latest bounds matter
+    std::sort(mPendingUpdates.begin(), mPendingUpdates.end());
+    mPendingUpdates.erase(std::unique(mPendingUpdates.begin(), mPendingUpdates.end()), mPendingUpdates.end());
+    mMovedModels.insert(mMovedModels.end(), mPendingUpdates.begin(), mPendingUpdates.end());
+
+    // Moving a static model (e.g. with the gizmo) is rare enough to just rebuild the static tree
+    std::vector<Model*>::iterator staticBegin = std::stable_partition(mPendingUpdates.begin(), mPendingUpdates.end(), [](Model* model) { return !model->mStatic; });
+    if(staticBegin != mPendingUpdates.end())
+    {
+      mStaticBroadphaseDirty = true;
+      mPendingUpdates.erase(staticBegin, mPendingUpdates.end());
+    }
+
+    GatherBroadphaseData(mPendingUpdates, keys, data);
+    mDynamicBroadphase->UpdateBatch(keys.data(), data.data(), keys.size());
+    ScatterBroadphaseKeys(mPendingUpdates, keys);
+    mPendingUpdates.clear();
+  }
+
+  if(mStaticBroadphaseDirty)
+    RebuildStaticBroadphase();
+}
+
+void Application::RebuildStaticBroadphase()
+{
+  std::vector<SpatialPartitionKey> keys;
+  std::vector<SpatialPartitionData> data;
+  GatherBroadphaseData(mStaticModels, keys, data);
+  mStaticBroadphase->Build(data.data(), data.size(), keys.data());
+  ScatterBroadphaseKeys(mStaticModels, keys);
+  mStaticBroadphaseDirty = false;
+}
+
+void Application::QueryBroadphasePairs(QueryResults& results)
+{
+  mDynamicBroadphase->SelfQuery(results);
+
+  // The order of a pair's client data matters to the pair cache, so re-add these in the
+  // same (sorted) order a SelfQuery reports them in
+  QueryResults staticResults;
+  QueryPartitions(*mDynamicBroadphase, *mStaticBroadphase, staticResults);
+  for(size_t i = 0; i < staticResults.mResults.size(); ++i)
+  {
+    const QueryResult& result = staticResults.mResults[i];
+    results.AddResult(QueryResult(result.mClientData0, result.mClientData1));
+  }
+}
+
+void Application::RunNarrowPhase(PairCache::Pair& pair, bool useCachedResult)
+{
+  Model* model0 = static_cast<Model*>(pair.mResult.mClientData0);
+  Model* model1 = static_cast<Model*>(pair.mResult.mClientData1);
+
+  model0->mOverlap = Math::Max(model0->mOverlap, 1);
+  model1->mOverlap = Math::Max(model1->mOverlap, 1);
+
+  if(!mRunGjk)
+  {
+    pair.mUserData = PairCache::cUnknownUserData;
+    return;
+  }
+
+  // Always run gjk while it's being drawn so the debug drawing doesn't disappear
+  if(!useCachedResult || mDrawGjk || pair.mUserData == PairCache::cUnknownUserData)
+  {
+    ModelSupportShape shape0;
+    shape0.mModel = model0;
+    ModelSupportShape shape1;
+    shape1.mModel = model1;
+
+    Gjk gjk;
+    Gjk::CsoPoint closestPoints;
+    float epsilon = 0.001f;
+    bool intersecting = gjk.Intersect(&shape0, &shape1, mMaxIterations, closestPoints, epsilon, mDebuggingIndex, mDrawGjk);
+    pair.mUserData = intersecting ? 1 : 0;
+  }
+
+  if(pair.mUserData == 1)
+    model0->mOverlap = model1->mOverlap = 2;
+}
+
 void Application::DisplayCastResult(GameObject* gameObject)
 {
   std::string name = gameObject->mName;
@@ -849,6 +1086,10 @@ void Application::DisplayCastResults(const Ray& worldRay, CastResults& results)
   TwRemoveAllVars(mSelectionBar);
   mActiveGizmo->Select(NULL);
 
+  // When refining, select the model that was actually clicked on (the closest refined hit)
+  // instead of just the first bounding box hit
+  Model* selected = nullptr;
+  float selectedTime = Math::PositiveMax();
   for(size_t i = 0; i < results.mResults.size(); ++i)
   {
     Model* model = static_cast<Model*>(results.mResults[i].mClientData);
@@ -858,16 +1099,21 @@ void Application::DisplayCastResults(const Ray& worldRay, CastResults& results)
       CastResult castInfo;
       if(model->CastRay(worldRay, castInfo) == false)
         continue;
+
+      if(castInfo.mTime < selectedTime)
+      {
+        selected = model;
+        selectedTime = castInfo.mTime;
+      }
     }
+    else if(selected == nullptr)
+      selected = model;
 
     DisplayCastResult(model->mOwner);
   }
 
-  if(!results.mResults.empty())
-  {
-    Model* model = static_cast<Model*>(results.mResults[0].mClientData);
-    mActiveGizmo->Select(model->mOwner);
-  }
+  if(selected != nullptr)
+    mActiveGizmo->Select(selected->mOwner);
 }
 
 void Application::DisplayCastResults(const Frustum& worldFrustum, CastResults& results)
@@ -892,7 +1138,9 @@ void Application::DisplayCastResults(const Frustum& worldFrustum, CastResults& r
 
 void Application::CastRay(Ray& worldRay, CastResults& results)
 {
+  FlushBroadphaseChanges();
   mDynamicBroadphase->CastRay(worldRay, results);
+  mStaticBroadphase->CastRay(worldRay, results);
 }
 
 void Application::CastRay(Ray& worldRay)
@@ -905,8 +1153,10 @@ void Application::CastRay(Ray& worldRay)
 
 void Application::CastFrustum(Frustum& worldFrustum)
 {
+  FlushBroadphaseChanges();
   CastResults results;
   mDynamicBroadphase->CastFrustum(worldFrustum, results);
+  mStaticBroadphase->CastFrustum(worldFrustum, results);
 
   worldFrustum.DebugDraw();
   DisplayCastResults(worldFrustum, results);
@@ -914,19 +1164,27 @@ void Application::CastFrustum(Frustum& worldFrustum)
 
 void Application::FindPotentialIntersections(GameObject* gameObject, std::vector<GameObject*>& hitObjects)
 {
-  QueryResults results;
-  mDynamicBroadphase->SelfQuery(results);
+  FlushBroadphaseChanges();
+  Model* model = gameObject->has(Model);
+  if(model == nullptr)
+    return;
+
+  // Query with the bounds the broadphase stores (e.g. a tree's fattened ones) so this finds the same
+  // objects that a SelfQuery would pair with this one. Static objects are never paired together.
+  SpatialPartition* ownBroadphase = model->mStatic ? mStaticBroadphase : mDynamicBroadphase;
+  SpatialPartitionData data;
+  data.mAabb = model->mAabb;
+  ownBroadphase->GetDataFromKey(model->mSpatialPartitionKey, data);
 
+  CastResults results;
+  mDynamicBroadphase->QueryAabb(data.mAabb, results);
+  if(!model->mStatic)
+    mStaticBroadphase->QueryAabb(data.mAabb, results);
   for(size_t i = 0; i < results.mResults.size(); ++i)
   {
-    QueryResult& result = results.mResults[i];
-    GameObject* obj0 = static_cast<Model*>(result.mClientData0)->mOwner;
-    GameObject* obj1 = static_cast<Model*>(result.mClientData1)->mOwner;
-
-    if(obj0 == gameObject)
-      hitObjects.push_back(obj1);
-    else if(obj1 == gameObject)
-      hitObjects.push_back(obj0);
+    Model* hitModel = static_cast<Model*>(results.mResults[i].mClientData);
+    if(hitModel != model)
+      hitObjects.push_back(hitModel->mOwner);
   }
 }
 
@@ -1180,6 +1438,68 @@ void Application::OnCreateCube()
   CreateObject(name, mMeshes[0], Vector3(1.0f), Math::Quaternion::cIdentity, Vector3(0, 0, 0));
 }
 
+void Application::OnRayBenchmark()
+{
+  FlushBroadphaseChanges();
+
+  Aabb bounds;
+  for(size_t i = 0; i < mGameObjects.size(); ++i)
+  {
+    Model* model = mGameObjects[i]->has(Model);
+    if(model != nullptr)
+      bounds = Aabb::Combine(bounds, model->mAabb);
+  }
+  if(bounds.mMin.x > bounds.mMax.x || mRayBenchmark.mRayCount <= 0)
+    return;
+
+  // Segments between random points in the level (the same ones every run). A segment's
+  // direction is its whole length so it's blocked by anything hit within t = 1.
+  unsigned int seed = 12345;
+  auto random = [&seed](float min, float max)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * ((seed >> 8) / 16777216.0f);
+  };
+  std::vector<Ray> rays(mRayBenchmark.mRayCount);
+  for(size_t i = 0; i < rays.size(); ++i)
+  {
+    Vector3 start(random(bounds.mMin.x, bounds.mMax.x), random(bounds.mMin.y, bounds.mMax.y), random(bounds.mMin.z, bounds.mMax.z));
+    Vector3 end(random(bounds.mMin.x, bounds.mMax.x), random(bounds.mMin.y, bounds.mMax.y), random(bounds.mMin.z, bounds.mMax.z));
+    rays[i].mStart = start;
+    rays[i].mDirection = end - start;
+  }
+
+  // Only the broadphases are compared (no refinement) so both versions do the same work per object
+  int castRayBlocked = 0;
+  clock_t startTime = clock();
+  for(size_t i = 0; i < rays.size(); ++i)
+  {
+    CastResults results;
+    mDynamicBroadphase->CastRay(rays[i], results);
+    mStaticBroadphase->CastRay(rays[i], results);
+    for(size_t j = 0; j < results.mResults.size(); ++j)
+    {
+      if(results.mResults[j].mTime <= 1.0f)
+      {
+        ++castRayBlocked;
+        break;
+      }
+    }
+  }
+  mRayBenchmark.mCastRayTime = 1000.0f * (clock() - startTime) / (float)CLOCKS_PER_SEC;
+
+  mRayBenchmark.mBlockedCount = 0;
+  startTime = clock();
+  for(size_t i = 0; i < rays.size(); ++i)
+  {
+    if(mDynamicBroadphase->CastRayAny(rays[i], 1.0f) || mStaticBroadphase->CastRayAny(rays[i], 1.0f))
+      ++mRayBenchmark.mBlockedCount;
+  }
+  mRayBenchmark.mCastRayAnyTime = 1000.0f * (clock() - startTime) / (float)CLOCKS_PER_SEC;
+
+  ErrorIf(castRayBlocked != mRayBenchmark.mBlockedCount, "CastRayAny disagrees with CastRay on %d segments", castRayBlocked - mRayBenchmark.mBlockedCount);
+}
+
 void Application::ChangeLevel(int levelIndex)
 {
   if(mActiveGizmo != NULL)
@@ -1187,15 +1507,27 @@ void Application::ChangeLevel(int levelIndex)
 
   TwRemoveAllVars(mSelectionBar);
 
+  FlushBroadphaseChanges();
+  std::vector<Model*> models;
   for(size_t i = 0; i < mGameObjects.size(); ++i)
   {
-    GameObject* obj = mGameObjects[i];
-    Model* model = obj->has(Model);
-    if(model != nullptr)
-      mDynamicBroadphase->RemoveData(model->mSpatialPartitionKey);
-    delete obj;
+    Model* model = mGameObjects[i]->has(Model);
+    if(model != nullptr && !model->mStatic)
+      models.push_back(model);
   }
+
+  std::vector<SpatialPartitionKey> keys;
+  std::vector<SpatialPartitionData> data;
+  GatherBroadphaseData(models, keys, data);
+  mDynamicBroadphase->RemoveBatch(keys.data(), keys.size());
+  mStaticModels.clear();
+  RebuildStaticBroadphase();
+
+  for(size_t i = 0; i < mGameObjects.size(); ++i)
+    delete mGameObjects[i];
   mGameObjects.clear();
+  mPairCache.Clear();
+  mMovedModels.clear();
 
 
   mCurrentLevelIndex = levelIndex;
@@ -14,6 +14,7 @@
 #include "Math/Utilities.hpp"
 #include "Model.hpp"
 #include "SpatialPartition.hpp"
+#include "PairCache.hpp"
 #include "Components.hpp"
 #include "Mesh.hpp"
 #include "Camera.hpp"
@@ -42,6 +43,10 @@ struct Statistics
   size_t mRayPlaneTests;
   size_t mRayTriangleTests;
   size_t mRayAabbTests;
+  // Aabb tests against a whole packet of rays at once (see RayPacket).
+  size_t mRayPacketAabbTests;
+  // Ray or aabb tests against all children of a wide bvh node at once (see WideBvh).
+  size_t mWideAabbTests;
   size_t mRaySphereTests;
   size_t mPlaneTriangleTests;
   size_t mPlaneSphereTests;
@@ -51,10 +56,21 @@ struct Statistics
   size_t mFrustumAabbTests;
   size_t mAabbAabbTests;
   size_t mSphereSphereTests;
+  size_t mSphereAabbTests;
 
   // The number of object pairs that made it through broad phase.
   // Basically how many pairs would normally go to narrow-phase (collision detection).
   size_t mSelfCollisionsCount;
+
+  // SAH cost of the broadphase tree (the average number of nodes a ray through the root visits).
+  // Zero for partitions that aren't trees.
+  float mBroadphaseSahCost;
+
+#if SPATIAL_PARTITION_STATISTICS
+  // Traversal counters of this frame's queries by the type of partition they ran on (only the trees
+  // count theirs, see QueryStatistics).
+  PartitionStatistics mPartitionStatistics[SpatialPartitionTypes::Unknown + 1];
+#endif
 };
 
 namespace BoundingSphereType
@@ -108,9 +124,21 @@ public:
   GameObject* CreateObject(const std::string& name, Mesh* mesh, const Vector3& scale, const Math::Quaternion& rotation, const Vector3& translation);
   GameObject* CreateEmptyObject(const std::string& name);
 
+  // Adding and updating objects only queues their broadphase changes. They're applied as one
+  // batch each by FlushBroadphaseChanges which is called before anything uses the broadphase.
+  // Static models (Model::mStatic) go to the static broadphase instead, which is rebuilt from
+  // scratch on the next flush whenever one of them is added, moved or destroyed.
   void AddGameObject(GameObject* gameObject);
   void UpdateGameObject(GameObject* gameObject);
   void DestroyGameObject(GameObject* gameObject);
+  void FlushBroadphaseChanges();
+  void RebuildStaticBroadphase();
+  // The broadphase pairs for this frame: dynamic vs. dynamic plus dynamic vs. static
+  // (static objects never have to be tested against each other).
+  void QueryBroadphasePairs(QueryResults& results);
+  // Runs gjk on a broadphase pair and marks the models' overlap. With useCachedResult the pair
+  // keeps its result from the last frame (if it has one) instead.
+  void RunNarrowPhase(PairCache::Pair& pair, bool useCachedResult);
 
   void DisplayCastResult(GameObject* gameObject);
   void DisplayCastResults(const Ray& worldRay, CastResults& results);
@@ -136,12 +164,28 @@ public:
   void OnMouseMove(int x, int y);
   void OnMouseScroll(int x, int y);
   void OnCreateCube();
+  // Casts the same set of random segments through the current level with the broadphases' CastRay
+  // and CastRayAny and records how long each took (see mRayBenchmark).
+  void OnRayBenchmark();
 
 private:
 public:
   std::vector<GameObject*> mGameObjects;
 
   SpatialPartition* mDynamicBroadphase;
+  // Bulk built tree over the static models (mStaticModels). It's never updated incrementally.
+  SpatialPartition* mStaticBroadphase;
+  std::vector<Model*> mStaticModels;
+  bool mStaticBroadphaseDirty;
+  // Models waiting to be inserted into/updated in the broadphase.
+  std::vector<Model*> mPendingInserts;
+  std::vector<Model*> mPendingUpdates;
+  // The broadphase pairs from the last frame's SelfQuery and the models that have moved since.
+  PairCache mPairCache;
+  std::vector<Model*> mMovedModels;
+  // The gjk settings the cached narrow phase results were computed with.
+  int mPairCacheMaxIterations;
+  int mPairCacheDebuggingIndex;
 
   // The ui that represents our application
   TwBar* mBar;
@@ -186,4 +230,20 @@ public:
 
   static Statistics mStatistics;
   bool mFrustumCull;
+  // Whether a DynamicAabbTree broadphase refits moved objects instead of re-inserting them.
+  bool mRefitBroadphase;
+  // Whether a DynamicAabbTree broadphase uses SAH rotations instead of avl balancing and
+  // how many of its nodes are considered for a rotation each frame.
+  bool mTreeRotations;
+  int mRotationBudget;
+
+  // The last OnRayBenchmark: how many segments were blocked and the time (ms) of each version.
+  struct RayBenchmark
+  {
+    int mRayCount;
+    int mBlockedCount;
+    float mCastRayTime;
+    float mCastRayAnyTime;
+  };
+  RayBenchmark mRayBenchmark;
 };
@@ -8,9 +8,1443 @@
 #include "SimpleNSquared.hpp"
 #include "UnitTests.hpp"
 #include "DynamicAabbTree.hpp"
+#include "FlatBvh.hpp"
+#include "HashGrid.hpp"
+#include "HierarchicalHashGrid.hpp"
+#include "LinearBvh.hpp"
+#include "LooseOctree.hpp"
+#include "PairCache.hpp"
+#include "ParallelSelfQuery.hpp"
+#include "PartitionQuery.hpp"
+#include "QuantizedBvh.hpp"
+#include "SweepAndPrune.hpp"
+#include "WideBvh.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+//-----------------------------------------------------------------------------Spatial Partition Test Helpers
+// A small lcg so the generated objects (and so the output) don't depend on the platform's rand.
+static float TestRandom(unsigned int& seed, float min, float max)
+{
+  seed = seed * 1664525u + 1013904223u;
+  return min + (max - min) * (static_cast<float>(seed >> 8) / 16777216.0f);
+}
+
+// An aabb with its center in [-worldHalfSize, worldHalfSize] and half extents in [0.1, maxHalfSize].
+static Aabb GenerateTestAabb(float worldHalfSize, float maxHalfSize, unsigned int& seed)
+{
+  Vector3 center, halfExtents;
+  for(int axis = 0; axis < 3; ++axis)
+    center[axis] = TestRandom(seed, -worldHalfSize, worldHalfSize);
+  for(int axis = 0; axis < 3; ++axis)
+    halfExtents[axis] = TestRandom(seed, 0.1f, maxHalfSize);
+  return Aabb::BuildFromCenterAndHalfExtents(center, halfExtents);
+}
+
+// Objects made with GenerateTestAabb. The client data is the object's index + 1 so it can be
+// printed (and stored by a FlatBvh).
+static void GenerateTestData(size_t count, float worldHalfSize, float maxHalfSize, unsigned int seed, std::vector<SpatialPartitionData>& data)
+{
+  data.resize(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    data[i].mAabb = GenerateTestAabb(worldHalfSize, maxHalfSize, seed);
+    data[i].mBoundingSphere = Sphere(data[i].mAabb.GetCenter(), Math::Length(data[i].mAabb.GetHalfSize()));
+    data[i].mClientData = reinterpret_cast<void*>(i + 1);
+  }
+}
+
+// A ray starting somewhere among the objects made by GenerateTestData, in any direction.
+static Ray GenerateTestRay(float worldHalfSize, unsigned int& seed)
+{
+  Ray ray;
+  for(int axis = 0; axis < 3; ++axis)
+    ray.mStart[axis] = TestRandom(seed, -worldHalfSize, worldHalfSize);
+  for(int axis = 0; axis < 3; ++axis)
+    ray.mDirection[axis] = TestRandom(seed, -1.0f, 1.0f);
+  return ray;
+}
+
+// The same partitions Application::SetBroadphaseType makes, plus the midphase-only ones.
+static SpatialPartition* CreateTestPartition(SpatialPartitionTypes::Types type)
+{
+  if(type == SpatialPartitionTypes::NSquared)
+    return new NSquaredSpatialPartition();
+  else if(type == SpatialPartitionTypes::NSquaredSphere)
+    return new BoundingSphereSpatialPartition();
+  else if(type == SpatialPartitionTypes::AabbTree)
+    return new DynamicAabbTree();
+  else if(type == SpatialPartitionTypes::LinearBvh)
+    return new LinearBvh();
+  else if(type == SpatialPartitionTypes::SweepAndPrune)
+    return new SweepAndPrune();
+  else if(type == SpatialPartitionTypes::HashGrid)
+    return new HashGridSpatialPartition();
+  else if(type == SpatialPartitionTypes::HierarchicalHashGrid)
+    return new HierarchicalHashGrid();
+  else if(type == SpatialPartitionTypes::LooseOctree)
+    return new LooseOctree();
+  else if(type == SpatialPartitionTypes::WideBvh)
+    return new WideBvh();
+  else if(type == SpatialPartitionTypes::QuantizedBvh)
+    return new QuantizedBvh();
+  else if(type == SpatialPartitionTypes::FlatBvh)
+    return new FlatBvh();
+  return nullptr;
+}
+
+static void InsertTestData(SpatialPartition& spatialPartition, std::vector<SpatialPartitionData>& data)
+{
+  std::vector<SpatialPartitionKey> keys(data.size());
+  for(size_t i = 0; i < data.size(); ++i)
+    spatialPartition.InsertData(keys[i], data[i]);
+}
+
+static int GetTestId(void* clientData)
+{
+  return static_cast<int>(reinterpret_cast<size_t>(clientData));
+}
+
+static void PrintPartitionName(SpatialPartition& spatialPartition, FILE* file)
+{
+  if(file != NULL)
+    fprintf(file, "  Partition %s:\n", SpatialPartitionTypes::Names[spatialPartition.mType]);
+}
+
+// The objects (not internal nodes, which have no client data) of the partition.
+static void GetTestObjects(SpatialPartition& spatialPartition, std::vector<SpatialPartitionQueryData>& objects)
+{
+  std::vector<SpatialPartitionQueryData> data;
+  spatialPartition.FilloutData(data);
+  for(size_t i = 0; i < data.size(); ++i)
+  {
+    if(data[i].mClientData != nullptr)
+      objects.push_back(data[i]);
+  }
+}
+
+static void GetSortedSelfQuery(SpatialPartition& spatialPartition, std::vector<QueryResult>& pairs)
+{
+  QueryResults results;
+  spatialPartition.SelfQuery(results);
+  pairs = results.mResults;
+  std::sort(pairs.begin(), pairs.end());
+}
+
+// Every pair of the partition's objects whose bounds overlap, tested one pair at a time.
+static void GetBruteForceSelfQuery(SpatialPartition& spatialPartition, std::vector<QueryResult>& pairs)
+{
+  std::vector<SpatialPartitionQueryData> objects;
+  GetTestObjects(spatialPartition, objects);
+  for(size_t i = 0; i < objects.size(); ++i)
+  {
+    for(size_t j = i + 1; j < objects.size(); ++j)
+    {
+      const Aabb& aabb0 = objects[i].mAabb;
+      const Aabb& aabb1 = objects[j].mAabb;
+      if(AabbAabb(aabb0.mMin, aabb0.mMax, aabb1.mMin, aabb1.mMax))
+        pairs.push_back(QueryResult(objects[i].mClientData, objects[j].mClientData));
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+}
+
+//-----------------------------------------------------------------------------NSquared Comparison Helpers
+// A partition under test and an NSquaredSpatialPartition that get the same changes. The NSquared partition
+// returns every object it holds for every query, so filtering its results with the exact test gives what
+// the partition should have returned. The exact tests use the bounds the partition stores (trees fatten
+// them), and PrintObjects checks that those still contain each object's current bounds.
+struct PartitionComparison
+{
+  // Generates count objects (see GenerateTestData). Nothing is added to either partition yet.
+  PartitionComparison(SpatialPartition* spatialPartition, size_t count, float worldHalfSize, float maxHalfSize, unsigned int seed);
+  ~PartitionComparison();
+
+  // Adds every object with InsertData, or with Build when bulkBuild is set.
+  void Insert(bool bulkBuild);
+  // Moves roughly 40% of the active objects by up to moveDistance per axis (resizing one in eight of
+  // those), removes 5% and re-inserts 5% of the removed ones.
+  void Churn(float moveDistance);
+
+  // The partition's stored bounds of each object, indexed by test id (missing objects stay invalid).
+  void GetBounds(std::vector<Aabb>& bounds);
+  // The reference's pairs whose stored bounds overlap, sorted.
+  void GetExpectedSelfQuery(std::vector<QueryResult>& expected);
+  // The reference's objects whose stored bounds the ray hits, sorted by id, with their times.
+  void GetExpectedCastRay(const Ray& ray, const std::vector<Aabb>& bounds, std::vector<CastResult>& expected);
+
+  void PrintObjects(FILE* file);
+  void PrintSelfQuery(FILE* file);
+  void PrintCastRays(size_t rayCount, FILE* file);
+
+  SpatialPartition* mPartition;
+  NSquaredSpatialPartition mReference;
+  std::vector<SpatialPartitionData> mData;
+  std::vector<SpatialPartitionKey> mKeys;
+  std::vector<SpatialPartitionKey> mReferenceKeys;
+  std::vector<bool> mActive;
+  float mWorldHalfSize;
+  float mMaxHalfSize;
+  unsigned int mSeed;
+};
+
+// Sorts cast results by id so two casts can be compared.
+static bool CastResultIdLess(const CastResult& lhs, const CastResult& rhs)
+{
+  return GetTestId(lhs.mClientData) < GetTestId(rhs.mClientData);
+}
+
+// Same objects in the same (id) order with the same times.
+static bool CastResultsMatch(const std::vector<CastResult>& results, const std::vector<CastResult>& expected)
+{
+  if(results.size() != expected.size())
+    return false;
+  for(size_t i = 0; i < results.size(); ++i)
+  {
+    if(results[i].mClientData != expected[i].mClientData || Math::Abs(results[i].mTime - expected[i].mTime) > 0.001f)
+      return false;
+  }
+  return true;
+}
+
+PartitionComparison::PartitionComparison(SpatialPartition* spatialPartition, size_t count, float worldHalfSize, float maxHalfSize, unsigned int seed)
+{
+  mPartition = spatialPartition;
+  GenerateTestData(count, worldHalfSize, maxHalfSize, seed, mData);
+  mKeys.resize(count);
+  mReferenceKeys.resize(count);
+  mActive.resize(count, false);
+  mWorldHalfSize = worldHalfSize;
+  mMaxHalfSize = maxHalfSize;
+  mSeed = seed;
+}
+
+PartitionComparison::~PartitionComparison()
+{
+  delete mPartition;
+}
+
+void PartitionComparison::Insert(bool bulkBuild)
+{
+  if(bulkBuild)
+    mPartition->Build(mData.data(), mData.size(), mKeys.data());
+  for(size_t i = 0; i < mData.size(); ++i)
+  {
+    if(!bulkBuild)
+      mPartition->InsertData(mKeys[i], mData[i]);
+    mReference.InsertData(mReferenceKeys[i], mData[i]);
+    mActive[i] = true;
+  }
+}
+
+void PartitionComparison::Churn(float moveDistance)
+{
+  for(size_t i = 0; i < mData.size(); ++i)
+  {
+    float action = TestRandom(mSeed, 0.0f, 1.0f);
+    if(!mActive[i])
+    {
+      if(action < 0.05f)
+      {
+        mPartition->InsertData(mKeys[i], mData[i]);
+        mReference.InsertData(mReferenceKeys[i], mData[i]);
+        mActive[i] = true;
+      }
+      continue;
+    }
+
+    if(action < 0.05f)
+    {
+      mPartition->RemoveData(mKeys[i]);
+      mReference.RemoveData(mReferenceKeys[i]);
+      mActive[i] = false;
+    }
+    else if(action < 0.45f)
+    {
+      Aabb& aabb = mData[i].mAabb;
+      if(action < 0.1f)
+        aabb = GenerateTestAabb(mWorldHalfSize, mMaxHalfSize, mSeed);
+      for(int axis = 0; axis < 3; ++axis)
+      {
+        float offset = TestRandom(mSeed, -moveDistance, moveDistance);
+        aabb.mMin[axis] += offset;
+        aabb.mMax[axis] += offset;
+      }
+      mPartition->UpdateData(mKeys[i], mData[i]);
+      mReference.UpdateData(mReferenceKeys[i], mData[i]);
+    }
+  }
+}
+
+void PartitionComparison::GetBounds(std::vector<Aabb>& bounds)
+{
+  std::vector<SpatialPartitionQueryData> objects;
+  GetTestObjects(*mPartition, objects);
+  bounds.assign(mData.size() + 1, Aabb());
+  for(size_t i = 0; i < objects.size(); ++i)
+    bounds[GetTestId(objects[i].mClientData)] = objects[i].mAabb;
+}
+
+void PartitionComparison::GetExpectedSelfQuery(std::vector<QueryResult>& expected)
+{
+  std::vector<Aabb> bounds;
+  GetBounds(bounds);
+  QueryResults candidates;
+  mReference.SelfQuery(candidates);
+  for(size_t i = 0; i < candidates.mResults.size(); ++i)
+  {
+    const QueryResult& pair = candidates.mResults[i];
+    const Aabb& aabb0 = bounds[GetTestId(pair.mClientData0)];
+    const Aabb& aabb1 = bounds[GetTestId(pair.mClientData1)];
+    if(AabbAabb(aabb0.mMin, aabb0.mMax, aabb1.mMin, aabb1.mMax))
+      expected.push_back(pair);
+  }
+  std::sort(expected.begin(), expected.end());
+}
+
+void PartitionComparison::GetExpectedCastRay(const Ray& ray, const std::vector<Aabb>& bounds, std::vector<CastResult>& expected)
+{
+  CastResults candidates;
+  mReference.CastRay(ray, candidates);
+  for(size_t i = 0; i < candidates.mResults.size(); ++i)
+  {
+    void* clientData = candidates.mResults[i].mClientData;
+    const Aabb& aabb = bounds[GetTestId(clientData)];
+    float t;
+    if(RayAabb(ray.mStart, ray.mDirection, aabb.mMin, aabb.mMax, t))
+      expected.push_back(CastResult(clientData, t));
+  }
+  std::sort(expected.begin(), expected.end(), CastResultIdLess);
+}
+
+void PartitionComparison::PrintObjects(FILE* file)
+{
+  std::vector<SpatialPartitionQueryData> objects;
+  std::vector<SpatialPartitionQueryData> expected;
+  GetTestObjects(*mPartition, objects);
+  mReference.FilloutData(expected);
+
+  std::vector<int> ids;
+  std::vector<int> expectedIds;
+  bool containsBounds = true;
+  for(size_t i = 0; i < objects.size(); ++i)
+  {
+    int id = GetTestId(objects[i].mClientData);
+    ids.push_back(id);
+
+    const Aabb& stored = objects[i].mAabb;
+    const Aabb& current = mData[id - 1].mAabb;
+    for(int axis = 0; axis < 3; ++axis)
+      containsBounds = containsBounds && stored.mMin[axis] <= current.mMin[axis] && stored.mMax[axis] >= current.mMax[axis];
+  }
+  for(size_t i = 0; i < expected.size(); ++i)
+    expectedIds.push_back(GetTestId(expected[i].mClientData));
+  std::sort(ids.begin(), ids.end());
+  std::sort(expectedIds.begin(), expectedIds.end());
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "    Objects: %d Matches NSquared: %s\n", static_cast<int>(ids.size()), ids == expectedIds ? "true" : "false");
+  fprintf(file, "    Bounds contain the objects: %s\n", containsBounds ? "true" : "false");
+}
+
+void PartitionComparison::PrintSelfQuery(FILE* file)
+{
+  std::vector<QueryResult> pairs;
+  GetSortedSelfQuery(*mPartition, pairs);
+  std::vector<QueryResult> expected;
+  GetExpectedSelfQuery(expected);
+
+  if(file != NULL)
+    fprintf(file, "    SelfQuery pairs: %d Matches NSquared: %s\n", static_cast<int>(pairs.size()), pairs == expected ? "true" : "false");
+}
+
+void PartitionComparison::PrintCastRays(size_t rayCount, FILE* file)
+{
+  std::vector<Aabb> bounds;
+  GetBounds(bounds);
+
+  unsigned int seed = mSeed;
+  size_t hitCount = 0;
+  bool matches = true;
+  for(size_t i = 0; i < rayCount; ++i)
+  {
+    Ray ray = GenerateTestRay(mWorldHalfSize, seed);
+    CastResults results;
+    mPartition->CastRay(ray, results);
+    std::sort(results.mResults.begin(), results.mResults.end(), CastResultIdLess);
+
+    std::vector<CastResult> expected;
+    GetExpectedCastRay(ray, bounds, expected);
+    matches = matches && CastResultsMatch(results.mResults, expected);
+    hitCount += results.mResults.size();
+  }
+
+  if(file != NULL)
+    fprintf(file, "    CastRay hits: %d Matches NSquared: %s\n", static_cast<int>(hitCount), matches ? "true" : "false");
+}
+
+//-----------------------------------------------------------------------------Bulk Build Tests
+// Prints how the partition compares to the NSquared reference after being built and again after
+// the objects were moved around (so the keys Build handed out are used too).
+static void TestAgainstNSquared(PartitionComparison& comparison, float moveDistance, FILE* file)
+{
+  PrintPartitionName(*comparison.mPartition, file);
+  comparison.PrintObjects(file);
+  comparison.PrintSelfQuery(file);
+  comparison.PrintCastRays(50, file);
+
+  comparison.Churn(moveDistance);
+  if(file != NULL)
+    fprintf(file, "  After moving objects:\n");
+  comparison.PrintObjects(file);
+  comparison.PrintSelfQuery(file);
+  comparison.PrintCastRays(50, file);
+}
+
+void DynamicAabbTreeBuildTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  DynamicAabbTree* tree = new DynamicAabbTree();
+  PartitionComparison comparison(tree, 1000, 20.0f, 1.5f, 20);
+  comparison.Insert(true);
+
+  // The binned SAH build should make a better tree than inserting the objects one at a time
+  DynamicAabbTree insertedTree;
+  InsertTestData(insertedTree, comparison.mData);
+  if(file != NULL)
+    fprintf(file, "  Built SAH cost below inserted: %s\n", tree->GetSahCost() < insertedTree.GetSahCost() ? "true" : "false");
+
+  TestAgainstNSquared(comparison, 2.0f, file);
+}
+
+void DynamicAabbTreeBuildEmptyTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // Building nothing leaves an empty tree that objects can still be inserted into
+  PartitionComparison comparison(new DynamicAabbTree(), 0, 20.0f, 1.5f, 21);
+  comparison.Insert(true);
+  comparison.PrintObjects(file);
+
+  PartitionComparison single(new DynamicAabbTree(), 1, 20.0f, 1.5f, 22);
+  single.Insert(true);
+  TestAgainstNSquared(single, 2.0f, file);
+}
+
+//-----------------------------------------------------------------------------Refit Mode Tests
+void DynamicAabbTreeRefitModeTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  DynamicAabbTree* tree = new DynamicAabbTree();
+  tree->SetRefitMode(true);
+  PartitionComparison comparison(tree, 800, 20.0f, 1.5f, 23);
+  comparison.Insert(false);
+  PrintPartitionName(*tree, file);
+
+  // Small moves are only refit. The large ones can grow the SAH cost enough that the tree is rebuilt.
+  float moveDistances[] = {0.5f, 0.5f, 8.0f, 0.5f};
+  for(size_t i = 0; i < sizeof(moveDistances) / sizeof(moveDistances[0]); ++i)
+  {
+    comparison.Churn(moveDistances[i]);
+    if(file != NULL)
+      fprintf(file, "  After moving objects up to %s:\n", PrintFloat(moveDistances[i]).c_str());
+    comparison.PrintObjects(file);
+    comparison.PrintSelfQuery(file);
+    comparison.PrintCastRays(50, file);
+  }
+
+  // Turning the mode off flushes anything still queued
+  comparison.Churn(0.5f);
+  tree->SetRefitMode(false);
+  if(file != NULL)
+    fprintf(file, "  After leaving refit mode:\n");
+  comparison.PrintObjects(file);
+  comparison.PrintSelfQuery(file);
+}
+
+//-----------------------------------------------------------------------------Tree Rotation Tests
+void DynamicAabbTreeRotationsTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  DynamicAabbTree* tree = new DynamicAabbTree();
+  tree->mUseRotations = true;
+  PartitionComparison comparison(tree, 800, 20.0f, 1.5f, 24);
+  comparison.Insert(false);
+  PrintPartitionName(*tree, file);
+
+  // Rotations only restructure the tree, so the queries shouldn't change and the cost shouldn't grow
+  for(int i = 0; i < 4; ++i)
+  {
+    comparison.Churn(3.0f);
+    float costBefore = tree->GetSahCost();
+    tree->Optimize(200);
+    if(file != NULL)
+    {
+      fprintf(file, "  After moving objects and optimizing:\n");
+      fprintf(file, "    SAH cost not above before: %s\n", tree->GetSahCost() <= costBefore + 0.001f ? "true" : "false");
+    }
+    comparison.PrintObjects(file);
+    comparison.PrintSelfQuery(file);
+    comparison.PrintCastRays(50, file);
+  }
+}
+
+//-----------------------------------------------------------------------------Sweep and Prune Tests
+void SweepAndPruneTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  PartitionComparison comparison(new SweepAndPrune(), 800, 20.0f, 1.5f, 25);
+  comparison.Insert(false);
+  TestAgainstNSquared(comparison, 2.0f, file);
+
+  // Large moves swap many endpoints at once
+  comparison.Churn(10.0f);
+  if(file != NULL)
+    fprintf(file, "  After large moves:\n");
+  comparison.PrintObjects(file);
+  comparison.PrintSelfQuery(file);
+  comparison.PrintCastRays(50, file);
+}
+
+void SweepAndPruneBuildTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  PartitionComparison comparison(new SweepAndPrune(), 800, 20.0f, 1.5f, 26);
+  comparison.Insert(true);
+  TestAgainstNSquared(comparison, 2.0f, file);
+}
+
+//-----------------------------------------------------------------------------Hash Grid Tests
+void HashGridTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  PartitionComparison comparison(new HashGridSpatialPartition(), 800, 20.0f, 1.5f, 27);
+  comparison.Insert(true);
+  TestAgainstNSquared(comparison, 2.0f, file);
+}
+
+void HashGridOversizedTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // With cells this small the larger objects span more than cMaxCellsPerProxy cells and go on the
+  // overflow list, which every query has to test as well
+  HashGridSpatialPartition* grid = new HashGridSpatialPartition();
+  grid->mAutoTune = false;
+  grid->SetCellSize(0.75f);
+  PartitionComparison comparison(grid, 800, 20.0f, 1.5f, 28);
+  comparison.Insert(false);
+  if(file != NULL)
+    fprintf(file, "  Has oversized objects: %s\n", grid->mOversizedProxies.empty() ? "false" : "true");
+  TestAgainstNSquared(comparison, 2.0f, file);
+
+  // Changing the cell size re-buckets everything, so objects move on and off the overflow list
+  grid->SetCellSize(3.0f);
+  if(file != NULL)
+    fprintf(file, "  After growing the cells:\n    Has oversized objects: %s\n", grid->mOversizedProxies.empty() ? "false" : "true");
+  comparison.PrintObjects(file);
+  comparison.PrintSelfQuery(file);
+  comparison.PrintCastRays(50, file);
+}
+
+//-----------------------------------------------------------------------------Hierarchical Hash Grid Tests
+void HierarchicalHashGridTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // Sizes from 0.1 to 8 spread the objects over several levels, so pairs are found both within a
+  // level and between levels
+  HierarchicalHashGrid* grid = new HierarchicalHashGrid();
+  PartitionComparison comparison(grid, 800, 30.0f, 8.0f, 29);
+  comparison.Insert(false);
+  if(file != NULL)
+    fprintf(file, "  Levels: %d\n", static_cast<int>(grid->mLevels.size()));
+  TestAgainstNSquared(comparison, 3.0f, file);
+}
+
+//-----------------------------------------------------------------------------Batch Tests
+// Moves the first count objects by up to moveDistance and updates them in one batch.
+static void UpdateTestBatch(PartitionComparison& comparison, size_t count, float moveDistance)
+{
+  for(size_t i = 0; i < count; ++i)
+  {
+    Aabb& aabb = comparison.mData[i].mAabb;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      float offset = TestRandom(comparison.mSeed, -moveDistance, moveDistance);
+      aabb.mMin[axis] += offset;
+      aabb.mMax[axis] += offset;
+    }
+    comparison.mReference.UpdateData(comparison.mReferenceKeys[i], comparison.mData[i]);
+  }
+  comparison.mPartition->UpdateBatch(comparison.mKeys.data(), comparison.mData.data(), count);
+}
+
+static void PrintBatchComparison(PartitionComparison& comparison, const char* step, FILE* file)
+{
+  if(file != NULL)
+    fprintf(file, "  After %s:\n", step);
+  comparison.PrintObjects(file);
+  comparison.PrintSelfQuery(file);
+  comparison.PrintCastRays(20, file);
+}
+
+// Small batches go through the partitions' single object paths, large ones through their batch paths.
+static void TestBatches(SpatialPartitionTypes::Types type, unsigned int seed, FILE* file)
+{
+  PartitionComparison comparison(CreateTestPartition(type), 800, 20.0f, 1.5f, seed);
+  std::vector<SpatialPartitionKey>& keys = comparison.mKeys;
+  std::vector<SpatialPartitionData>& data = comparison.mData;
+  size_t count = data.size();
+  PrintPartitionName(*comparison.mPartition, file);
+
+  comparison.mPartition->InsertBatch(keys.data(), data.data(), count);
+  for(size_t i = 0; i < count; ++i)
+    comparison.mReference.InsertData(comparison.mReferenceKeys[i], data[i]);
+  PrintBatchComparison(comparison, "inserting every object", file);
+
+  UpdateTestBatch(comparison, count / 20, 2.0f);
+  PrintBatchComparison(comparison, "updating a few objects", file);
+
+  UpdateTestBatch(comparison, count, 2.0f);
+  PrintBatchComparison(comparison, "updating every object", file);
+
+  comparison.mPartition->RemoveBatch(keys.data(), count / 2);
+  for(size_t i = 0; i < count / 2; ++i)
+    comparison.mReference.RemoveData(comparison.mReferenceKeys[i]);
+  PrintBatchComparison(comparison, "removing half the objects", file);
+
+  comparison.mPartition->InsertBatch(keys.data(), data.data(), count / 4);
+  for(size_t i = 0; i < count / 4; ++i)
+    comparison.mReference.InsertData(comparison.mReferenceKeys[i], data[i]);
+  PrintBatchComparison(comparison, "inserting a quarter back", file);
+}
+
+void BatchDynamicAabbTreeTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  TestBatches(SpatialPartitionTypes::AabbTree, 30, file);
+}
+
+void BatchSweepAndPruneTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  TestBatches(SpatialPartitionTypes::SweepAndPrune, 31, file);
+}
+
+// Partitions without their own batch calls use the defaults (one object at a time).
+void BatchDefaultTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  TestBatches(SpatialPartitionTypes::HashGrid, 32, file);
+}
+
+//-----------------------------------------------------------------------------Ray Packet Tests
+// Casts the rays with CastRays and prints whether every ray's results match the NSquared reference.
+static void PrintCastRaysComparison(PartitionComparison& comparison, const std::vector<Ray>& rays, const char* name, FILE* file)
+{
+  std::vector<CastResults> results(rays.size());
+  comparison.mPartition->CastRays(rays.data(), rays.size(), results.data());
+
+  std::vector<Aabb> bounds;
+  comparison.GetBounds(bounds);
+  size_t hitCount = 0;
+  bool matches = true;
+  for(size_t i = 0; i < rays.size(); ++i)
+  {
+    std::vector<CastResult>& rayResults = results[i].mResults;
+    std::sort(rayResults.begin(), rayResults.end(), CastResultIdLess);
+    std::vector<CastResult> expected;
+    comparison.GetExpectedCastRay(rays[i], bounds, expected);
+    matches = matches && CastResultsMatch(rayResults, expected);
+    hitCount += rayResults.size();
+  }
+
+  if(file != NULL)
+    fprintf(file, "    %s rays: %d hits: %d Matches NSquared: %s\n", name, static_cast<int>(rays.size()), static_cast<int>(hitCount), matches ? "true" : "false");
+}
+
+// Coherent rays (a fan from one point, like a tile of camera rays) share most of their traversal,
+// incoherent ones barely any. The counts aren't multiples of the packet width so partial packets are used.
+static void TestCastRays(SpatialPartitionTypes::Types type, unsigned int seed, FILE* file)
+{
+  PartitionComparison comparison(CreateTestPartition(type), 800, 20.0f, 1.5f, seed);
+  comparison.Insert(false);
+  PrintPartitionName(*comparison.mPartition, file);
+
+  std::vector<Ray> coherentRays;
+  for(int y = 0; y < 7; ++y)
+  {
+    for(int x = 0; x < 9; ++x)
+    {
+      Ray ray;
+      ray.mStart = Vector3(0, 0, -30);
+      ray.mDirection = Vector3((x - 4) * 0.05f, (y - 3) * 0.05f, 1.0f);
+      coherentRays.push_back(ray);
+    }
+  }
+  PrintCastRaysComparison(comparison, coherentRays, "Coherent", file);
+
+  std::vector<Ray> incoherentRays;
+  for(int i = 0; i < 37; ++i)
+    incoherentRays.push_back(GenerateTestRay(20.0f, seed));
+  PrintCastRaysComparison(comparison, incoherentRays, "Incoherent", file);
+
+  std::vector<Ray> singleRay(1, incoherentRays[0]);
+  PrintCastRaysComparison(comparison, singleRay, "Single", file);
+}
+
+// The partitions with packet traversal, and one using the default (one ray at a time).
+static const SpatialPartitionTypes::Types cCastRaysTestTypes[] =
+{
+  SpatialPartitionTypes::AabbTree, SpatialPartitionTypes::LinearBvh, SpatialPartitionTypes::SweepAndPrune
+};
+
+void CastRaysTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  for(size_t i = 0; i < sizeof(cCastRaysTestTypes) / sizeof(cCastRaysTestTypes[0]); ++i)
+    TestCastRays(cCastRaysTestTypes[i], 33 + static_cast<unsigned int>(i), file);
+}
+
+//-----------------------------------------------------------------------------Pair Cache Tests
+static void GetPairCacheResults(const PairCache& cache, const std::vector<unsigned int>& indices, std::vector<QueryResult>& pairs)
+{
+  for(size_t i = 0; i < indices.size(); ++i)
+    pairs.push_back(cache.mPairs[indices[i]].mResult);
+  std::sort(pairs.begin(), pairs.end());
+}
+
+// Runs a few frames of moving objects through the cache and prints whether its began, persisted and
+// ended pairs match the differences between the NSquared reference's pairs from one frame to the next.
+static void TestPairCache(SpatialPartitionTypes::Types type, unsigned int seed, FILE* file)
+{
+  PartitionComparison comparison(CreateTestPartition(type), 600, 15.0f, 1.5f, seed);
+  comparison.Insert(false);
+  PrintPartitionName(*comparison.mPartition, file);
+
+  PairCache cache;
+  std::vector<QueryResult> previousPairs;
+  for(int frame = 0; frame < 4; ++frame)
+  {
+    if(frame != 0)
+      comparison.Churn(1.0f);
+
+    QueryResults results;
+    comparison.mPartition->SelfQuery(results);
+    size_t duplicates = cache.Update(results);
+
+    std::vector<QueryResult> pairs;
+    comparison.GetExpectedSelfQuery(pairs);
+    std::vector<QueryResult> expectedBegan;
+    std::vector<QueryResult> expectedPersisted;
+    std::vector<QueryResult> expectedEnded;
+    std::set_difference(pairs.begin(), pairs.end(), previousPairs.begin(), previousPairs.end(), std::back_inserter(expectedBegan));
+    std::set_intersection(pairs.begin(), pairs.end(), previousPairs.begin(), previousPairs.end(), std::back_inserter(expectedPersisted));
+    std::set_difference(previousPairs.begin(), previousPairs.end(), pairs.begin(), pairs.end(), std::back_inserter(expectedEnded));
+
+    std::vector<QueryResult> began;
+    std::vector<QueryResult> persisted;
+    std::vector<QueryResult> ended = cache.mEnded;
+    GetPairCacheResults(cache, cache.mBegan, began);
+    GetPairCacheResults(cache, cache.mPersisted, persisted);
+    std::sort(ended.begin(), ended.end());
+
+    // A persisted pair keeps whatever the narrow phase stored on it
+    bool userDataKept = true;
+    for(size_t i = 0; i < cache.mPersisted.size(); ++i)
+      userDataKept = userDataKept && cache.mPairs[cache.mPersisted[i]].mUserData == 1;
+    for(size_t i = 0; i < cache.mBegan.size(); ++i)
+      cache.mPairs[cache.mBegan[i]].mUserData = 1;
+    previousPairs = pairs;
+
+    if(file == NULL)
+      continue;
+
+    fprintf(file, "  Frame %d:\n", frame);
+    fprintf(file, "    Duplicates: %d\n", static_cast<int>(duplicates));
+    fprintf(file, "    Began: %d Matches NSquared: %s\n", static_cast<int>(began.size()), began == expectedBegan ? "true" : "false");
+    fprintf(file, "    Persisted: %d Matches NSquared: %s\n", static_cast<int>(persisted.size()), persisted == expectedPersisted ? "true" : "false");
+    fprintf(file, "    Ended: %d Matches NSquared: %s\n", static_cast<int>(ended.size()), ended == expectedEnded ? "true" : "false");
+    fprintf(file, "    User data kept: %s\n", userDataKept ? "true" : "false");
+  }
+}
+
+void PairCacheTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  TestPairCache(SpatialPartitionTypes::AabbTree, 36, file);
+  TestPairCache(SpatialPartitionTypes::SweepAndPrune, 37, file);
+}
+
+void PairCacheDuplicatesTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // Repeats (in either order) are counted and ignored, and dropping an object's pairs doesn't end them
+  int ids[] = {1, 2, 3};
+  QueryResults results;
+  results.AddResult(QueryResult(&ids[0], &ids[1]));
+  results.AddResult(QueryResult(&ids[1], &ids[0]));
+  results.AddResult(QueryResult(&ids[1], &ids[2]));
+  PairCache cache;
+  size_t duplicates = cache.Update(results);
+  size_t began = cache.mBegan.size();
+  cache.RemoveClientData(&ids[0]);
+  size_t pairsAfterRemove = cache.mPairs.size();
+  results.mResults.clear();
+  cache.Update(results);
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "  Duplicates: %d Began: %d\n", static_cast<int>(duplicates), static_cast<int>(began));
+  fprintf(file, "  Pairs after removing an object: %d\n", static_cast<int>(pairsAfterRemove));
+  fprintf(file, "  Ended next frame: %d\n", static_cast<int>(cache.mEnded.size()));
+}
+
+//-----------------------------------------------------------------------------Parallel SelfQuery Tests
+// Enough objects that the self queries run on several threads (see cParallelSelfQueryThreshold).
+static const size_t cParallelTestObjectCount = 5000;
+
+// The threaded pairs only actually come from several threads on a machine with more than one core.
+static void PrintParallelSelfQuery(const std::vector<QueryResult>& threadedPairs, const std::vector<QueryResult>& serialPairs, FILE* file)
+{
+  if(file == NULL)
+    return;
+
+  fprintf(file, "  Test ParallelSelfQuery:\n");
+  fprintf(file, "    Pairs: %d\n", static_cast<int>(threadedPairs.size()));
+  fprintf(file, "    Matches serial: %s\n", threadedPairs == serialPairs ? "true" : "false");
+}
+
+// Trees with a split depth run the whole descent on this thread when they're not allowed to split it into tasks.
+template <typename TreeType>
+static void TestSplitSelfQuery(TreeType& tree, FILE* file)
+{
+  std::vector<QueryResult> serialPairs;
+  tree.mSelfQuerySplitDepth = 0;
+  GetSortedSelfQuery(tree, serialPairs);
+
+  std::vector<QueryResult> threadedPairs;
+  tree.mSelfQuerySplitDepth = cDefaultSelfQuerySplitDepth;
+  GetSortedSelfQuery(tree, threadedPairs);
+
+  std::vector<QueryResult> bruteForcePairs;
+  GetBruteForceSelfQuery(tree, bruteForcePairs);
+
+  PrintParallelSelfQuery(threadedPairs, serialPairs, file);
+  if(file != NULL)
+    fprintf(file, "    Serial matches brute force: %s\n", serialPairs == bruteForcePairs ? "true" : "false");
+}
+
+void ParallelSelfQueryDynamicAabbTreeTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(cParallelTestObjectCount, 60.0f, 1.5f, 1, data);
+  DynamicAabbTree tree;
+  InsertTestData(tree, data);
+  TestSplitSelfQuery(tree, file);
+}
+
+void ParallelSelfQueryLinearBvhTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(cParallelTestObjectCount, 60.0f, 1.5f, 2, data);
+  LinearBvh tree;
+  InsertTestData(tree, data);
+  TestSplitSelfQuery(tree, file);
+}
+
+void ParallelSelfQueryLooseOctreeTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(cParallelTestObjectCount, 100.0f, 3.0f, 3, data);
+  LooseOctree tree;
+  InsertTestData(tree, data);
+
+  // The octree can't be told to run serially, so its serial result is testing every pair
+  std::vector<QueryResult> threadedPairs;
+  GetSortedSelfQuery(tree, threadedPairs);
+  std::vector<QueryResult> serialPairs;
+  GetBruteForceSelfQuery(tree, serialPairs);
+
+  PrintParallelSelfQuery(threadedPairs, serialPairs, file);
+}
+
+//-----------------------------------------------------------------------------QueryNearest Tests
+// Prints the partition's k nearest objects and whether their distances match testing every object.
+static void PrintQueryNearestResults(SpatialPartition& spatialPartition, const Vector3& point, size_t k, float maxDistance, bool compareToBruteForce, FILE* file)
+{
+  CastResults results;
+  spatialPartition.QueryNearest(point, k, maxDistance, results);
+
+  gDebugDrawer->DrawPoint(point);
+  spatialPartition.DebugDraw(-1, Matrix4::cIdentity);
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "  Test QueryNearest:\n");
+  if(results.mResults.empty())
+    fprintf(file, "    Empty\n");
+  for(size_t i = 0; i < results.mResults.size(); ++i)
+    fprintf(file, "    %d %s\n", GetTestId(results.mResults[i].mClientData), PrintFloat(results.mResults[i].mTime).c_str());
+
+  if(!compareToBruteForce)
+    return;
+
+  // Ties can be broken either way so only the distances are compared
+  CastResults expected;
+  spatialPartition.SpatialPartition::QueryNearest(point, k, maxDistance, expected);
+  bool matches = results.mResults.size() == expected.mResults.size();
+  for(size_t i = 0; matches && i < results.mResults.size(); ++i)
+    matches = Math::Abs(results.mResults[i].mTime - expected.mResults[i].mTime) < 0.001f;
+  fprintf(file, "    Matches brute force: %s\n", matches ? "true" : "false");
+}
+
+static void TestQueryNearest(SpatialPartition& spatialPartition, bool compareToBruteForce, FILE* file)
+{
+  PrintPartitionName(spatialPartition, file);
+  PrintQueryNearestResults(spatialPartition, Vector3(0, 0, 0), 5, Math::PositiveMax(), compareToBruteForce, file);
+  PrintQueryNearestResults(spatialPartition, Vector3(12.5f, -7.25f, 3), 8, Math::PositiveMax(), compareToBruteForce, file);
+  PrintQueryNearestResults(spatialPartition, Vector3(-30, 30, -30), 4, 15.0f, compareToBruteForce, file);
+  PrintQueryNearestResults(spatialPartition, Vector3(5, 5, 5), 0, Math::PositiveMax(), compareToBruteForce, file);
+}
+
+// The partitions with a best-first QueryNearest (the aabb tree ranks by its fat aabbs, which is what FilloutData gives).
+static const SpatialPartitionTypes::Types cQueryNearestTestTypes[] =
+{
+  SpatialPartitionTypes::AabbTree, SpatialPartitionTypes::LinearBvh, SpatialPartitionTypes::LooseOctree,
+  SpatialPartitionTypes::WideBvh, SpatialPartitionTypes::QuantizedBvh, SpatialPartitionTypes::FlatBvh
+};
+
+void QueryNearestTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(300, 50.0f, 2.0f, 4, data);
+  for(size_t i = 0; i < sizeof(cQueryNearestTestTypes) / sizeof(cQueryNearestTestTypes[0]); ++i)
+  {
+    SpatialPartition* spatialPartition = CreateTestPartition(cQueryNearestTestTypes[i]);
+    spatialPartition->Build(data.data(), data.size());
+    TestQueryNearest(*spatialPartition, true, file);
+    delete spatialPartition;
+  }
+}
+
+void QueryNearestNSquaredTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // Without bounds there's nothing to compare against, but there should still be at most k results
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(20, 50.0f, 2.0f, 4, data);
+  NSquaredSpatialPartition spatialPartition;
+  spatialPartition.Build(data.data(), data.size());
+  TestQueryNearest(spatialPartition, false, file);
+}
+
+//-----------------------------------------------------------------------------QueryPartitions Tests
+// Prints the pairs between the partitions and whether they match testing every pair of objects.
+static void PrintPartitionQueryResults(SpatialPartition& partitionA, SpatialPartition& partitionB, const Matrix4& bToA, FILE* file)
+{
+  QueryResults results;
+  QueryPartitions(partitionA, partitionB, bToA, results);
+  std::vector<QueryResult> pairs = results.mResults;
+  std::sort(pairs.begin(), pairs.end());
+
+  std::vector<SpatialPartitionQueryData> objectsA;
+  std::vector<SpatialPartitionQueryData> objectsB;
+  GetTestObjects(partitionA, objectsA);
+  GetTestObjects(partitionB, objectsB);
+  std::vector<QueryResult> expected;
+  for(size_t i = 0; i < objectsA.size(); ++i)
+  {
+    const Aabb& aabbA = objectsA[i].mAabb;
+    for(size_t j = 0; j < objectsB.size(); ++j)
+    {
+      // Objects without bounds (the inverted default aabb) overlap everything
+      Aabb aabbB = objectsB[j].mAabb;
+      bool unbounded = aabbA.mMin.x > aabbA.mMax.x || aabbB.mMin.x > aabbB.mMax.x;
+      aabbB.Transform(bToA);
+      if(!unbounded && !AabbAabb(aabbA.mMin, aabbA.mMax, aabbB.mMin, aabbB.mMax))
+        continue;
+
+      // QueryPartitions keeps the partition order
+      QueryResult result(objectsA[i].mClientData, objectsB[j].mClientData);
+      result.mClientData0 = objectsA[i].mClientData;
+      result.mClientData1 = objectsB[j].mClientData;
+      expected.push_back(result);
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "  Test QueryPartitions:\n");
+  fprintf(file, "    Pairs: %d\n", static_cast<int>(pairs.size()));
+  fprintf(file, "    Matches brute force: %s\n", pairs == expected ? "true" : "false");
+}
+
+static Matrix4 GetPartitionQueryTransform()
+{
+  Matrix4 transform;
+  transform.BuildTransform(Vector3(4, -2, 1), Math::ToQuaternion(Math::Normalized(Vector3(1, 2, 3)), 0.7f), Vector3(1.25f));
+  return transform;
+}
+
+// Two partitions of different objects (b's client data starts at 10000 so the pairs can be told apart).
+static void TestPartitionQuery(SpatialPartitionTypes::Types typeA, SpatialPartitionTypes::Types typeB, size_t countA, size_t countB, unsigned int seed, FILE* file)
+{
+  std::vector<SpatialPartitionData> dataA;
+  std::vector<SpatialPartitionData> dataB;
+  GenerateTestData(countA, 40.0f, 1.5f, seed, dataA);
+  GenerateTestData(countB, 30.0f, 1.5f, seed + 1, dataB);
+  for(size_t i = 0; i < dataB.size(); ++i)
+    dataB[i].mClientData = reinterpret_cast<void*>(10000 + i);
+
+  SpatialPartition* partitionA = CreateTestPartition(typeA);
+  SpatialPartition* partitionB = CreateTestPartition(typeB);
+  InsertTestData(*partitionA, dataA);
+  InsertTestData(*partitionB, dataB);
+
+  if(file != NULL)
+    fprintf(file, "  Partitions %s x %s:\n", SpatialPartitionTypes::Names[typeA], SpatialPartitionTypes::Names[typeB]);
+  PrintPartitionQueryResults(*partitionA, *partitionB, Matrix4::cIdentity, file);
+  PrintPartitionQueryResults(*partitionA, *partitionB, GetPartitionQueryTransform(), file);
+
+  delete partitionA;
+  delete partitionB;
+}
+
+// Both hierarchies, hierarchies of different widths and one partition without a hierarchy (whose objects descend the other).
+static const SpatialPartitionTypes::Types cPartitionQueryTestTypes[][2] =
+{
+  {SpatialPartitionTypes::AabbTree, SpatialPartitionTypes::LinearBvh},
+  {SpatialPartitionTypes::WideBvh, SpatialPartitionTypes::QuantizedBvh},
+  {SpatialPartitionTypes::LooseOctree, SpatialPartitionTypes::SweepAndPrune},
+  {SpatialPartitionTypes::SweepAndPrune, SpatialPartitionTypes::LooseOctree}
+};
+
+void QueryPartitionsTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  for(size_t i = 0; i < sizeof(cPartitionQueryTestTypes) / sizeof(cPartitionQueryTestTypes[0]); ++i)
+    TestPartitionQuery(cPartitionQueryTestTypes[i][0], cPartitionQueryTestTypes[i][1], 1000, 600, 5 + 2 * static_cast<unsigned int>(i), file);
+}
+
+void QueryPartitionsNSquaredTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // N-squared doesn't keep bounds so its objects pair with everything, on either side and in any space
+  TestPartitionQuery(SpatialPartitionTypes::NSquared, SpatialPartitionTypes::AabbTree, 30, 20, 11, file);
+  TestPartitionQuery(SpatialPartitionTypes::AabbTree, SpatialPartitionTypes::NSquared, 30, 20, 13, file);
+  TestPartitionQuery(SpatialPartitionTypes::NSquared, SpatialPartitionTypes::NSquared, 30, 20, 15, file);
+}
+
+//-----------------------------------------------------------------------------FlatBvh Tests
+// Saves the tree, loads it back and prints whether the loaded tree has the same nodes and gives the same query results.
+static void PrintFlatBvhRoundTrip(FlatBvh& tree, FILE* file)
+{
+  const char* path = "FlatBvhRoundTripTest.fbvh";
+  bool saved = tree.Save(path);
+  FlatBvh loaded;
+  bool wasLoaded = loaded.Load(path);
+
+  std::vector<SpatialPartitionQueryData> treeData;
+  std::vector<SpatialPartitionQueryData> loadedData;
+  tree.FilloutData(treeData);
+  loaded.FilloutData(loadedData);
+  bool sameNodes = treeData.size() == loadedData.size();
+  for(size_t i = 0; sameNodes && i < treeData.size(); ++i)
+  {
+    sameNodes = treeData[i].mClientData == loadedData[i].mClientData && treeData[i].mDepth == loadedData[i].mDepth &&
+                treeData[i].mAabb.mMin == loadedData[i].mAabb.mMin && treeData[i].mAabb.mMax == loadedData[i].mAabb.mMax;
+  }
+
+  bool sameRayCasts = true;
+  unsigned int seed = 7;
+  for(int i = 0; i < 20; ++i)
+  {
+    Ray ray;
+    ray.mStart = Vector3(TestRandom(seed, -40, 40), TestRandom(seed, -40, 40), TestRandom(seed, -40, 40));
+    ray.mDirection = Vector3(TestRandom(seed, -1, 1), TestRandom(seed, -1, 1), TestRandom(seed, -1, 1));
+    CastResults treeResults;
+    CastResults loadedResults;
+    tree.CastRay(ray, treeResults);
+    loaded.CastRay(ray, loadedResults);
+    std::sort(treeResults.mResults.begin(), treeResults.mResults.end());
+    std::sort(loadedResults.mResults.begin(), loadedResults.mResults.end());
+    sameRayCasts = sameRayCasts && treeResults.mResults.size() == loadedResults.mResults.size();
+    for(size_t j = 0; sameRayCasts && j < treeResults.mResults.size(); ++j)
+      sameRayCasts = treeResults.mResults[j].mClientData == loadedResults.mResults[j].mClientData;
+  }
+
+  std::vector<QueryResult> treePairs;
+  std::vector<QueryResult> loadedPairs;
+  GetSortedSelfQuery(tree, treePairs);
+  GetSortedSelfQuery(loaded, loadedPairs);
+
+  // The file stays mapped until the tree is cleared
+  loaded.Clear();
+  std::remove(path);
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "  Test FlatBvh Save/Load:\n");
+  fprintf(file, "    Saved: %s Loaded: %s\n", saved ? "true" : "false", wasLoaded ? "true" : "false");
+  fprintf(file, "    Nodes: %d Same nodes: %s\n", static_cast<int>(loadedData.size()), sameNodes ? "true" : "false");
+  fprintf(file, "    Same ray casts: %s\n", sameRayCasts ? "true" : "false");
+  fprintf(file, "    Same SelfQuery: %s (%d pairs)\n", treePairs == loadedPairs ? "true" : "false", static_cast<int>(loadedPairs.size()));
+}
+
+void FlatBvhBuildRoundTripTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(500, 30.0f, 1.5f, 14, data);
+  FlatBvh tree;
+  tree.Build(data.data(), data.size());
+  PrintFlatBvhRoundTrip(tree, file);
+}
+
+void FlatBvhFlattenRoundTripTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  std::vector<SpatialPartitionData> data;
+  GenerateTestData(500, 30.0f, 1.5f, 15, data);
+  DynamicAabbTree source;
+  InsertTestData(source, data);
+  FlatBvh tree;
+  bool flattened = tree.Flatten(source);
+  if(file != NULL)
+    fprintf(file, "  Flattened: %s\n", flattened ? "true" : "false");
+  PrintFlatBvhRoundTrip(tree, file);
+}
+
+void FlatBvhEmptyRoundTripTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+
+  // An empty tree has nothing to save, so the file can't be loaded back either
+  FlatBvh tree;
+  PrintFlatBvhRoundTrip(tree, file);
+}
+
+//-----------------------------------------------------------------------------Closest Ray Tests
+// Misses every third object and pushes the rest's hits back a little more per id, so the object
+// with the closest bounds often isn't the closest hit.
+class TestRayRefiner : public RayRefiner
+{
+public:
+  explicit TestRayRefiner(const std::vector<Aabb>& bounds) : mBounds(bounds) {};
+
+  bool Refine(const Ray& ray, void* clientData, float& t) override
+  {
+    int id = GetTestId(clientData);
+    const Aabb& aabb = mBounds[id];
+    if(id % 3 == 0 || !RayAabb(ray.mStart, ray.mDirection, aabb.mMin, aabb.mMax, t))
+      return false;
+    t += (id % 7) * 0.25f;
+    return true;
+  }
+
+  const std::vector<Aabb>& mBounds;
+};
+
+// Is the result the closest of the expected hits (ties can be broken either way, so only the time is compared)?
+static bool ClosestResultMatches(bool hit, const CastResult& result, const std::vector<CastResult>& expected)
+{
+  float closestT = Math::PositiveMax();
+  for(size_t i = 0; i < expected.size(); ++i)
+    closestT = Math::Min(closestT, expected[i].mTime);
+  if(!hit)
+    return expected.empty();
+  return Math::Abs(result.mTime - closestT) < 0.001f;
+}
+
+// Prints whether each ray's closest hit (with and without a refiner) matches the closest of the
+// NSquared reference's hits.
+static void PrintCastRayClosest(PartitionComparison& comparison, size_t rayCount, FILE* file)
+{
+  std::vector<Aabb> bounds;
+  comparison.GetBounds(bounds);
+  TestRayRefiner refiner(bounds);
+
+  unsigned int seed = comparison.mSeed;
+  size_t hitCount = 0;
+  size_t refinedHitCount = 0;
+  bool matches = true;
+  bool refinedMatches = true;
+  for(size_t i = 0; i < rayCount; ++i)
+  {
+    Ray ray = GenerateTestRay(comparison.mWorldHalfSize, seed);
+    std::vector<CastResult> expected;
+    comparison.GetExpectedCastRay(ray, bounds, expected);
+    std::vector<CastResult> expectedRefined;
+    for(size_t j = 0; j < expected.size(); ++j)
+    {
+      float t;
+      if(refiner.Refine(ray, expected[j].mClientData, t))
+        expectedRefined.push_back(CastResult(expected[j].mClientData, t));
+    }
+
+    CastResult result;
+    bool hit = comparison.mPartition->CastRayClosest(ray, result);
+    matches = matches && ClosestResultMatches(hit, result, expected);
+    hitCount += hit ? 1 : 0;
+
+    CastResult refinedResult;
+    bool refinedHit = comparison.mPartition->CastRayClosest(ray, refinedResult, &refiner);
+    refinedMatches = refinedMatches && ClosestResultMatches(refinedHit, refinedResult, expectedRefined);
+    refinedHitCount += refinedHit ? 1 : 0;
+  }
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "    CastRayClosest hits: %d Matches NSquared: %s\n", static_cast<int>(hitCount), matches ? "true" : "false");
+  fprintf(file, "    Refined hits: %d Matches NSquared: %s\n", static_cast<int>(refinedHitCount), refinedMatches ? "true" : "false");
+}
+
+// Objects can't be removed from a QuantizedBvh or a FlatBvh, so those are built and not moved around afterwards.
+static bool CanChurnTestPartition(SpatialPartitionTypes::Types type)
+{
+  return type != SpatialPartitionTypes::QuantizedBvh && type != SpatialPartitionTypes::FlatBvh;
+}
+
+static void TestCastRayClosest(SpatialPartitionTypes::Types type, unsigned int seed, FILE* file)
+{
+  bool canChurn = CanChurnTestPartition(type);
+  PartitionComparison comparison(CreateTestPartition(type), 800, 20.0f, 1.5f, seed);
+  comparison.Insert(!canChurn);
+  PrintPartitionName(*comparison.mPartition, file);
+  PrintCastRayClosest(comparison, 100, file);
+  if(!canChurn)
+    return;
+
+  comparison.Churn(2.0f);
+  if(file != NULL)
+    fprintf(file, "  After moving objects:\n");
+  PrintCastRayClosest(comparison, 100, file);
+}
+
+// Every partition with its own ray traversal (SweepAndPrune's CastRayClosest is the default, which sorts CastRay's results).
+static const SpatialPartitionTypes::Types cRayQueryTestTypes[] =
+{
+  SpatialPartitionTypes::AabbTree, SpatialPartitionTypes::LinearBvh, SpatialPartitionTypes::HashGrid,
+  SpatialPartitionTypes::HierarchicalHashGrid, SpatialPartitionTypes::LooseOctree, SpatialPartitionTypes::WideBvh,
+  SpatialPartitionTypes::QuantizedBvh, SpatialPartitionTypes::FlatBvh, SpatialPartitionTypes::SweepAndPrune
+};
+
+void CastRayClosestTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  for(size_t i = 0; i < sizeof(cRayQueryTestTypes) / sizeof(cRayQueryTestTypes[0]); ++i)
+    TestCastRayClosest(cRayQueryTestTypes[i], 40 + static_cast<unsigned int>(i), file);
+}
+
+//-----------------------------------------------------------------------------Any Hit Ray Tests
+static bool AnyResultBefore(const std::vector<CastResult>& expected, float maxT)
+{
+  for(size_t i = 0; i < expected.size(); ++i)
+  {
+    if(expected[i].mTime <= maxT)
+      return true;
+  }
+  return false;
+}
+
+// Prints whether each ray (with a random max time) hits anything exactly when one of the NSquared
+// reference's hits is within the max time, with and without a refiner.
+static void PrintCastRayAny(PartitionComparison& comparison, size_t rayCount, FILE* file)
+{
+  std::vector<Aabb> bounds;
+  comparison.GetBounds(bounds);
+  TestRayRefiner refiner(bounds);
+
+  unsigned int seed = comparison.mSeed;
+  size_t hitCount = 0;
+  size_t refinedHitCount = 0;
+  bool matches = true;
+  bool refinedMatches = true;
+  for(size_t i = 0; i < rayCount; ++i)
+  {
+    Ray ray = GenerateTestRay(comparison.mWorldHalfSize, seed);
+    float maxT = TestRandom(seed, 0.0f, 10.0f);
+    std::vector<CastResult> expected;
+    comparison.GetExpectedCastRay(ray, bounds, expected);
+    std::vector<CastResult> expectedRefined;
+    for(size_t j = 0; j < expected.size(); ++j)
+    {
+      float t;
+      if(refiner.Refine(ray, expected[j].mClientData, t))
+        expectedRefined.push_back(CastResult(expected[j].mClientData, t));
+    }
+
+    bool hit = comparison.mPartition->CastRayAny(ray, maxT);
+    matches = matches && hit == AnyResultBefore(expected, maxT);
+    hitCount += hit ? 1 : 0;
+
+    bool refinedHit = comparison.mPartition->CastRayAny(ray, maxT, &refiner);
+    refinedMatches = refinedMatches && refinedHit == AnyResultBefore(expectedRefined, maxT);
+    refinedHitCount += refinedHit ? 1 : 0;
+  }
+
+  if(file == NULL)
+    return;
+
+  fprintf(file, "    CastRayAny hits: %d Matches NSquared: %s\n", static_cast<int>(hitCount), matches ? "true" : "false");
+  fprintf(file, "    Refined hits: %d Matches NSquared: %s\n", static_cast<int>(refinedHitCount), refinedMatches ? "true" : "false");
+}
+
+static void TestCastRayAny(SpatialPartitionTypes::Types type, unsigned int seed, FILE* file)
+{
+  bool canChurn = CanChurnTestPartition(type);
+  PartitionComparison comparison(CreateTestPartition(type), 800, 20.0f, 1.5f, seed);
+  comparison.Insert(!canChurn);
+  PrintPartitionName(*comparison.mPartition, file);
+  PrintCastRayAny(comparison, 100, file);
+  if(!canChurn)
+    return;
+
+  comparison.Churn(2.0f);
+  if(file != NULL)
+    fprintf(file, "  After moving objects:\n");
+  PrintCastRayAny(comparison, 100, file);
+}
+
+void CastRayAnyTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  for(size_t i = 0; i < sizeof(cRayQueryTestTypes) / sizeof(cRayQueryTestTypes[0]); ++i)
+    TestCastRayAny(cRayQueryTestTypes[i], 50 + static_cast<unsigned int>(i), file);
+}
+
+//-----------------------------------------------------------------------------CastAabb Tests
+// Prints whether each swept box's hits and their times match the NSquared reference's objects whose
+// stored bounds the box touches. Every fourth box doesn't move (so it only finds what it overlaps).
+static void PrintCastAabb(PartitionComparison& comparison, size_t sweepCount, FILE* file)
+{
+  std::vector<Aabb> bounds;
+  comparison.GetBounds(bounds);
+
+  unsigned int seed = comparison.mSeed;
+  size_t hitCount = 0;
+  bool matches = true;
+  for(size_t i = 0; i < sweepCount; ++i)
+  {
+    Aabb start = GenerateTestAabb(comparison.mWorldHalfSize, 2.0f * comparison.mMaxHalfSize, seed);
+    Vector3 displacement(0, 0, 0);
+    if(i % 4 != 0)
+    {
+      for(int axis = 0; axis < 3; ++axis)
+        displacement[axis] = TestRandom(seed, -15.0f, 15.0f);
+    }
+
+    CastResults results;
+    comparison.mPartition->CastAabb(start, displacement, results);
+    std::sort(results.mResults.begin(), results.mResults.end(), CastResultIdLess);
+
+    SweptAabbQuery query(start, displacement);
+    CastResults candidates;
+    comparison.mReference.CastAabb(start, displacement, candidates);
+    std::vector<CastResult> expected;
+    for(size_t j = 0; j < candidates.mResults.size(); ++j)
+    {
+      void* clientData = candidates.mResults[j].mClientData;
+      float t;
+      if(query.Cast(bounds[GetTestId(clientData)], t))
+        expected.push_back(CastResult(clientData, t));
+    }
+    std::sort(expected.begin(), expected.end(), CastResultIdLess);
+
+    matches = matches && CastResultsMatch(results.mResults, expected);
+    hitCount += results.mResults.size();
+  }
+
+  if(file != NULL)
+    fprintf(file, "    CastAabb hits: %d Matches NSquared: %s\n", static_cast<int>(hitCount), matches ? "true" : "false");
+}
+
+static void TestCastAabb(SpatialPartitionTypes::Types type, unsigned int seed, FILE* file)
+{
+  bool canChurn = CanChurnTestPartition(type);
+  PartitionComparison comparison(CreateTestPartition(type), 800, 20.0f, 1.5f, seed);
+  comparison.Insert(!canChurn);
+  PrintPartitionName(*comparison.mPartition, file);
+  PrintCastAabb(comparison, 60, file);
+  if(!canChurn)
+    return;
+
+  comparison.Churn(2.0f);
+  if(file != NULL)
+    fprintf(file, "  After moving objects:\n");
+  PrintCastAabb(comparison, 60, file);
+}
+
+// The aabb tree has its own CastAabb, the rest walk their hierarchy or test every object (the default).
+void CastAabbTest(const std::string& testName, int debuggingIndex, FILE* file = NULL)
+{
+  PrintTestHeader(file, testName);
+  for(size_t i = 0; i < sizeof(cRayQueryTestTypes) / sizeof(cRayQueryTestTypes[0]); ++i)
+    TestCastAabb(cRayQueryTestTypes[i], 60 + static_cast<unsigned int>(i), file);
+}
 
 void InitializeAssignment3Tests()
 {
   mTestFns.push_back(AssignmentUnitTestList());
   AssignmentUnitTestList& list = mTestFns[2];
+
+  DeclareSimpleUnitTest(DynamicAabbTreeBuildTest, list);
+  DeclareSimpleUnitTest(DynamicAabbTreeBuildEmptyTest, list);
+  DeclareSimpleUnitTest(DynamicAabbTreeRefitModeTest, list);
+  DeclareSimpleUnitTest(DynamicAabbTreeRotationsTest, list);
+  DeclareSimpleUnitTest(SweepAndPruneTest, list);
+  DeclareSimpleUnitTest(SweepAndPruneBuildTest, list);
+  DeclareSimpleUnitTest(HashGridTest, list);
+  DeclareSimpleUnitTest(HashGridOversizedTest, list);
+  DeclareSimpleUnitTest(HierarchicalHashGridTest, list);
+  DeclareSimpleUnitTest(BatchDynamicAabbTreeTest, list);
+  DeclareSimpleUnitTest(BatchSweepAndPruneTest, list);
+  DeclareSimpleUnitTest(BatchDefaultTest, list);
+  DeclareSimpleUnitTest(CastRaysTest, list);
+  DeclareSimpleUnitTest(PairCacheTest, list);
+  DeclareSimpleUnitTest(PairCacheDuplicatesTest, list);
+  DeclareSimpleUnitTest(ParallelSelfQueryDynamicAabbTreeTest, list);
+  DeclareSimpleUnitTest(ParallelSelfQueryLinearBvhTest, list);
+  DeclareSimpleUnitTest(ParallelSelfQueryLooseOctreeTest, list);
+  DeclareSimpleUnitTest(QueryNearestTest, list);
+  DeclareSimpleUnitTest(QueryNearestNSquaredTest, list);
+  DeclareSimpleUnitTest(QueryPartitionsTest, list);
+  DeclareSimpleUnitTest(QueryPartitionsNSquaredTest, list);
+  DeclareSimpleUnitTest(FlatBvhBuildRoundTripTest, list);
+  DeclareSimpleUnitTest(FlatBvhFlattenRoundTripTest, list);
+  DeclareSimpleUnitTest(FlatBvhEmptyRoundTripTest, list);
+  DeclareSimpleUnitTest(CastRayClosestTest, list);
+  DeclareSimpleUnitTest(CastRayAnyTest, list);
+  DeclareSimpleUnitTest(CastAabbTest, list);
 }
@@ -7,10 +7,29 @@
 #include "Precompiled.hpp"
 
 const float DynamicAabbTree::mFatteningFactor = 1.1f;
+const unsigned int DynamicAabbTree::cInvalidNode = (unsigned int)-1;
+const float DynamicAabbTree::cDefaultRebuildCostRatio = 1.5f;
+const float DynamicAabbTree::cBatchRebuildFraction = 0.25f;
+
+// Leaves store a slightly larger aabb than the object so small movements don't require a re-insert.
+static Aabb FattenAabb(const Aabb& aabb)
+{
+  return Aabb::BuildFromCenterAndHalfExtents(aabb.GetCenter(), aabb.GetHalfSize() * DynamicAabbTree::mFatteningFactor);
+}
 
 DynamicAabbTree::DynamicAabbTree()
 {
   mType = SpatialPartitionTypes::AabbTree;
+  mRoot = cInvalidNode;
+  mFreeList = cInvalidNode;
+  mLeafCount = 0;
+  mUseRotations = false;
+  mRotationCursor = 0;
+  mRefitMode = false;
+  mRebuildCostRatio = cDefaultRebuildCostRatio;
+  mTotalArea = -1.0f;
+  mBaselineSahCost = 0.0f;
+  mSelfQuerySplitDepth = cDefaultSelfQuerySplitDepth;
 }
 
 DynamicAabbTree::~DynamicAabbTree()
@@ -19,41 +38,1176 @@ DynamicAabbTree::~DynamicAabbTree()
 
 void DynamicAabbTree::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
 {
-  Warn("Assignment3: Required function un-implemented");
+  unsigned int leaf = AllocateNode();
+  Node& node = mNodes[leaf];
+  node.mAabb = FattenAabb(data.mAabb);
+  node.mClientData = data.mClientData;
+
+  InsertLeaf(leaf);
+  ++mLeafCount;
+  mTotalArea = -1.0f;
+  key.mUIntKey = leaf;
 }
 
 void DynamicAabbTree::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
 {
-  Warn("Assignment3: Required function un-implemented");
+  unsigned int leaf = key.mUIntKey;
+  Node& node = mNodes[leaf];
+  node.mClientData = data.mClientData;
+
+  // The fat aabb still bounds the object so the tree doesn't need to change
+  if(node.mAabb.Contains(data.mAabb))
+    return;
+
+  if(mRefitMode)
+  {
+    Aabb fatAabb = FattenAabb(data.mAabb);
+    if(mTotalArea >= 0.0f)
+      mTotalArea += fatAabb.GetSurfaceArea() - node.mAabb.GetSurfaceArea();
+    node.mAabb = fatAabb;
+    mDirtyLeaves.push_back(leaf);
+    return;
+  }
+
+  RemoveLeaf(leaf);
+  mNodes[leaf].mAabb = FattenAabb(data.mAabb);
+  InsertLeaf(leaf);
 }
 
 void DynamicAabbTree::RemoveData(SpatialPartitionKey& key)
 {
-  Warn("Assignment3: Required function un-implemented");
+  unsigned int leaf = key.mUIntKey;
+  RemoveLeaf(leaf);
+  FreeNode(leaf);
+  --mLeafCount;
+  mTotalArea = -1.0f;
+}
+
+void DynamicAabbTree::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  mNodes.clear();
+  mRoot = cInvalidNode;
+  mFreeList = cInvalidNode;
+  mLeafCount = count;
+  mDirtyLeaves.clear();
+  mTotalArea = -1.0f;
+  mBaselineSahCost = 0.0f;
+  if(count == 0)
+    return;
+
+  // Leaves take the first count slots (in input order) followed by all internal nodes
+  mNodes.reserve(2 * count - 1);
+  std::vector<BuildItem> items(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    unsigned int leaf = AllocateNode();
+    mNodes[leaf].mAabb = data[i].mAabb;
+    mNodes[leaf].mClientData = data[i].mClientData;
+
+    items[i].mAabb = data[i].mAabb;
+    items[i].mCenter = data[i].mAabb.GetCenter();
+    items[i].mNode = leaf;
+
+    if(keys != nullptr)
+      keys[i].mUIntKey = leaf;
+  }
+
+  mRoot = BuildRange(items, 0, count);
+  mNodes[mRoot].mParent = cInvalidNode;
+}
+
+void DynamicAabbTree::InsertBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count)
+{
+  if(!ShouldRebuildForBatch(count))
+  {
+    SpatialPartition::InsertBatch(keys, data, count);
+    return;
+  }
+
+  // Allocate all of the leaves unlinked and let the rebuild place them
+  for(size_t i = 0; i < count; ++i)
+  {
+    unsigned int leaf = AllocateNode();
+    mNodes[leaf].mAabb = FattenAabb(data[i].mAabb);
+    mNodes[leaf].mClientData = data[i].mClientData;
+    keys[i].mUIntKey = leaf;
+  }
+  mLeafCount += count;
+  Rebuild();
+}
+
+void DynamicAabbTree::UpdateBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count)
+{
+  // Refit mode already defers all restructuring to the next refit
+  if(mRefitMode)
+  {
+    SpatialPartition::UpdateBatch(keys, data, count);
+    return;
+  }
+
+  // Only the leaves that left their fat aabb have to move in the tree
+  std::vector<size_t> moved;
+  for(size_t i = 0; i < count; ++i)
+  {
+    Node& node = mNodes[keys[i].mUIntKey];
+    node.mClientData = data[i].mClientData;
+    if(!node.mAabb.Contains(data[i].mAabb))
+      moved.push_back(i);
+  }
+
+  if(!ShouldRebuildForBatch(moved.size()))
+  {
+    for(size_t i = 0; i < moved.size(); ++i)
+    {
+      unsigned int leaf = keys[moved[i]].mUIntKey;
+      RemoveLeaf(leaf);
+      mNodes[leaf].mAabb = FattenAabb(data[moved[i]].mAabb);
+      InsertLeaf(leaf);
+    }
+    return;
+  }
+
+  for(size_t i = 0; i < moved.size(); ++i)
+    mNodes[keys[moved[i]].mUIntKey].mAabb = FattenAabb(data[moved[i]].mAabb);
+  Rebuild();
+}
+
+void DynamicAabbTree::RemoveBatch(SpatialPartitionKey* keys, size_t count)
+{
+  if(!ShouldRebuildForBatch(count))
+  {
+    SpatialPartition::RemoveBatch(keys, count);
+    return;
+  }
+
+  // Freed leaves are skipped by the rebuild so they don't need to be unlinked first
+  for(size_t i = 0; i < count; ++i)
+    FreeNode(keys[i].mUIntKey);
+  mLeafCount -= count;
+  Rebuild();
 }
 
 void DynamicAabbTree::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
 {
-  Warn("Assignment3: Required function un-implemented");
+  RefitDirty();
+  if(mRoot != cInvalidNode)
+    DebugDraw(mRoot, 0, level, transform, color, bitMask);
 }
 
 void DynamicAabbTree::CastRay(const Ray& ray, CastResults& results)
 {
-  Warn("Assignment3: Required function un-implemented");
+  RefitDirty();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mRoot == cInvalidNode)
+    return;
+
+  std::vector<unsigned int> stack;
+  stack.push_back(mRoot);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+    QueryStatistic(statistics.Visit(node.IsLeaf(), stack.size() + 1));
+
+    float t;
+    if(!RayAabb(ray.mStart, ray.mDirection, node.mAabb.mMin, node.mAabb.mMax, t))
+      continue;
+
+    if(node.IsLeaf())
+    {
+      results.AddResult(CastResult(node.mClientData, t));
+      continue;
+    }
+
+    stack.push_back(node.mRight);
+    stack.push_back(node.mLeft);
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool DynamicAabbTree::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  RefitDirty();
+  float t;
+  if(mRoot == cInvalidNode || !RayAabb(ray.mStart, ray.mDirection, mNodes[mRoot].mAabb.mMin, mNodes[mRoot].mAabb.mMax, t))
+    return false;
+
+  // Each entry is a node the ray hits and the time it enters it
+  ClosestHitQuery query(ray, refiner);
+  std::vector<std::pair<unsigned int, float> > stack;
+  stack.push_back(std::make_pair(mRoot, t));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    float tEnter = stack.back().second;
+    stack.pop_back();
+
+    // A closer hit may have been found since the node was pushed
+    if(tEnter >= query.GetMaxTime())
+      continue;
+
+    if(node.IsLeaf())
+    {
+      query.AddObject(node.mClientData, tEnter);
+      continue;
+    }
+
+    const Aabb& left = mNodes[node.mLeft].mAabb;
+    const Aabb& right = mNodes[node.mRight].mAabb;
+    float tLeft, tRight;
+    bool hitLeft = RayAabb(ray.mStart, ray.mDirection, left.mMin, left.mMax, tLeft) && tLeft < query.GetMaxTime();
+    bool hitRight = RayAabb(ray.mStart, ray.mDirection, right.mMin, right.mMax, tRight) && tRight < query.GetMaxTime();
+
+    // Push the farther child first so the nearer one is visited next
+    if(hitLeft && hitRight && tLeft < tRight)
+    {
+      stack.push_back(std::make_pair(node.mRight, tRight));
+      stack.push_back(std::make_pair(node.mLeft, tLeft));
+      continue;
+    }
+    if(hitLeft)
+      stack.push_back(std::make_pair(node.mLeft, tLeft));
+    if(hitRight)
+      stack.push_back(std::make_pair(node.mRight, tRight));
+  }
+  return query.GetResult(result);
+}
+
+bool DynamicAabbTree::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  RefitDirty();
+  if(mRoot == cInvalidNode)
+    return false;
+
+  AnyHitQuery query(ray, maxT, refiner);
+  std::vector<unsigned int> stack;
+  stack.push_back(mRoot);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float t;
+    if(!RayAabb(ray.mStart, ray.mDirection, node.mAabb.mMin, node.mAabb.mMax, t) || t > maxT)
+      continue;
+
+    if(node.IsLeaf())
+    {
+      if(query.IsHit(node.mClientData, t))
+        return true;
+      continue;
+    }
+
+    stack.push_back(node.mRight);
+    stack.push_back(node.mLeft);
+  }
+  return false;
+}
+
+void DynamicAabbTree::CastAabb(const Aabb& start, const Vector3& displacement, CastResults& results)
+{
+  RefitDirty();
+  if(mRoot == cInvalidNode)
+    return;
+
+  SweptAabbQuery query(start, displacement);
+  std::vector<unsigned int> stack;
+  stack.push_back(mRoot);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float t;
+    if(!query.Cast(node.mAabb, t))
+      continue;
+
+    if(node.IsLeaf())
+    {
+      results.AddResult(CastResult(node.mClientData, t));
+      continue;
+    }
+
+    stack.push_back(node.mRight);
+    stack.push_back(node.mLeft);
+  }
+}
+
+void DynamicAabbTree::CastRays(const Ray* rays, size_t count, CastResults* results)
+{
+  RefitDirty();
+  if(mRoot == cInvalidNode)
+    return;
+
+  // Each entry is a node and the rays of the packet that reached it
+  std::vector<std::pair<unsigned int, int> > stack;
+  for(size_t first = 0; first < count; first += RayPacket::cWidth)
+  {
+    RayPacket packet;
+    packet.Load(rays + first, Math::Min(count - first, static_cast<size_t>(RayPacket::cWidth)));
+
+    stack.push_back(std::make_pair(mRoot, packet.mMask));
+    while(!stack.empty())
+    {
+      const Node& node = mNodes[stack.back().first];
+      int mask = packet.TestAabb(node.mAabb, stack.back().second);
+      stack.pop_back();
+      if(mask == 0)
+        continue;
+
+      if(node.IsLeaf())
+      {
+        // Confirm each ray with the scalar test so the hits and times match CastRay
+        for(int lane = 0; lane < RayPacket::cWidth; ++lane)
+        {
+          if((mask & (1 << lane)) == 0)
+            continue;
+
+          const Ray& ray = rays[first + lane];
+          float t;
+          if(RayAabb(ray.mStart, ray.mDirection, node.mAabb.mMin, node.mAabb.mMax, t))
+            results[first + lane].AddResult(CastResult(node.mClientData, t));
+        }
+        continue;
+      }
+
+      stack.push_back(std::make_pair(node.mRight, mask));
+      stack.push_back(std::make_pair(node.mLeft, mask));
+    }
+  }
 }
 
 void DynamicAabbTree::CastFrustum(const Frustum& frustum, CastResults& results)
 {
-  Warn("Assignment3: Required function un-implemented");
+  RefitDirty();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mRoot == cInvalidNode)
+    return;
+
+  const Vector4* planes = frustum.GetPlanes();
+  mLastFrustumPlanes.resize(mNodes.size(), 0);
+
+  // Each entry is a node and the planes it still has to be tested against
+  std::vector<std::pair<unsigned int, int> > stack;
+  stack.push_back(std::make_pair(mRoot, cAllFrustumPlanes));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    int planeMask = stack.back().second;
+    stack.pop_back();
+    const Node& node = mNodes[index];
+    QueryStatistic(statistics.Visit(node.IsLeaf(), stack.size() + 1));
+
+    size_t lastAxis = mLastFrustumPlanes[index];
+    IntersectionType::Type type = FrustumAabb(planes, node.mAabb.mMin, node.mAabb.mMax, lastAxis, planeMask);
+    if(type == IntersectionType::Outside)
+    {
+      mLastFrustumPlanes[index] = static_cast<unsigned char>(lastAxis);
+      continue;
+    }
+
+    // Everything below a fully contained node is also contained
+    if(type == IntersectionType::Inside || node.IsLeaf())
+    {
+      AddAllLeaves(index, results);
+      continue;
+    }
+
+    stack.push_back(std::make_pair(node.mRight, planeMask));
+    stack.push_back(std::make_pair(node.mLeft, planeMask));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void DynamicAabbTree::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  RefitDirty();
+  if(mRoot == cInvalidNode)
+    return;
+
+  NearestQuery query(point, k, maxDistance);
+  NearestNodeQueue queue;
+  queue.Push(mNodes[mRoot].mAabb.GetDistanceSquared(point), mRoot);
+
+  unsigned int index;
+  while(queue.Pop(query, index))
+  {
+    const Node& node = mNodes[index];
+    if(node.IsLeaf())
+    {
+      query.AddObject(node.mClientData, node.mAabb);
+      continue;
+    }
+
+    // Leaf children go straight into the query instead of through the queue
+    unsigned int children[2] = {node.mLeft, node.mRight};
+    for(int i = 0; i < 2; ++i)
+    {
+      const Node& child = mNodes[children[i]];
+      float distanceSq = child.mAabb.GetDistanceSquared(point);
+      if(child.IsLeaf())
+        query.AddObject(child.mClientData, distanceSq);
+      else if(distanceSq <= query.GetMaxDistanceSq())
+        queue.Push(distanceSq, children[i]);
+    }
+  }
+  query.GetResults(results);
+}
+
+void DynamicAabbTree::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  RefitDirty();
+  if(mRoot == cInvalidNode)
+    return;
+
+  std::vector<unsigned int> stack;
+  stack.push_back(mRoot);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    // Leaves only need the overlap test
+    if(node.IsLeaf())
+    {
+      if(region.Overlaps(node.mAabb))
+        results.AddResult(CastResult(node.mClientData, 0.0f));
+      continue;
+    }
+
+    IntersectionType::Type type = region.Classify(node.mAabb);
+    if(type == IntersectionType::Outside)
+      continue;
+
+    if(type == IntersectionType::Inside)
+    {
+      AddAllLeaves(index, results);
+      continue;
+    }
+
+    stack.push_back(node.mRight);
+    stack.push_back(node.mLeft);
+  }
 }
 
 void DynamicAabbTree::SelfQuery(QueryResults& results)
 {
-  Warn("Assignment3: Required function un-implemented");
+  RefitDirty();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mRoot == cInvalidNode)
+    return;
+
+  std::vector<SelfQueryTask> tasks;
+  size_t threadCount = GetSelfQueryThreadCount(mLeafCount);
+  SelfQueryWorker splitter(mType);
+  if(threadCount == 1)
+    tasks.push_back(SelfQueryTask(mRoot, mRoot));
+  else
+    SplitSelfQuery(mRoot, mRoot, mSelfQuerySplitDepth, tasks, splitter);
+  splitter.Flush(results);
+
+  RunSelfQueryTasks(tasks, threadCount, [this](const SelfQueryTask& task, SelfQueryWorker& worker)
+  {
+    if(task.mIndexA == task.mIndexB)
+      SelfQuery(task.mIndexA, worker);
+    else
+      SelfQuery(task.mIndexA, task.mIndexB, worker);
+  }, results, mType);
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool DynamicAabbTree::GetHierarchyRoot(HierarchyNode& root)
+{
+  RefitDirty();
+  if(mRoot == cInvalidNode)
+    return false;
+
+  const Node& node = mNodes[mRoot];
+  root.mAabb = node.mAabb;
+  root.mIndex = mRoot;
+  root.mIsObject = node.IsLeaf();
+  root.mClientData = node.mClientData;
+  return true;
+}
+
+void DynamicAabbTree::GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const
+{
+  unsigned int nodeChildren[2] = {mNodes[node.mIndex].mLeft, mNodes[node.mIndex].mRight};
+  for(int i = 0; i < 2; ++i)
+  {
+    const Node& child = mNodes[nodeChildren[i]];
+    HierarchyNode result;
+    result.mAabb = child.mAabb;
+    result.mIndex = nodeChildren[i];
+    result.mIsObject = child.IsLeaf();
+    result.mClientData = child.mClientData;
+    children.push_back(result);
+  }
+}
+
+void DynamicAabbTree::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Node& node = mNodes[key.mUIntKey];
+  data.mClientData = node.mClientData;
+  data.mAabb = node.mAabb;
 }
 
 void DynamicAabbTree::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
 {
-  Warn("Assignment3: Required function un-implemented");
+  if(mRoot != cInvalidNode)
+    FilloutData(mRoot, 0, results);
 }
 
+size_t DynamicAabbTree::GetMemoryUsage() const
+{
+  return sizeof(*this) + mNodes.capacity() * sizeof(Node) + mDirtyLeaves.capacity() * sizeof(unsigned int) +
+         mRefitMarks.capacity() + mLastFrustumPlanes.capacity();
+}
+
+float DynamicAabbTree::GetSahCost() const
+{
+  if(mRoot == cInvalidNode)
+    return 0.0f;
+
+  float rootArea = mNodes[mRoot].mAabb.GetSurfaceArea();
+  if(rootArea <= 0.0f)
+    return 0.0f;
+
+  return GetTotalArea() / rootArea;
+}
+
+void DynamicAabbTree::SetRefitMode(bool refitMode)
+{
+  if(!refitMode)
+    RefitDirty();
+  mRefitMode = refitMode;
+}
+
+void DynamicAabbTree::RefitDirty()
+{
+  if(mDirtyLeaves.empty())
+    return;
+
+  // Everything queued was removed since, there's nothing left to refit
+  if(mRoot == cInvalidNode)
+  {
+    mDirtyLeaves.clear();
+    return;
+  }
+
+  // Collect every ancestor of a dirty leaf once. A walk can stop at the first node
+  // that is already queued since everything above it is queued as well.
+  mRefitMarks.resize(mNodes.size(), 0);
+  std::vector<unsigned int> touched;
+  for(size_t i = 0; i < mDirtyLeaves.size(); ++i)
+  {
+    // Skip leaves that were removed (and possibly re-used as an internal node) after being queued
+    const Node& leaf = mNodes[mDirtyLeaves[i]];
+    if(!leaf.IsLeaf() || leaf.mHeight != 0)
+      continue;
+
+    unsigned int index = leaf.mParent;
+    while(index != cInvalidNode && mRefitMarks[index] == 0)
+    {
+      mRefitMarks[index] = 1;
+      touched.push_back(index);
+      index = mNodes[index].mParent;
+    }
+  }
+  mDirtyLeaves.clear();
+
+  // A node's height is always larger than its children's so refitting in order
+  // of increasing height only ever combines children that are already up to date.
+  std::sort(touched.begin(), touched.end(),
+    [this](unsigned int lhs, unsigned int rhs)
+    {
+      return mNodes[lhs].mHeight < mNodes[rhs].mHeight;
+    });
+
+  float areaDelta = 0.0f;
+  for(size_t i = 0; i < touched.size(); ++i)
+  {
+    unsigned int index = touched[i];
+    Node& node = mNodes[index];
+    float oldArea = node.mAabb.GetSurfaceArea();
+    node.mAabb = Aabb::Combine(mNodes[node.mLeft].mAabb, mNodes[node.mRight].mAabb);
+    areaDelta += node.mAabb.GetSurfaceArea() - oldArea;
+    mRefitMarks[index] = 0;
+  }
+
+  // Inserts and removes invalidate the running total, so only then is the full sum needed
+  if(mTotalArea < 0.0f)
+    mTotalArea = GetTotalArea();
+  else
+    mTotalArea += areaDelta;
+
+  float rootArea = mNodes[mRoot].mAabb.GetSurfaceArea();
+  if(rootArea <= 0.0f)
+    return;
+
+  float sahCost = mTotalArea / rootArea;
+  if(mBaselineSahCost <= 0.0f)
+    mBaselineSahCost = sahCost;
+  else if(sahCost > mBaselineSahCost * mRebuildCostRatio)
+    Rebuild();
+}
+
+void DynamicAabbTree::Rebuild()
+{
+  mDirtyLeaves.clear();
+
+  // Free every internal node and rebuild over the existing (linked or not) leaves in place
+  std::vector<BuildItem> items;
+  for(size_t i = 0; i < mNodes.size(); ++i)
+  {
+    const Node& node = mNodes[i];
+    if(node.mHeight < 0)
+      continue;
+
+    if(!node.IsLeaf())
+    {
+      FreeNode(static_cast<unsigned int>(i));
+      continue;
+    }
+
+    BuildItem item;
+    item.mAabb = node.mAabb;
+    item.mCenter = node.mAabb.GetCenter();
+    item.mNode = static_cast<unsigned int>(i);
+    items.push_back(item);
+  }
+
+  mRoot = cInvalidNode;
+  mTotalArea = -1.0f;
+  mBaselineSahCost = 0.0f;
+  if(items.empty())
+    return;
+
+  mRoot = BuildRange(items, 0, items.size());
+  mNodes[mRoot].mParent = cInvalidNode;
+
+  mTotalArea = GetTotalArea();
+  mBaselineSahCost = GetSahCost();
+}
+
+void DynamicAabbTree::Optimize(int rotationBudget)
+{
+  // Rotations pick swaps by comparing bounds so they have to be current
+  RefitDirty();
+
+  size_t nodeCount = mNodes.size();
+  for(size_t visited = 0; visited < nodeCount && rotationBudget > 0; ++visited)
+  {
+    if(mRotationCursor >= nodeCount)
+      mRotationCursor = 0;
+    unsigned int index = mRotationCursor++;
+
+    // Skip free nodes (-1) and leaves (0)
+    if(mNodes[index].mHeight < 1)
+      continue;
+
+    --rotationBudget;
+    if(Rotate(index))
+      SyncHeights(mNodes[index].mParent);
+  }
+}
+
+float DynamicAabbTree::GetTotalArea() const
+{
+  // Free nodes are marked with a negative height
+  float totalArea = 0.0f;
+  for(size_t i = 0; i < mNodes.size(); ++i)
+  {
+    if(mNodes[i].mHeight >= 0)
+      totalArea += mNodes[i].mAabb.GetSurfaceArea();
+  }
+  return totalArea;
+}
+
+bool DynamicAabbTree::ShouldRebuildForBatch(size_t count) const
+{
+  return count != 0 && static_cast<float>(count) >= cBatchRebuildFraction * static_cast<float>(mLeafCount);
+}
+
+unsigned int DynamicAabbTree::AllocateNode()
+{
+  unsigned int index;
+  if(mFreeList == cInvalidNode)
+  {
+    index = static_cast<unsigned int>(mNodes.size());
+    mNodes.push_back(Node());
+  }
+  else
+  {
+    index = mFreeList;
+    mFreeList = mNodes[index].mParent;
+  }
+
+  Node& node = mNodes[index];
+  node.mAabb = Aabb();
+  node.mClientData = nullptr;
+  node.mParent = cInvalidNode;
+  node.mLeft = cInvalidNode;
+  node.mRight = cInvalidNode;
+  node.mHeight = 0;
+  return index;
+}
+
+void DynamicAabbTree::FreeNode(unsigned int index)
+{
+  Node& node = mNodes[index];
+  node.mClientData = nullptr;
+  node.mLeft = cInvalidNode;
+  node.mRight = cInvalidNode;
+  node.mHeight = -1;
+  node.mParent = mFreeList;
+  mFreeList = index;
+}
+
+void DynamicAabbTree::InsertLeaf(unsigned int leaf)
+{
+  if(mRoot == cInvalidNode)
+  {
+    mRoot = leaf;
+    mNodes[leaf].mParent = cInvalidNode;
+    return;
+  }
+
+  // Walk down choosing the child whose surface area grows the least
+  Aabb leafAabb = mNodes[leaf].mAabb;
+  unsigned int sibling = mRoot;
+  while(!mNodes[sibling].IsLeaf())
+  {
+    const Node& node = mNodes[sibling];
+    const Aabb& left = mNodes[node.mLeft].mAabb;
+    const Aabb& right = mNodes[node.mRight].mAabb;
+
+    float leftCost = Aabb::Combine(left, leafAabb).GetSurfaceArea() - left.GetSurfaceArea();
+    float rightCost = Aabb::Combine(right, leafAabb).GetSurfaceArea() - right.GetSurfaceArea();
+    sibling = (leftCost < rightCost) ? node.mLeft : node.mRight;
+  }
+
+  // Replace the sibling with a new parent of the sibling and the leaf.
+  // Allocating can grow the pool so no node references are held across this.
+  unsigned int oldParent = mNodes[sibling].mParent;
+  unsigned int newParent = AllocateNode();
+
+  Node& parent = mNodes[newParent];
+  parent.mParent = oldParent;
+  parent.mLeft = sibling;
+  parent.mRight = leaf;
+  mNodes[sibling].mParent = newParent;
+  mNodes[leaf].mParent = newParent;
+
+  if(oldParent == cInvalidNode)
+    mRoot = newParent;
+  else if(mNodes[oldParent].mLeft == sibling)
+    mNodes[oldParent].mLeft = newParent;
+  else
+    mNodes[oldParent].mRight = newParent;
+
+  SyncHierarchy(newParent);
+}
+
+void DynamicAabbTree::RemoveLeaf(unsigned int leaf)
+{
+  if(leaf == mRoot)
+  {
+    mRoot = cInvalidNode;
+    return;
+  }
+
+  unsigned int parent = mNodes[leaf].mParent;
+  unsigned int grandParent = mNodes[parent].mParent;
+  unsigned int sibling = (mNodes[parent].mLeft == leaf) ? mNodes[parent].mRight : mNodes[parent].mLeft;
+
+  // The sibling takes the parent's place
+  mNodes[sibling].mParent = grandParent;
+  mNodes[leaf].mParent = cInvalidNode;
+  FreeNode(parent);
+
+  if(grandParent == cInvalidNode)
+  {
+    mRoot = sibling;
+    return;
+  }
+
+  if(mNodes[grandParent].mLeft == parent)
+    mNodes[grandParent].mLeft = sibling;
+  else
+    mNodes[grandParent].mRight = sibling;
+
+  SyncHierarchy(grandParent);
+}
+
+void DynamicAabbTree::SyncHierarchy(unsigned int index)
+{
+  while(index != cInvalidNode)
+  {
+    Node& node = mNodes[index];
+    const Node& left = mNodes[node.mLeft];
+    const Node& right = mNodes[node.mRight];
+    node.mAabb = Aabb::Combine(left.mAabb, right.mAabb);
+    node.mHeight = 1 + Math::Max(left.mHeight, right.mHeight);
+
+    if(mUseRotations)
+      Rotate(index);
+    else
+      index = Balance(index);
+    index = mNodes[index].mParent;
+  }
+}
+
+unsigned int DynamicAabbTree::Balance(unsigned int indexA)
+{
+  Node& a = mNodes[indexA];
+  if(a.IsLeaf() || a.mHeight < 2)
+    return indexA;
+
+  unsigned int indexB = a.mLeft;
+  unsigned int indexC = a.mRight;
+  Node& b = mNodes[indexB];
+  Node& c = mNodes[indexC];
+
+  int balance = c.mHeight - b.mHeight;
+  if(balance >= -1 && balance <= 1)
+    return indexA;
+
+  // Rotate the taller child up into a's place. The pivot's taller child stays with
+  // the pivot and its shorter child is handed down to a.
+  unsigned int indexPivot = (balance > 1) ? indexC : indexB;
+  unsigned int indexOther = (balance > 1) ? indexB : indexC;
+  Node& pivot = mNodes[indexPivot];
+  Node& other = mNodes[indexOther];
+
+  unsigned int indexF = pivot.mLeft;
+  unsigned int indexG = pivot.mRight;
+  if(mNodes[indexF].mHeight < mNodes[indexG].mHeight)
+    std::swap(indexF, indexG);
+  Node& tall = mNodes[indexF];
+  Node& shorter = mNodes[indexG];
+
+  pivot.mLeft = indexA;
+  pivot.mRight = indexF;
+  pivot.mParent = a.mParent;
+  a.mParent = indexPivot;
+
+  if(pivot.mParent == cInvalidNode)
+    mRoot = indexPivot;
+  else if(mNodes[pivot.mParent].mLeft == indexA)
+    mNodes[pivot.mParent].mLeft = indexPivot;
+  else
+    mNodes[pivot.mParent].mRight = indexPivot;
+
+  if(balance > 1)
+    a.mRight = indexG;
+  else
+    a.mLeft = indexG;
+  shorter.mParent = indexA;
+
+  a.mAabb = Aabb::Combine(other.mAabb, shorter.mAabb);
+  a.mHeight = 1 + Math::Max(other.mHeight, shorter.mHeight);
+  pivot.mAabb = Aabb::Combine(a.mAabb, tall.mAabb);
+  pivot.mHeight = 1 + Math::Max(a.mHeight, tall.mHeight);
+
+  return indexPivot;
+}
+
+bool DynamicAabbTree::Rotate(unsigned int index)
+{
+  const Node& node = mNodes[index];
+  if(node.IsLeaf())
+    return false;
+
+  // Try moving each child down into the other child in place of each of its children
+  float bestBenefit = 0.0f;
+  unsigned int bestChild = cInvalidNode;
+  unsigned int bestGrandChild = cInvalidNode;
+  unsigned int children[2] = {node.mLeft, node.mRight};
+  for(int side = 0; side < 2; ++side)
+  {
+    unsigned int child = children[side];
+    const Node& other = mNodes[children[1 - side]];
+    if(other.IsLeaf())
+      continue;
+
+    float otherArea = other.mAabb.GetSurfaceArea();
+    unsigned int grandChildren[2] = {other.mLeft, other.mRight};
+    for(int i = 0; i < 2; ++i)
+    {
+      // The grandchild that stays behind now shares the other child with the moved child
+      const Aabb& remaining = mNodes[grandChildren[1 - i]].mAabb;
+      float benefit = otherArea - Aabb::Combine(mNodes[child].mAabb, remaining).GetSurfaceArea();
+      if(benefit > bestBenefit)
+      {
+        bestBenefit = benefit;
+        bestChild = child;
+        bestGrandChild = grandChildren[i];
+      }
+    }
+  }
+
+  if(bestChild == cInvalidNode)
+    return false;
+
+  unsigned int indexOther = mNodes[bestGrandChild].mParent;
+  Node& parent = mNodes[index];
+  Node& other = mNodes[indexOther];
+  if(parent.mLeft == bestChild)
+    parent.mLeft = bestGrandChild;
+  else
+    parent.mRight = bestGrandChild;
+  if(other.mLeft == bestGrandChild)
+    other.mLeft = bestChild;
+  else
+    other.mRight = bestChild;
+  mNodes[bestChild].mParent = indexOther;
+  mNodes[bestGrandChild].mParent = index;
+
+  if(mTotalArea >= 0.0f)
+    mTotalArea -= bestBenefit;
+  other.mAabb = Aabb::Combine(mNodes[other.mLeft].mAabb, mNodes[other.mRight].mAabb);
+  other.mHeight = 1 + Math::Max(mNodes[other.mLeft].mHeight, mNodes[other.mRight].mHeight);
+  parent.mHeight = 1 + Math::Max(mNodes[parent.mLeft].mHeight, mNodes[parent.mRight].mHeight);
+  return true;
+}
+
+void DynamicAabbTree::SyncHeights(unsigned int index)
+{
+  while(index != cInvalidNode)
+  {
+    Node& node = mNodes[index];
+    int height = 1 + Math::Max(mNodes[node.mLeft].mHeight, mNodes[node.mRight].mHeight);
+    if(height == node.mHeight)
+      return;
+
+    node.mHeight = height;
+    index = node.mParent;
+  }
+}
+
+unsigned int DynamicAabbTree::BuildRange(std::vector<BuildItem>& items, size_t begin, size_t end)
+{
+  size_t count = end - begin;
+  if(count == 1)
+    return items[begin].mNode;
+
+  // Bins are placed over the bounds of the centers (not the aabbs) so every bin gets used.
+  // Only the axis with the largest spread of centers is binned which is nearly as good as trying all three.
+  Aabb centerBounds;
+  for(size_t i = begin; i < end; ++i)
+    centerBounds.Expand(items[i].mCenter);
+
+  Vector3 centerExtents = centerBounds.mMax - centerBounds.mMin;
+  int axis = 0;
+  if(centerExtents.y > centerExtents[axis])
+    axis = 1;
+  if(centerExtents.z > centerExtents[axis])
+    axis = 2;
+  float axisMin = centerBounds.mMin[axis];
+  float binScale = (centerExtents[axis] > 0.0f) ? cBuildBinCount / centerExtents[axis] : 0.0f;
+
+  // If every center is in the same spot there's nothing to bin so just split the range in half
+  size_t mid = begin + count / 2;
+  if(binScale > 0.0f)
+  {
+    Aabb binAabbs[cBuildBinCount];
+    size_t binCounts[cBuildBinCount] = {0};
+    for(size_t i = begin; i < end; ++i)
+    {
+      int bin = Math::Min(static_cast<int>((items[i].mCenter[axis] - axisMin) * binScale), cBuildBinCount - 1);
+      binAabbs[bin] = Aabb::Combine(binAabbs[bin], items[i].mAabb);
+      ++binCounts[bin];
+    }
+
+    // Sweep from the right to get the area/count of everything right of each boundary
+    float rightAreas[cBuildBinCount];
+    size_t rightCounts[cBuildBinCount];
+    Aabb accumulated;
+    size_t accumulatedCount = 0;
+    for(int bin = cBuildBinCount - 1; bin > 0; --bin)
+    {
+      accumulated = Aabb::Combine(accumulated, binAabbs[bin]);
+      accumulatedCount += binCounts[bin];
+      rightAreas[bin] = (accumulatedCount != 0) ? accumulated.GetSurfaceArea() : 0.0f;
+      rightCounts[bin] = accumulatedCount;
+    }
+
+    // Then sweep from the left to find the cheapest boundary where
+    // cost = area(left) * count(left) + area(right) * count(right)
+    float bestCost = Math::PositiveMax();
+    int bestBin = -1;
+    accumulated = Aabb();
+    accumulatedCount = 0;
+    for(int bin = 0; bin < cBuildBinCount - 1; ++bin)
+    {
+      accumulated = Aabb::Combine(accumulated, binAabbs[bin]);
+      accumulatedCount += binCounts[bin];
+      if(accumulatedCount == 0 || rightCounts[bin + 1] == 0)
+        continue;
+
+      float cost = accumulated.GetSurfaceArea() * accumulatedCount + rightAreas[bin + 1] * rightCounts[bin + 1];
+      if(cost < bestCost)
+      {
+        bestCost = cost;
+        bestBin = bin;
+      }
+    }
+
+    if(bestBin != -1)
+    {
+      std::vector<BuildItem>::iterator split = std::partition(items.begin() + begin, items.begin() + end,
+        [&](const BuildItem& item)
+        {
+          int bin = Math::Min(static_cast<int>((item.mCenter[axis] - axisMin) * binScale), cBuildBinCount - 1);
+          return bin <= bestBin;
+        });
+      mid = split - items.begin();
+    }
+  }
+
+  // Allocate the parent before the children so a subtree's internal nodes stay close together in memory
+  unsigned int index = AllocateNode();
+  unsigned int left = BuildRange(items, begin, mid);
+  unsigned int right = BuildRange(items, mid, end);
+
+  Node& node = mNodes[index];
+  node.mLeft = left;
+  node.mRight = right;
+  node.mAabb = Aabb::Combine(mNodes[left].mAabb, mNodes[right].mAabb);
+  node.mHeight = 1 + Math::Max(mNodes[left].mHeight, mNodes[right].mHeight);
+  mNodes[left].mParent = index;
+  mNodes[right].mParent = index;
+  return index;
+}
+
+void DynamicAabbTree::SelfQuery(unsigned int index, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  const Node& node = mNodes[index];
+  if(node.IsLeaf())
+    return;
+
+  SelfQuery(node.mLeft, worker);
+  SelfQuery(node.mRight, worker);
+  SelfQuery(node.mLeft, node.mRight, worker);
+}
+
+void DynamicAabbTree::SelfQuery(unsigned int indexA, unsigned int indexB, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  const Node& a = mNodes[indexA];
+  const Node& b = mNodes[indexB];
+  QueryStatistic(worker.mQueryStatistics.Visit(a.IsLeaf() && b.IsLeaf()));
+  if(!worker.TestAabbs(a.mAabb, b.mAabb))
+    return;
+
+  if(a.IsLeaf() && b.IsLeaf())
+  {
+    worker.AddResult(a.mClientData, b.mClientData);
+    return;
+  }
+
+  // Split the larger node (by surface area) to keep the descent balanced
+  if(b.IsLeaf() || (!a.IsLeaf() && a.mAabb.GetSurfaceArea() >= b.mAabb.GetSurfaceArea()))
+  {
+    SelfQuery(a.mLeft, indexB, worker);
+    SelfQuery(a.mRight, indexB, worker);
+  }
+  else
+  {
+    SelfQuery(indexA, b.mLeft, worker);
+    SelfQuery(indexA, b.mRight, worker);
+  }
+}
+
+void DynamicAabbTree::SplitSelfQuery(unsigned int indexA, unsigned int indexB, int depth, std::vector<SelfQueryTask>& tasks, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  if(depth <= 0)
+  {
+    tasks.push_back(SelfQueryTask(indexA, indexB));
+    return;
+  }
+
+  const Node& a = mNodes[indexA];
+  if(indexA == indexB)
+  {
+    if(a.IsLeaf())
+      return;
+
+    SplitSelfQuery(a.mLeft, a.mLeft, depth - 1, tasks, worker);
+    SplitSelfQuery(a.mRight, a.mRight, depth - 1, tasks, worker);
+    SplitSelfQuery(a.mLeft, a.mRight, depth - 1, tasks, worker);
+    return;
+  }
+
+  const Node& b = mNodes[indexB];
+  QueryStatistic(worker.mQueryStatistics.Visit(a.IsLeaf() && b.IsLeaf()));
+  if(!worker.TestAabbs(a.mAabb, b.mAabb))
+    return;
+
+  if(a.IsLeaf() && b.IsLeaf())
+  {
+    worker.AddResult(a.mClientData, b.mClientData);
+    return;
+  }
+
+  if(b.IsLeaf() || (!a.IsLeaf() && a.mAabb.GetSurfaceArea() >= b.mAabb.GetSurfaceArea()))
+  {
+    SplitSelfQuery(a.mLeft, indexB, depth - 1, tasks, worker);
+    SplitSelfQuery(a.mRight, indexB, depth - 1, tasks, worker);
+  }
+  else
+  {
+    SplitSelfQuery(indexA, b.mLeft, depth - 1, tasks, worker);
+    SplitSelfQuery(indexA, b.mRight, depth - 1, tasks, worker);
+  }
+}
+
+void DynamicAabbTree::AddAllLeaves(unsigned int index, CastResults& results) const
+{
+  const Node& node = mNodes[index];
+  if(node.IsLeaf())
+  {
+    results.AddResult(CastResult(node.mClientData, 0.0f));
+    return;
+  }
+
+  AddAllLeaves(node.mLeft, results);
+  AddAllLeaves(node.mRight, results);
+}
+
+void DynamicAabbTree::DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  const Node& node = mNodes[index];
+  if(level == -1 || level == depth)
+    gDebugDrawer->DrawAabb(node.mAabb).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+
+  if(node.IsLeaf() || (level != -1 && depth >= level))
+    return;
+
+  DebugDraw(node.mLeft, depth + 1, level, transform, color, bitMask);
+  DebugDraw(node.mRight, depth + 1, level, transform, color, bitMask);
+}
+
+void DynamicAabbTree::FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const
+{
+  const Node& node = mNodes[index];
+
+  SpatialPartitionQueryData data;
+  data.mAabb = node.mAabb;
+  data.mClientData = node.mClientData;
+  data.mDepth = depth;
+  results.push_back(data);
+
+  if(node.IsLeaf())
+    return;
+
+  FilloutData(node.mLeft, depth + 1, results);
+  FilloutData(node.mRight, depth + 1, results);
+}
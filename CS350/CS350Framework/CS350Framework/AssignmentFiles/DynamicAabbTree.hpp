@@ -8,6 +8,7 @@
 
 #include "SpatialPartition.hpp"
 #include "Shapes.hpp"
+#include "ParallelSelfQuery.hpp"
 
 /******Student:Assignment3******/
 /// You must implement a dynamic aabb tree as we discussed in class.
@@ -21,17 +22,163 @@ public:
   void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
   void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
   void RemoveData(SpatialPartitionKey& key) override;
+  // Replaces the tree with a top-down binned SAH build. Leaves are not fattened
+  // since this is meant for static data such as a model's midphase.
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+  // Batches that touch a large part of the tree (more than cBatchRebuildFraction of its leaves)
+  // apply all of their changes to the leaves first and then rebuild the internal nodes once
+  // instead of walking and re-balancing the tree per object. Smaller batches use the single versions.
+  void InsertBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count) override;
+  void UpdateBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count) override;
+  void RemoveBatch(SpatialPartitionKey* keys, size_t count) override;
 
   void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
 
   void CastRay(const Ray& ray, CastResults& results) override;
+  // Traverses with packets of RayPacket::cWidth rays, testing each node against the whole packet at once.
+  void CastRays(const Ray* rays, size_t count, CastResults* results) override;
+  // Visits the nearer child first and skips nodes entered after the closest hit so far.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Depth first, skipping nodes entered after maxT, until the first confirmed hit.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  // Same walk as CastRay but with every node grown by the box (no hierarchy copies like the default).
+  void CastAabb(const Aabb& start, const Vector3& displacement, CastResults& results) override;
+  // Children only test the planes their parent straddles and each node starts with the plane that
+  // last rejected it (see mLastFrustumPlanes).
   void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Best-first over the (fat) node bounds, closest node first. The tree only keeps the fat leaf
+  // aabbs, so objects are ranked (and reported) by the distance to those. That can be shorter than
+  // the distance to the object's real bounds, so the k results are approximate near ties.
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  // Nodes fully inside the region add their whole subtree without testing it.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
 
+  // Large trees split the top mSelfQuerySplitDepth levels of the descent into tasks and run them on
+  // every core (see ParallelSelfQuery.hpp). The pairs are the same as the serial query's.
   void SelfQuery(QueryResults& results) override;
 
+  bool GetHierarchyRoot(HierarchyNode& root) override;
+  void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
   void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+  size_t GetMemoryUsage() const override;
+
+  // Surface area heuristic cost of the tree (sum of all node surface areas relative to the root's).
+  // Roughly how many nodes a random ray through the root will visit; lower is better.
+  float GetSahCost() const;
+
+  // In refit mode UpdateData only writes the leaf's new fat aabb and queues it. The queued leaves
+  // are fixed up by RefitDirty (automatically before any query) which recomputes each ancestor once,
+  // bottom-up. Refitting never restructures the tree so when the SAH cost has grown by more than
+  // mRebuildCostRatio since the last build the whole tree is rebuilt. Turning the mode off flushes the queue.
+  void SetRefitMode(bool refitMode);
+  void RefitDirty();
+  // Rebuilds the internal nodes over the current leaves. Leaf indices (and therefore keys) are preserved.
+  void Rebuild();
+
+  // Tries a local rotation on up to rotationBudget internal nodes, resuming where the previous
+  // call stopped so repeated calls (e.g. once per frame) sweep the whole tree over time.
+  void Optimize(int rotationBudget);
 
   static const float mFatteningFactor;
+  // How many buckets each axis is split into when evaluating split planes in Build.
+  static const int cBuildBinCount = 16;
+  // Index used for a missing parent/child and for the end of the free list.
+  static const unsigned int cInvalidNode;
+  // Default for mRebuildCostRatio.
+  static const float cDefaultRebuildCostRatio;
+  // Fraction of the leaves a batch has to touch before it rebuilds the tree.
+  static const float cBatchRebuildFraction;
+
+  //---------------------------------------------------------------------------Node
+  // All nodes live in one contiguous pool (mNodes) and link to each other with
+  // 32-bit indices, so the tree never allocates per node and can be copied or
+  // relocated as a flat block of memory.
+  struct Node
+  {
+    bool IsLeaf() const { return mLeft == cInvalidNode; }
+
+    Aabb mAabb;
+    void* mClientData;
+    // While a node sits on the free list this is the index of the next free node.
+    unsigned int mParent;
+    unsigned int mLeft;
+    unsigned int mRight;
+    // Height of the subtree rooted here (leaves are 0, free nodes are -1).
+    int mHeight;
+  };
+
+  // A leaf waiting to be placed by Build.
+  struct BuildItem
+  {
+    Aabb mAabb;
+    Vector3 mCenter;
+    unsigned int mNode;
+  };
+
+  // Pool management. Freed slots are pushed onto an intrusive free list.
+  unsigned int AllocateNode();
+  void FreeNode(unsigned int index);
+
+  // Link/unlink a leaf that has already been allocated and had its aabb set.
+  void InsertLeaf(unsigned int leaf);
+  void RemoveLeaf(unsigned int leaf);
+  // Walk from the given node to the root recomputing bounds and heights and re-balancing.
+  void SyncHierarchy(unsigned int index);
+  // Performs an avl rotation at the given node if needed. Returns the index of the new subtree root.
+  unsigned int Balance(unsigned int index);
+  // Swaps one child with a grandchild under the other child when that shrinks the other child's
+  // surface area the most (Kopta et al. 2012). The node's own aabb doesn't change but heights
+  // above it may need to be fixed up by the caller. Returns whether a swap was made.
+  bool Rotate(unsigned int index);
+  // Recompute heights from the given node to the root, stopping once they no longer change.
+  void SyncHeights(unsigned int index);
+
+  // Sum of the surface areas of every live node.
+  float GetTotalArea() const;
+  // Whether a batch touching count leaves should rebuild the tree.
+  bool ShouldRebuildForBatch(size_t count) const;
+
+  // Recursively builds a subtree out of items [begin, end). Returns the subtree's root.
+  unsigned int BuildRange(std::vector<BuildItem>& items, size_t begin, size_t end);
+
+  void SelfQuery(unsigned int index, SelfQueryWorker& worker) const;
+  void SelfQuery(unsigned int indexA, unsigned int indexB, SelfQueryWorker& worker) const;
+  // Walks the self query descent of (indexA, indexB) like the two above (indexA == indexB being a
+  // subtree against itself) but stops depth levels down and adds what's left as tasks.
+  void SplitSelfQuery(unsigned int indexA, unsigned int indexB, int depth, std::vector<SelfQueryTask>& tasks, SelfQueryWorker& worker) const;
+  void AddAllLeaves(unsigned int index, CastResults& results) const;
+  void DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask);
+  void FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const;
+
+  std::vector<Node> mNodes;
+  unsigned int mRoot;
+  unsigned int mFreeList;
+  // Number of live leaves. The pool size can't be used since it also holds free nodes.
+  size_t mLeafCount;
+
+  // Keep the tree in shape with SAH rotations instead of avl balancing on the path to the
+  // root after each insert/remove. Avl rotations ignore bounds and undo much of what the
+  // SAH rotations (including the ones made by Optimize) gain, so Optimize is meant to be
+  // used with this on.
+  bool mUseRotations;
+  // Where the next call to Optimize starts in the node pool.
+  unsigned int mRotationCursor;
 
-  // Add your implementation here
+  bool mRefitMode;
+  float mRebuildCostRatio;
+  // Leaves whose aabb changed since the last refit (may contain duplicates or since removed leaves).
+  std::vector<unsigned int> mDirtyLeaves;
+  // Per node flag used by RefitDirty so each ancestor is only queued once.
+  std::vector<unsigned char> mRefitMarks;
+  // Per node index of the frustum plane that last culled the node. Frustums move little from one
+  // frame to the next so that plane usually culls it again. Only a hint, so stale entries are fine.
+  std::vector<unsigned char> mLastFrustumPlanes;
+  // Running total of GetTotalArea kept by refits (negative when it has to be recomputed)
+  // and the SAH cost right after the last build, used to detect when to rebuild.
+  float mTotalArea;
+  float mBaselineSahCost;
+  // How many levels of the self query are split into parallel tasks (0 runs it on one thread).
+  int mSelfQuerySplitDepth;
 };
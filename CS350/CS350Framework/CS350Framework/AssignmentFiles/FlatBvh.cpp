@@ -0,0 +1,567 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Read-only bvh stored in a flat, pointer-free layout that can be saved to a file and mapped back.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "FlatBvh.hpp"
+#include <cstring>
+
+static const char cFlatBvhMagic[4] = {'F', 'B', 'V', 'H'};
+
+// The file is read in place so the layout can't depend on anything but these sizes
+static_assert(sizeof(FlatBvh::Node) == 32, "FlatBvh::Node must match the file layout");
+static_assert(sizeof(FlatBvh::FileHeader) % sizeof(unsigned int) == 0, "FlatBvh nodes must stay aligned after the header");
+
+//-----------------------------------------------------------------------------FlatBvh
+FlatBvh::FlatBvh()
+{
+  mType = SpatialPartitionTypes::FlatBvh;
+  mMappedView = nullptr;
+  mMappedSize = 0;
+  mHeader = nullptr;
+  mNodes = nullptr;
+  mPayload = nullptr;
+}
+
+FlatBvh::~FlatBvh()
+{
+  Clear();
+}
+
+void FlatBvh::InsertData(SpatialPartitionKey&, SpatialPartitionData&)
+{
+  ErrorIf(true, "FlatBvh - Objects can't be inserted. Build or Flatten the tree again with them.");
+}
+
+void FlatBvh::UpdateData(SpatialPartitionKey&, SpatialPartitionData&)
+{
+  ErrorIf(true, "FlatBvh - Objects can't be updated. Build or Flatten the tree again.");
+}
+
+void FlatBvh::RemoveData(SpatialPartitionKey&)
+{
+  ErrorIf(true, "FlatBvh - Objects can't be removed. Build or Flatten the tree again without them.");
+}
+
+void FlatBvh::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  DynamicAabbTree tree;
+  tree.Build(data, count);
+  if(!Flatten(tree))
+    Clear();
+
+  for(size_t i = 0; keys != nullptr && i < count; ++i)
+    keys[i].mUIntKey = static_cast<unsigned int>(i);
+}
+
+bool FlatBvh::Flatten(SpatialPartition& partition)
+{
+  Clear();
+
+  HierarchyNode root;
+  if(!partition.GetHierarchyRoot(root))
+    return false;
+
+  // Breadth first so each node's children end up next to each other (and after it).
+  // hierarchy[i] is the partition's node that nodes[i] was made from.
+  std::vector<HierarchyNode> hierarchy(1, root);
+  std::vector<Node> nodes(1);
+  std::vector<unsigned int> payload;
+  std::vector<HierarchyNode> children;
+  for(size_t i = 0; i < hierarchy.size(); ++i)
+  {
+    nodes[i].mAabb = hierarchy[i].mAabb;
+    if(hierarchy[i].mIsObject)
+    {
+      size_t index = reinterpret_cast<size_t>(hierarchy[i].mClientData);
+      ErrorIf(index > 0xffffffffu, "FlatBvh - Client data has to be a 32-bit index");
+      nodes[i].mFirst = cLeafBit | static_cast<unsigned int>(payload.size());
+      nodes[i].mCount = 0;
+      payload.push_back(static_cast<unsigned int>(index));
+      continue;
+    }
+
+    children.clear();
+    partition.GetHierarchyChildren(hierarchy[i], children);
+    nodes[i].mFirst = static_cast<unsigned int>(nodes.size());
+    nodes[i].mCount = static_cast<unsigned int>(children.size());
+    hierarchy.insert(hierarchy.end(), children.begin(), children.end());
+    nodes.resize(hierarchy.size());
+  }
+
+  FileHeader header;
+  memcpy(header.mMagic, cFlatBvhMagic, sizeof(header.mMagic));
+  header.mVersion = cVersion;
+  header.mNodeCount = static_cast<unsigned int>(nodes.size());
+  header.mPayloadCount = static_cast<unsigned int>(payload.size());
+  header.mBounds = root.mAabb;
+
+  size_t nodeBytes = nodes.size() * sizeof(Node);
+  size_t payloadBytes = payload.size() * sizeof(unsigned int);
+  mOwnedData.resize(sizeof(FileHeader) + nodeBytes + payloadBytes);
+  memcpy(mOwnedData.data(), &header, sizeof(FileHeader));
+  memcpy(mOwnedData.data() + sizeof(FileHeader), nodes.data(), nodeBytes);
+  memcpy(mOwnedData.data() + sizeof(FileHeader) + nodeBytes, payload.data(), payloadBytes);
+  return SetData(mOwnedData.data(), mOwnedData.size());
+}
+
+bool FlatBvh::Save(const std::string& path) const
+{
+  if(mHeader == nullptr)
+    return false;
+
+  FILE* file = nullptr;
+  fopen_s(&file, path.c_str(), "wb");
+  if(file == nullptr)
+    return false;
+
+  // The header, nodes and payload are one contiguous image
+  size_t size = sizeof(FileHeader) + mHeader->mNodeCount * sizeof(Node) + mHeader->mPayloadCount * sizeof(unsigned int);
+  size_t written = fwrite(mHeader, 1, size, file);
+  fclose(file);
+  return written == size;
+}
+
+bool FlatBvh::Load(const std::string& path)
+{
+  Clear();
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  void* view = NULL;
+  if(GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+  {
+    // The view keeps the mapping alive so neither handle is needed after this
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping != NULL)
+    {
+      view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+  if(view == NULL)
+    return false;
+  size_t size = static_cast<size_t>(fileSize.QuadPart);
+
+  mMappedView = view;
+  mMappedSize = size;
+  if(!SetData(static_cast<const char*>(view), size))
+  {
+    Clear();
+    return false;
+  }
+  return true;
+}
+
+void FlatBvh::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  if(GetNodeCount() != 0)
+    DebugDraw(0, 0, level, transform, color, bitMask);
+}
+
+void FlatBvh::CastRay(const Ray& ray, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(GetNodeCount() == 0)
+    return;
+
+  std::vector<unsigned int> stack;
+  stack.push_back(0);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+    QueryStatistic(statistics.Visit(IsLeaf(node), stack.size() + 1));
+
+    float t;
+    if(!RayAabb(ray.mStart, ray.mDirection, node.mAabb.mMin, node.mAabb.mMax, t))
+      continue;
+
+    if(IsLeaf(node))
+    {
+      results.AddResult(CastResult(GetClientData(node), t));
+      continue;
+    }
+
+    for(unsigned int i = node.mCount; i > 0; --i)
+      stack.push_back(node.mFirst + i - 1);
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool FlatBvh::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  float t;
+  if(GetNodeCount() == 0 || !RayAabb(ray.mStart, ray.mDirection, mNodes[0].mAabb.mMin, mNodes[0].mAabb.mMax, t))
+    return false;
+
+  // Each entry is a node the ray hits and the time it enters it
+  ClosestHitQuery query(ray, refiner);
+  std::vector<std::pair<unsigned int, float> > stack;
+  std::vector<std::pair<float, unsigned int> > hits;
+  stack.push_back(std::make_pair(0u, t));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    float tEnter = stack.back().second;
+    stack.pop_back();
+
+    // A closer hit may have been found since the node was pushed
+    if(tEnter >= query.GetMaxTime())
+      continue;
+
+    if(IsLeaf(node))
+    {
+      query.AddObject(GetClientData(node), tEnter);
+      continue;
+    }
+
+    // Push the children farthest first so the nearest one is visited next
+    hits.clear();
+    for(unsigned int i = node.mFirst; i < node.mFirst + node.mCount; ++i)
+    {
+      const Aabb& aabb = mNodes[i].mAabb;
+      if(RayAabb(ray.mStart, ray.mDirection, aabb.mMin, aabb.mMax, t) && t < query.GetMaxTime())
+        hits.push_back(std::make_pair(t, i));
+    }
+    std::sort(hits.begin(), hits.end());
+    for(size_t i = hits.size(); i > 0; --i)
+      stack.push_back(std::make_pair(hits[i - 1].second, hits[i - 1].first));
+  }
+  return query.GetResult(result);
+}
+
+bool FlatBvh::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  if(GetNodeCount() == 0)
+    return false;
+
+  AnyHitQuery query(ray, maxT, refiner);
+  std::vector<unsigned int> stack;
+  stack.push_back(0);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float t;
+    if(!RayAabb(ray.mStart, ray.mDirection, node.mAabb.mMin, node.mAabb.mMax, t) || t > maxT)
+      continue;
+
+    if(IsLeaf(node))
+    {
+      if(query.IsHit(GetClientData(node), t))
+        return true;
+      continue;
+    }
+
+    for(unsigned int i = node.mCount; i > 0; --i)
+      stack.push_back(node.mFirst + i - 1);
+  }
+  return false;
+}
+
+void FlatBvh::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(GetNodeCount() == 0)
+    return;
+
+  const Vector4* planes = frustum.GetPlanes();
+  mLastFrustumPlanes.resize(GetNodeCount(), 0);
+
+  // Each entry is a node and the planes it still has to be tested against
+  std::vector<std::pair<unsigned int, int> > stack;
+  stack.push_back(std::make_pair(0u, cAllFrustumPlanes));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    int planeMask = stack.back().second;
+    stack.pop_back();
+
+    const Node& node = mNodes[index];
+    QueryStatistic(statistics.Visit(IsLeaf(node), stack.size() + 1));
+    size_t lastAxis = mLastFrustumPlanes[index];
+    IntersectionType::Type type = FrustumAabb(planes, node.mAabb.mMin, node.mAabb.mMax, lastAxis, planeMask);
+    if(type == IntersectionType::Outside)
+    {
+      mLastFrustumPlanes[index] = static_cast<unsigned char>(lastAxis);
+      continue;
+    }
+
+    // Everything below a fully contained node is also contained
+    if(type == IntersectionType::Inside || IsLeaf(node))
+    {
+      AddAllLeaves(index, results);
+      continue;
+    }
+
+    for(unsigned int i = node.mCount; i > 0; --i)
+      stack.push_back(std::make_pair(node.mFirst + i - 1, planeMask));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void FlatBvh::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  if(GetNodeCount() == 0)
+    return;
+
+  NearestQuery query(point, k, maxDistance);
+  NearestNodeQueue queue;
+  queue.Push(mNodes[0].mAabb.GetDistanceSquared(point), 0);
+
+  unsigned int index;
+  while(queue.Pop(query, index))
+  {
+    const Node& node = mNodes[index];
+    if(IsLeaf(node))
+    {
+      query.AddObject(GetClientData(node), node.mAabb);
+      continue;
+    }
+
+    // Leaf children go straight into the query instead of through the queue
+    for(unsigned int i = node.mFirst; i < node.mFirst + node.mCount; ++i)
+    {
+      float distanceSq = mNodes[i].mAabb.GetDistanceSquared(point);
+      if(IsLeaf(mNodes[i]))
+        query.AddObject(GetClientData(mNodes[i]), distanceSq);
+      else if(distanceSq <= query.GetMaxDistanceSq())
+        queue.Push(distanceSq, i);
+    }
+  }
+  query.GetResults(results);
+}
+
+void FlatBvh::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  if(GetNodeCount() == 0)
+    return;
+
+  std::vector<unsigned int> stack;
+  stack.push_back(0);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    // Leaves only need the overlap test
+    if(IsLeaf(node))
+    {
+      if(region.Overlaps(node.mAabb))
+        results.AddResult(CastResult(GetClientData(node), 0.0f));
+      continue;
+    }
+
+    IntersectionType::Type type = region.Classify(node.mAabb);
+    if(type == IntersectionType::Outside)
+      continue;
+
+    if(type == IntersectionType::Inside)
+    {
+      AddAllLeaves(index, results);
+      continue;
+    }
+
+    for(unsigned int i = node.mCount; i > 0; --i)
+      stack.push_back(node.mFirst + i - 1);
+  }
+}
+
+void FlatBvh::SelfQuery(QueryResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  // Every overlapping pair meets at exactly one internal node (their lowest common ancestor)
+  // so testing each node's children against each other finds every pair once.
+  for(unsigned int i = 0; i < GetNodeCount(); ++i)
+  {
+    const Node& node = mNodes[i];
+    if(IsLeaf(node))
+      continue;
+
+    for(unsigned int a = node.mFirst; a < node.mFirst + node.mCount; ++a)
+    {
+      for(unsigned int b = a + 1; b < node.mFirst + node.mCount; ++b)
+        SelfQuery(a, b, results);
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool FlatBvh::GetHierarchyRoot(HierarchyNode& root)
+{
+  if(GetNodeCount() == 0)
+    return false;
+
+  root.mAabb = mNodes[0].mAabb;
+  root.mIndex = 0;
+  root.mIsObject = IsLeaf(mNodes[0]);
+  root.mClientData = IsLeaf(mNodes[0]) ? GetClientData(mNodes[0]) : nullptr;
+  return true;
+}
+
+void FlatBvh::GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const
+{
+  const Node& parent = mNodes[node.mIndex];
+  for(unsigned int i = parent.mFirst; i < parent.mFirst + parent.mCount; ++i)
+  {
+    HierarchyNode result;
+    result.mAabb = mNodes[i].mAabb;
+    result.mIndex = i;
+    result.mIsObject = IsLeaf(mNodes[i]);
+    result.mClientData = IsLeaf(mNodes[i]) ? GetClientData(mNodes[i]) : nullptr;
+    children.push_back(result);
+  }
+}
+
+void FlatBvh::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  if(GetNodeCount() != 0)
+    FilloutData(0, 0, results);
+}
+
+size_t FlatBvh::GetMemoryUsage() const
+{
+  return sizeof(*this) + mOwnedData.capacity() + mMappedSize + mLastFrustumPlanes.capacity();
+}
+
+void* FlatBvh::GetClientData(const Node& node) const
+{
+  return reinterpret_cast<void*>(static_cast<size_t>(mPayload[node.mFirst & ~cLeafBit]));
+}
+
+unsigned int FlatBvh::GetNodeCount() const
+{
+  return (mHeader != nullptr) ? mHeader->mNodeCount : 0;
+}
+
+bool FlatBvh::SetData(const char* data, size_t size)
+{
+  if(size < sizeof(FileHeader))
+    return false;
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(data);
+  if(memcmp(header->mMagic, cFlatBvhMagic, sizeof(header->mMagic)) != 0 || header->mVersion != cVersion)
+    return false;
+
+  size_t nodeBytes = static_cast<size_t>(header->mNodeCount) * sizeof(Node);
+  size_t payloadBytes = static_cast<size_t>(header->mPayloadCount) * sizeof(unsigned int);
+  if(size != sizeof(FileHeader) + nodeBytes + payloadBytes)
+    return false;
+
+  // Queries trust the indices so a bad file has to be caught here. Children always come after
+  // their parent, which also rules out cycles.
+  const Node* nodes = reinterpret_cast<const Node*>(data + sizeof(FileHeader));
+  for(size_t i = 0; i < header->mNodeCount; ++i)
+  {
+    const Node& node = nodes[i];
+    if(IsLeaf(node))
+    {
+      if((node.mFirst & ~cLeafBit) >= header->mPayloadCount)
+        return false;
+    }
+    else if(node.mFirst <= i || static_cast<size_t>(node.mFirst) + node.mCount > header->mNodeCount)
+      return false;
+  }
+
+  mHeader = header;
+  mNodes = nodes;
+  mPayload = reinterpret_cast<const unsigned int*>(data + sizeof(FileHeader) + nodeBytes);
+  return true;
+}
+
+void FlatBvh::Clear()
+{
+  if(mMappedView != nullptr)
+    UnmapViewOfFile(mMappedView);
+  mMappedView = nullptr;
+  mMappedSize = 0;
+  mOwnedData.clear();
+  mLastFrustumPlanes.clear();
+
+  mHeader = nullptr;
+  mNodes = nullptr;
+  mPayload = nullptr;
+}
+
+void FlatBvh::SelfQuery(unsigned int indexA, unsigned int indexB, QueryResults& results) const
+{
+  QueryStatistic(QueryStatistics& statistics = GetQueryStatistics(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(QueryDepthScope depthScope(statistics));
+  const Node& nodeA = mNodes[indexA];
+  const Node& nodeB = mNodes[indexB];
+  QueryStatistic(statistics.Visit(IsLeaf(nodeA) && IsLeaf(nodeB)));
+  if(!AabbAabb(nodeA.mAabb.mMin, nodeA.mAabb.mMax, nodeB.mAabb.mMin, nodeB.mAabb.mMax))
+    return;
+
+  if(IsLeaf(nodeA) && IsLeaf(nodeB))
+  {
+    results.AddResult(QueryResult(GetClientData(nodeA), GetClientData(nodeB)));
+    return;
+  }
+
+  // Split the larger node (or the only one that can be split)
+  if(IsLeaf(nodeB) || (!IsLeaf(nodeA) && nodeA.mAabb.GetSurfaceArea() >= nodeB.mAabb.GetSurfaceArea()))
+  {
+    for(unsigned int i = nodeA.mFirst; i < nodeA.mFirst + nodeA.mCount; ++i)
+      SelfQuery(i, indexB, results);
+  }
+  else
+  {
+    for(unsigned int i = nodeB.mFirst; i < nodeB.mFirst + nodeB.mCount; ++i)
+      SelfQuery(indexA, i, results);
+  }
+}
+
+void FlatBvh::AddAllLeaves(unsigned int index, CastResults& results) const
+{
+  const Node& node = mNodes[index];
+  if(IsLeaf(node))
+  {
+    results.AddResult(CastResult(GetClientData(node), 0.0f));
+    return;
+  }
+
+  for(unsigned int i = node.mFirst; i < node.mFirst + node.mCount; ++i)
+    AddAllLeaves(i, results);
+}
+
+void FlatBvh::DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const
+{
+  const Node& node = mNodes[index];
+  if(level == -1 || level == depth)
+    gDebugDrawer->DrawAabb(node.mAabb).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+
+  if(IsLeaf(node) || (level != -1 && depth >= level))
+    return;
+
+  for(unsigned int i = node.mFirst; i < node.mFirst + node.mCount; ++i)
+    DebugDraw(i, depth + 1, level, transform, color, bitMask);
+}
+
+void FlatBvh::FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const
+{
+  const Node& node = mNodes[index];
+  SpatialPartitionQueryData data;
+  data.mAabb = node.mAabb;
+  data.mClientData = IsLeaf(node) ? GetClientData(node) : nullptr;
+  data.mDepth = depth;
+  results.push_back(data);
+
+  if(IsLeaf(node))
+    return;
+
+  for(unsigned int i = node.mFirst; i < node.mFirst + node.mCount; ++i)
+    FilloutData(i, depth + 1, results);
+}
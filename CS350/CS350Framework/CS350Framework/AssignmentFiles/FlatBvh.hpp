@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Read-only bvh stored in a flat, pointer-free layout that can be saved to a file and mapped back.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+
+//-----------------------------------------------------------------------------FlatBvh
+// A copy of another tree's hierarchy (see GetHierarchyRoot) laid out exactly as it is on disk: a
+// header, then every node in breadth first order, then the payload of each object. A node's children
+// are contiguous (and always after it) and an object's payload is its client data as a 32-bit index,
+// so this is meant for data that's indexed anyway like a midphase's triangles.
+// Since the file and the in-memory layout are the same, Load just maps the file and queries run
+// directly on the mapped nodes. That lets a precomputed midphase be shipped next to its mesh and
+// loaded without building anything.
+class FlatBvh : public SpatialPartition
+{
+public:
+  FlatBvh();
+  ~FlatBvh();
+  // The nodes may point into a mapped file so copies aren't allowed.
+  FlatBvh(const FlatBvh&) = delete;
+  FlatBvh& operator=(const FlatBvh&) = delete;
+
+  // Spatial Partition Interface
+  // Not supported (the tree is read-only). Use Build or Flatten to make a new one.
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+  // Flattens DynamicAabbTree's SAH build of the data. The key of object i is i.
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+
+  // Copies the partition's hierarchy. Returns false (leaving this tree empty) if the partition doesn't
+  // have a hierarchy or is empty.
+  bool Flatten(SpatialPartition& partition);
+  bool Save(const std::string& path) const;
+  // Maps the file (read-only) and uses it in place. Returns false (leaving this tree empty) if the
+  // file can't be opened or isn't a valid tree of this version.
+  bool Load(const std::string& path);
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  void CastRay(const Ray& ray, CastResults& results) override;
+  // Children are visited in the order the ray enters them and skipped once the closest hit so far is before that.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  // Nodes fully inside the frustum add their whole subtree without testing it and each node starts
+  // with the plane that last rejected it (see mLastFrustumPlanes).
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Best-first over the node bounds, closest node first.
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  // Nodes fully inside the region add their whole subtree without testing it.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  void SelfQuery(QueryResults& results) override;
+
+  bool GetHierarchyRoot(HierarchyNode& root) override;
+  void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const override;
+
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+  size_t GetMemoryUsage() const override;
+
+  static const unsigned int cVersion = 1;
+  // Set in mFirst of objects (the rest is the index into the payload).
+  static const unsigned int cLeafBit = 0x80000000u;
+
+  // Start of the file. The nodes and then the payload follow right after it.
+  struct FileHeader
+  {
+    char mMagic[4];
+    unsigned int mVersion;
+    unsigned int mNodeCount;
+    unsigned int mPayloadCount;
+    // The root's bounds.
+    Aabb mBounds;
+  };
+
+  // Node 0 is the root. An internal node's children are nodes [mFirst, mFirst + mCount).
+  struct Node
+  {
+    Aabb mAabb;
+    unsigned int mFirst;
+    unsigned int mCount;
+  };
+
+  static bool IsLeaf(const Node& node) { return (node.mFirst & cLeafBit) != 0; }
+  void* GetClientData(const Node& node) const;
+  unsigned int GetNodeCount() const;
+
+  // Points the tree at a complete file image (owned or mapped) after checking that it's valid.
+  bool SetData(const char* data, size_t size);
+  void Clear();
+
+  void SelfQuery(unsigned int indexA, unsigned int indexB, QueryResults& results) const;
+  void AddAllLeaves(unsigned int index, CastResults& results) const;
+  void DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const;
+  void FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const;
+
+  // The file image when it was built in memory (empty when it's mapped).
+  std::vector<char> mOwnedData;
+  // The mapped file (null when the data is owned).
+  void* mMappedView;
+  size_t mMappedSize;
+
+  // Views into the file image.
+  const FileHeader* mHeader;
+  const Node* mNodes;
+  const unsigned int* mPayload;
+  // Index of the frustum plane that last culled each node. Kept apart from the (read-only) nodes.
+  std::vector<unsigned char> mLastFrustumPlanes;
+};
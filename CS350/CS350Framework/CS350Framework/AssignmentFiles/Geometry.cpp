@@ -353,53 +353,53 @@ IntersectionType::Type FrustumSphere(const Vector4 planes[6],
 {
     ++Application::mStatistics.mFrustumSphereTests;
 
-    // check the sphere against each plane
-    IntersectionType::Type type0 = PlaneSphere(planes[0], sphereCenter, sphereRadius);
-    IntersectionType::Type type1 = PlaneSphere(planes[1], sphereCenter, sphereRadius);
-    IntersectionType::Type type2 = PlaneSphere(planes[2], sphereCenter, sphereRadius);
-    IntersectionType::Type type3 = PlaneSphere(planes[3], sphereCenter, sphereRadius);
-    IntersectionType::Type type4 = PlaneSphere(planes[4], sphereCenter, sphereRadius);
-    IntersectionType::Type type5 = PlaneSphere(planes[5], sphereCenter, sphereRadius);
-
-    // check if outside
-    if (type0 == IntersectionType::Outside || type1 == IntersectionType::Outside ||
-        type2 == IntersectionType::Outside || type3 == IntersectionType::Outside ||
-        type4 == IntersectionType::Outside || type5 == IntersectionType::Outside) return IntersectionType::Outside;
-
-    // check if inside
-    if (type0 == IntersectionType::Inside && type1 == IntersectionType::Inside &&
-        type2 == IntersectionType::Inside && type3 == IntersectionType::Inside &&
-        type4 == IntersectionType::Inside && type5 == IntersectionType::Inside) return IntersectionType::Inside;
+    // start with the plane that rejected the sphere last time
+    bool inside = true;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        size_t plane = (lastAxis + i) % 6;
+        IntersectionType::Type type = PlaneSphere(planes[plane], sphereCenter, sphereRadius);
+        if (type == IntersectionType::Outside)
+        {
+            lastAxis = plane;
+            return IntersectionType::Outside;
+        }
+        inside = inside && (type == IntersectionType::Inside);
+    }
 
-    // check for overlap
-    return IntersectionType::Overlaps;
+    return inside ? IntersectionType::Inside : IntersectionType::Overlaps;
 }
 
 IntersectionType::Type FrustumAabb(const Vector4 planes[6],
                                    const Vector3& aabbMin, const Vector3& aabbMax, size_t& lastAxis)
+{
+    int planeMask = cAllFrustumPlanes;
+    return FrustumAabb(planes, aabbMin, aabbMax, lastAxis, planeMask);
+}
+
+IntersectionType::Type FrustumAabb(const Vector4 planes[6],
+                                   const Vector3& aabbMin, const Vector3& aabbMax, size_t& lastAxis, int& planeMask)
 {
     ++Application::mStatistics.mFrustumAabbTests;
 
-    // check the sphere against each plane
-    IntersectionType::Type type0 = PlaneAabb(planes[0], aabbMin, aabbMax);
-    IntersectionType::Type type1 = PlaneAabb(planes[1], aabbMin, aabbMax);
-    IntersectionType::Type type2 = PlaneAabb(planes[2], aabbMin, aabbMax);
-    IntersectionType::Type type3 = PlaneAabb(planes[3], aabbMin, aabbMax);
-    IntersectionType::Type type4 = PlaneAabb(planes[4], aabbMin, aabbMax);
-    IntersectionType::Type type5 = PlaneAabb(planes[5], aabbMin, aabbMax);
+    // start with the plane that rejected the aabb last time
+    for (size_t i = 0; i < 6; ++i)
+    {
+        size_t plane = (lastAxis + i) % 6;
+        if ((planeMask & (1 << plane)) == 0) continue;
 
-    // check if outside
-    if (type0 == IntersectionType::Outside || type1 == IntersectionType::Outside ||
-        type2 == IntersectionType::Outside || type3 == IntersectionType::Outside ||
-        type4 == IntersectionType::Outside || type5 == IntersectionType::Outside) return IntersectionType::Outside;
+        IntersectionType::Type type = PlaneAabb(planes[plane], aabbMin, aabbMax);
+        if (type == IntersectionType::Outside)
+        {
+            lastAxis = plane;
+            return IntersectionType::Outside;
+        }
 
-    // check if inside
-    if (type0 == IntersectionType::Inside && type1 == IntersectionType::Inside &&
-        type2 == IntersectionType::Inside && type3 == IntersectionType::Inside &&
-        type4 == IntersectionType::Inside && type5 == IntersectionType::Inside) return IntersectionType::Inside;
+        // children of this aabb never have to test this plane again
+        if (type == IntersectionType::Inside) planeMask &= ~(1 << plane);
+    }
 
-    // check for overlap
-    return IntersectionType::Overlaps;
+    return (planeMask == 0) ? IntersectionType::Inside : IntersectionType::Overlaps;
 }
 
 bool SphereSphere(const Vector3& sphereCenter0, float sphereRadius0,
@@ -419,3 +419,12 @@ bool AabbAabb(const Vector3& aabbMin0, const Vector3& aabbMax0,
     if (aabbMax0.z < aabbMin1.z || aabbMax1.z < aabbMin0.z) return false;
     return true;
 }
+
+bool SphereAabb(const Vector3& sphereCenter, float sphereRadius,
+                const Vector3& aabbMin, const Vector3& aabbMax)
+{
+    ++Application::mStatistics.mSphereAabbTests;
+
+    float distanceSq = Aabb(aabbMin, aabbMax).GetDistanceSquared(sphereCenter);
+    return distanceSq <= sphereRadius * sphereRadius;
+}
@@ -127,6 +127,15 @@ IntersectionType::Type FrustumSphere(const Vector4 planes[6],
 IntersectionType::Type FrustumAabb(const Vector4 planes[6],
                                    const Vector3& aabbMin, const Vector3& aabbMax, size_t& lastAxis);
 
+// Every bit set in a frustum plane mask (bit i is planes[i]).
+static const int cAllFrustumPlanes = 0x3f;
+
+// Same as above but only the planes set in planeMask are tested. Planes the aabb is fully inside of are
+// cleared from the mask, so a tree can pass the mask down to the aabb's children, which are inside those
+// planes as well. Returns Inside once the mask is empty.
+IntersectionType::Type FrustumAabb(const Vector4 planes[6],
+                                   const Vector3& aabbMin, const Vector3& aabbMax, size_t& lastAxis, int& planeMask);
+
 //--------------------------------------------------------------------------------------------------------------------
 // Simple primitive tests
 //--------------------------------------------------------------------------------------------------------------------
@@ -135,3 +144,7 @@ bool SphereSphere(const Vector3& sphereCenter0, float sphereRadius0,
 
 bool AabbAabb(const Vector3& aabbMin0, const Vector3& aabbMax0,
               const Vector3& aabbMin1, const Vector3& aabbMax1);
+
+// Does the sphere touch the aabb (the closest point on the aabb is within the radius)?
+bool SphereAabb(const Vector3& sphereCenter, float sphereRadius,
+                const Vector3& aabbMin, const Vector3& aabbMax);
@@ -0,0 +1,608 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Uniform hash grid spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "HashGrid.hpp"
+
+const float HashGridSpatialPartition::cDefaultCellSize = 2.0f;
+const float HashGridSpatialPartition::cAutoTuneDrift = 2.0f;
+
+// Cell coordinates are packed into 21 bits each (two's complement)
+static const unsigned long long cCellCoordinateMask = 0x1fffff;
+
+static int UnpackCellCoordinate(unsigned long long key, int shift)
+{
+  int value = static_cast<int>((key >> shift) & cCellCoordinateMask);
+  if(value & 0x100000)
+    value -= 0x200000;
+  return value;
+}
+
+//-----------------------------------------------------------------------------HashGridSpatialPartition
+HashGridSpatialPartition::HashGridSpatialPartition()
+{
+  mType = SpatialPartitionTypes::HashGrid;
+  mAutoTune = true;
+  mCellSize = cDefaultCellSize;
+  mQueryStamp = 0;
+  mActiveCount = 0;
+  mExtentSum = 0.0;
+}
+
+void HashGridSpatialPartition::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index;
+  if(mFreeProxies.empty())
+  {
+    index = static_cast<unsigned int>(mProxies.size());
+    mProxies.push_back(Proxy());
+  }
+  else
+  {
+    index = mFreeProxies.back();
+    mFreeProxies.pop_back();
+  }
+
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  proxy.mQueryStamp = 0;
+  proxy.mActive = true;
+  ComputeCellRange(proxy.mAabb, proxy.mMinCell, proxy.mMaxCell);
+  AddToCells(index);
+
+  ++mActiveCount;
+  mExtentSum += GetExtent(data.mAabb);
+  key.mUIntKey = index;
+}
+
+void HashGridSpatialPartition::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index = key.mUIntKey;
+  Proxy& proxy = mProxies[index];
+  mExtentSum += GetExtent(data.mAabb) - GetExtent(proxy.mAabb);
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  if(!proxy.mOversized)
+    mBounds = Aabb::Combine(mBounds, data.mAabb);
+
+  // Only touch the cells if the object moved into a different set of them
+  int minCell[3];
+  int maxCell[3];
+  ComputeCellRange(data.mAabb, minCell, maxCell);
+  bool sameCells = true;
+  for(int axis = 0; axis < 3; ++axis)
+    sameCells = sameCells && minCell[axis] == proxy.mMinCell[axis] && maxCell[axis] == proxy.mMaxCell[axis];
+  if(sameCells)
+    return;
+
+  RemoveFromCells(index);
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    proxy.mMinCell[axis] = minCell[axis];
+    proxy.mMaxCell[axis] = maxCell[axis];
+  }
+  AddToCells(index);
+}
+
+void HashGridSpatialPartition::RemoveData(SpatialPartitionKey& key)
+{
+  unsigned int index = key.mUIntKey;
+  RemoveFromCells(index);
+
+  Proxy& proxy = mProxies[index];
+  --mActiveCount;
+  mExtentSum -= GetExtent(proxy.mAabb);
+  proxy.mClientData = nullptr;
+  proxy.mActive = false;
+  mFreeProxies.push_back(index);
+}
+
+void HashGridSpatialPartition::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  mProxies.resize(count);
+  mFreeProxies.clear();
+  mActiveCount = count;
+  mExtentSum = 0.0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    Proxy& proxy = mProxies[i];
+    proxy.mAabb = data[i].mAabb;
+    proxy.mClientData = data[i].mClientData;
+    proxy.mQueryStamp = 0;
+    proxy.mActive = true;
+    mExtentSum += GetExtent(data[i].mAabb);
+
+    if(keys != nullptr)
+      keys[i].mUIntKey = static_cast<unsigned int>(i);
+  }
+
+  // Both of these bucket every proxy
+  if(mAutoTune && count != 0)
+    AutoTuneCellSize();
+  else
+    SetCellSize(mCellSize);
+}
+
+void HashGridSpatialPartition::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  // Draws the occupied cells
+  if(level != -1 && level != 0)
+    return;
+
+  for(CellMap::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+  {
+    Vector3 cellMin;
+    cellMin.x = UnpackCellCoordinate(it->first, 42) * mCellSize;
+    cellMin.y = UnpackCellCoordinate(it->first, 21) * mCellSize;
+    cellMin.z = UnpackCellCoordinate(it->first, 0) * mCellSize;
+    gDebugDrawer->DrawAabb(Aabb(cellMin, cellMin + Vector3(mCellSize))).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+  }
+}
+
+void HashGridSpatialPartition::CastRay(const Ray& ray, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  NextQueryStamp();
+
+  for(size_t i = 0; i < mOversizedProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[mOversizedProxies[i]];
+    QueryStatistic(statistics.Visit(true));
+    float t;
+    if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+      results.AddResult(CastResult(proxy.mClientData, t));
+  }
+
+  auto visitor = [&](const Cell& cell, float) -> bool
+  {
+    for(size_t i = 0; i < cell.size(); ++i)
+    {
+      Proxy& proxy = mProxies[cell[i]];
+      if(proxy.mQueryStamp == mQueryStamp)
+        continue;
+      proxy.mQueryStamp = mQueryStamp;
+
+      QueryStatistic(statistics.Visit(true));
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+        results.AddResult(CastResult(proxy.mClientData, t));
+    }
+    return true;
+  };
+  WalkRay(ray, visitor);
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void HashGridSpatialPartition::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  // Frustums typically cover a large part of the grid so just test every object (which includes
+  // the oversized ones)
+  const Vector4* planes = frustum.GetPlanes();
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    QueryStatistic(statistics.Visit(true));
+    size_t lastAxis = 0;
+    if(FrustumAabb(planes, proxy.mAabb.mMin, proxy.mAabb.mMax, lastAxis) != IntersectionType::Outside)
+      results.AddResult(CastResult(proxy.mClientData, 0.0f));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void HashGridSpatialPartition::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  int minCell[3];
+  int maxCell[3];
+  ComputeCellRange(region.mAabb, minCell, maxCell);
+  double cellCount = 1.0;
+  for(int axis = 0; axis < 3; ++axis)
+    cellCount *= maxCell[axis] - minCell[axis] + 1.0;
+
+  if(cellCount > mActiveCount)
+  {
+    for(size_t i = 0; i < mProxies.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[i];
+      if(proxy.mActive && region.Overlaps(proxy.mAabb))
+        results.AddResult(CastResult(proxy.mClientData, 0.0f));
+    }
+    return;
+  }
+
+  for(size_t i = 0; i < mOversizedProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[mOversizedProxies[i]];
+    if(region.Overlaps(proxy.mAabb))
+      results.AddResult(CastResult(proxy.mClientData, 0.0f));
+  }
+
+  NextQueryStamp();
+  for(int z = minCell[2]; z <= maxCell[2]; ++z)
+  {
+    for(int y = minCell[1]; y <= maxCell[1]; ++y)
+    {
+      for(int x = minCell[0]; x <= maxCell[0]; ++x)
+      {
+        CellMap::const_iterator it = mCells.find(GetCellKey(x, y, z));
+        if(it == mCells.end())
+          continue;
+
+        const Cell& cell = it->second;
+        for(size_t i = 0; i < cell.size(); ++i)
+        {
+          Proxy& proxy = mProxies[cell[i]];
+          if(proxy.mQueryStamp == mQueryStamp)
+            continue;
+          proxy.mQueryStamp = mQueryStamp;
+
+          if(region.Overlaps(proxy.mAabb))
+            results.AddResult(CastResult(proxy.mClientData, 0.0f));
+        }
+      }
+    }
+  }
+}
+
+void HashGridSpatialPartition::SelfQuery(QueryResults& results)
+{
+  if(mAutoTune && mActiveCount != 0)
+  {
+    float meanExtent = static_cast<float>(mExtentSum / mActiveCount);
+    if(meanExtent > mCellSize * cAutoTuneDrift || meanExtent * cAutoTuneDrift < mCellSize)
+      AutoTuneCellSize();
+  }
+
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  for(CellMap::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+  {
+    const Cell& cell = it->second;
+    for(size_t i = 0; i < cell.size(); ++i)
+    {
+      const Proxy& proxyA = mProxies[cell[i]];
+      for(size_t j = i + 1; j < cell.size(); ++j)
+      {
+        const Proxy& proxyB = mProxies[cell[j]];
+
+        // Two objects can share many cells so only report them from the first one (the min corner of the shared range)
+        unsigned long long firstSharedCell = GetCellKey(Math::Max(proxyA.mMinCell[0], proxyB.mMinCell[0]),
+                                                        Math::Max(proxyA.mMinCell[1], proxyB.mMinCell[1]),
+                                                        Math::Max(proxyA.mMinCell[2], proxyB.mMinCell[2]));
+        if(firstSharedCell != it->first)
+          continue;
+
+        QueryStatistic(statistics.Visit(true));
+        if(AabbAabb(proxyA.mAabb.mMin, proxyA.mAabb.mMax, proxyB.mAabb.mMin, proxyB.mAabb.mMax))
+          results.AddResult(QueryResult(proxyA.mClientData, proxyB.mClientData));
+      }
+    }
+  }
+
+  // Oversized objects are tested against everything. Pairs of them are reported by the lower index.
+  for(size_t i = 0; i < mOversizedProxies.size(); ++i)
+  {
+    unsigned int indexA = mOversizedProxies[i];
+    const Proxy& proxyA = mProxies[indexA];
+    for(size_t j = 0; j < mProxies.size(); ++j)
+    {
+      const Proxy& proxyB = mProxies[j];
+      if(!proxyB.mActive || (proxyB.mOversized && j <= indexA))
+        continue;
+
+      QueryStatistic(statistics.Visit(true));
+      if(AabbAabb(proxyA.mAabb.mMin, proxyA.mAabb.mMax, proxyB.mAabb.mMin, proxyB.mAabb.mMax))
+        results.AddResult(QueryResult(proxyA.mClientData, proxyB.mClientData));
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void HashGridSpatialPartition::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Proxy& proxy = mProxies[key.mUIntKey];
+  data.mClientData = proxy.mClientData;
+  data.mAabb = proxy.mAabb;
+}
+
+void HashGridSpatialPartition::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    SpatialPartitionQueryData data;
+    data.mAabb = proxy.mAabb;
+    data.mClientData = proxy.mClientData;
+    data.mDepth = 0;
+    results.push_back(data);
+  }
+}
+
+bool HashGridSpatialPartition::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  NextQueryStamp();
+
+  ClosestHitQuery query(ray, refiner);
+  for(size_t i = 0; i < mOversizedProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[mOversizedProxies[i]];
+    float t;
+    if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+      query.AddObject(proxy.mClientData, t);
+  }
+
+  auto visitor = [&](const Cell& cell, float tCellExit) -> bool
+  {
+    for(size_t i = 0; i < cell.size(); ++i)
+    {
+      Proxy& proxy = mProxies[cell[i]];
+      if(proxy.mQueryStamp == mQueryStamp)
+        continue;
+      proxy.mQueryStamp = mQueryStamp;
+
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+        query.AddObject(proxy.mClientData, t);
+    }
+
+    // Nothing in a later cell can be closer than a hit before this cell's far boundary
+    return !(query.mHit && query.GetMaxTime() <= tCellExit);
+  };
+  WalkRay(ray, visitor);
+  return query.GetResult(result);
+}
+
+bool HashGridSpatialPartition::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  NextQueryStamp();
+
+  AnyHitQuery query(ray, maxT, refiner);
+  for(size_t i = 0; i < mOversizedProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[mOversizedProxies[i]];
+    float t;
+    if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t) && query.IsHit(proxy.mClientData, t))
+      return true;
+  }
+
+  bool hit = false;
+  auto visitor = [&](const Cell& cell, float tCellExit) -> bool
+  {
+    for(size_t i = 0; i < cell.size(); ++i)
+    {
+      Proxy& proxy = mProxies[cell[i]];
+      if(proxy.mQueryStamp == mQueryStamp)
+        continue;
+      proxy.mQueryStamp = mQueryStamp;
+
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t) && query.IsHit(proxy.mClientData, t))
+      {
+        hit = true;
+        return false;
+      }
+    }
+
+    // Every later cell starts after maxT
+    return tCellExit <= maxT;
+  };
+  WalkRay(ray, visitor);
+  return hit;
+}
+
+void HashGridSpatialPartition::SetCellSize(float cellSize)
+{
+  mCellSize = cellSize;
+  mCells.clear();
+  mOversizedProxies.clear();
+  mBounds = Aabb();
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    ComputeCellRange(proxy.mAabb, proxy.mMinCell, proxy.mMaxCell);
+    AddToCells(static_cast<unsigned int>(i));
+  }
+}
+
+void HashGridSpatialPartition::AutoTuneCellSize()
+{
+  if(mActiveCount == 0)
+    return;
+
+  float meanExtent = static_cast<float>(mExtentSum / mActiveCount);
+  if(meanExtent > 0.0f)
+    SetCellSize(meanExtent);
+}
+
+unsigned long long HashGridSpatialPartition::GetCellKey(int x, int y, int z)
+{
+  return ((static_cast<unsigned long long>(x) & cCellCoordinateMask) << 42) |
+         ((static_cast<unsigned long long>(y) & cCellCoordinateMask) << 21) |
+         (static_cast<unsigned long long>(z) & cCellCoordinateMask);
+}
+
+void HashGridSpatialPartition::ComputeCellRange(const Aabb& aabb, int* minCell, int* maxCell) const
+{
+  float scale = 1.0f / mCellSize;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    minCell[axis] = static_cast<int>(Math::Floor(aabb.mMin[axis] * scale));
+    maxCell[axis] = static_cast<int>(Math::Floor(aabb.mMax[axis] * scale));
+  }
+}
+
+void HashGridSpatialPartition::AddToCells(unsigned int index)
+{
+  Proxy& proxy = mProxies[index];
+  double cellCount = 1.0;
+  for(int axis = 0; axis < 3; ++axis)
+    cellCount *= proxy.mMaxCell[axis] - proxy.mMinCell[axis] + 1.0;
+
+  proxy.mOversized = cellCount > cMaxCellsPerProxy;
+  if(proxy.mOversized)
+  {
+    mOversizedProxies.push_back(index);
+    return;
+  }
+
+  mBounds = Aabb::Combine(mBounds, proxy.mAabb);
+  for(int x = proxy.mMinCell[0]; x <= proxy.mMaxCell[0]; ++x)
+  {
+    for(int y = proxy.mMinCell[1]; y <= proxy.mMaxCell[1]; ++y)
+    {
+      for(int z = proxy.mMinCell[2]; z <= proxy.mMaxCell[2]; ++z)
+        mCells[GetCellKey(x, y, z)].push_back(index);
+    }
+  }
+}
+
+void HashGridSpatialPartition::RemoveFromCells(unsigned int index)
+{
+  const Proxy& proxy = mProxies[index];
+  if(proxy.mOversized)
+  {
+    *std::find(mOversizedProxies.begin(), mOversizedProxies.end(), index) = mOversizedProxies.back();
+    mOversizedProxies.pop_back();
+    return;
+  }
+
+  for(int x = proxy.mMinCell[0]; x <= proxy.mMaxCell[0]; ++x)
+  {
+    for(int y = proxy.mMinCell[1]; y <= proxy.mMaxCell[1]; ++y)
+    {
+      for(int z = proxy.mMinCell[2]; z <= proxy.mMaxCell[2]; ++z)
+      {
+        CellMap::iterator it = mCells.find(GetCellKey(x, y, z));
+        Cell& cell = it->second;
+        *std::find(cell.begin(), cell.end(), index) = cell.back();
+        cell.pop_back();
+
+        // Keep the map down to occupied cells so SelfQuery doesn't iterate empty ones
+        if(cell.empty())
+          mCells.erase(it);
+      }
+    }
+  }
+}
+
+void HashGridSpatialPartition::NextQueryStamp()
+{
+  ++mQueryStamp;
+  if(mQueryStamp == 0)
+  {
+    for(size_t i = 0; i < mProxies.size(); ++i)
+      mProxies[i].mQueryStamp = 0;
+    mQueryStamp = 1;
+  }
+}
+
+float HashGridSpatialPartition::GetExtent(const Aabb& aabb)
+{
+  Vector3 size = aabb.mMax - aabb.mMin;
+  return Math::Max(size.x, Math::Max(size.y, size.z));
+}
+
+template <typename Visitor>
+void HashGridSpatialPartition::WalkRay(const Ray& ray, Visitor& visitor)
+{
+  // Oversized objects aren't in any cell
+  if(mActiveCount == mOversizedProxies.size())
+    return;
+
+  // Clip the ray against the bounds of everything in the grid
+  float tEnter = 0.0f;
+  float tExit = Math::PositiveMax();
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    float start = ray.mStart[axis];
+    float direction = ray.mDirection[axis];
+    if(direction == 0.0f)
+    {
+      if(start < mBounds.mMin[axis] || start > mBounds.mMax[axis])
+        return;
+      continue;
+    }
+
+    float t0 = (mBounds.mMin[axis] - start) / direction;
+    float t1 = (mBounds.mMax[axis] - start) / direction;
+    tEnter = Math::Max(tEnter, Math::Min(t0, t1));
+    tExit = Math::Min(tExit, Math::Max(t0, t1));
+  }
+  if(tEnter > tExit)
+    return;
+
+  // Set up the dda: the cell to start in, the t where the ray crosses the next
+  // cell boundary on each axis and how far t moves per cell on each axis.
+  int boundsMinCell[3];
+  int boundsMaxCell[3];
+  ComputeCellRange(mBounds, boundsMinCell, boundsMaxCell);
+
+  Vector3 point = ray.mStart + ray.mDirection * tEnter;
+  int cell[3];
+  int step[3];
+  float tNext[3];
+  float tDelta[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    // Rounding at the entry point can land just outside the bounds
+    cell[axis] = static_cast<int>(Math::Floor(point[axis] / mCellSize));
+    cell[axis] = Math::Clamp(cell[axis], boundsMinCell[axis], boundsMaxCell[axis]);
+
+    float direction = ray.mDirection[axis];
+    if(direction > 0.0f)
+    {
+      step[axis] = 1;
+      tDelta[axis] = mCellSize / direction;
+      tNext[axis] = tEnter + ((cell[axis] + 1) * mCellSize - point[axis]) / direction;
+    }
+    else if(direction < 0.0f)
+    {
+      step[axis] = -1;
+      tDelta[axis] = -mCellSize / direction;
+      tNext[axis] = tEnter + (cell[axis] * mCellSize - point[axis]) / direction;
+    }
+    else
+    {
+      step[axis] = 0;
+      tDelta[axis] = Math::PositiveMax();
+      tNext[axis] = Math::PositiveMax();
+    }
+  }
+
+  while(true)
+  {
+    int axis = 0;
+    if(tNext[1] < tNext[axis])
+      axis = 1;
+    if(tNext[2] < tNext[axis])
+      axis = 2;
+    float tCellExit = tNext[axis];
+
+    CellMap::iterator it = mCells.find(GetCellKey(cell[0], cell[1], cell[2]));
+    if(it != mCells.end() && !visitor(it->second, tCellExit))
+      return;
+
+    if(tCellExit > tExit)
+      return;
+
+    cell[axis] += step[axis];
+    if(cell[axis] < boundsMinCell[axis] || cell[axis] > boundsMaxCell[axis])
+      return;
+    tNext[axis] += tDelta[axis];
+  }
+}
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Uniform hash grid spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+
+#include <unordered_map>
+
+//-----------------------------------------------------------------------------HashGridSpatialPartition
+// Buckets every object into each grid cell its aabb overlaps. Cells are stored in a hash map keyed
+// by their packed integer coordinates so the grid is unbounded (coordinates wrap every 2^21 cells,
+// which only costs a few extra tests). Works best when objects are of similar size: updates that
+// stay in the same cells are O(1) and SelfQuery only tests objects that share a cell. Objects that
+// would span more than cMaxCellsPerProxy cells are kept in a separate list instead and tested
+// linearly by every query, so one huge object can't flood the grid.
+class HashGridSpatialPartition : public SpatialPartition
+{
+public:
+  HashGridSpatialPartition();
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  // Walks the cells along the ray with a 3d dda.
+  void CastRay(const Ray& ray, CastResults& results) override;
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Visits the cells the region's aabb overlaps (or every object if that's fewer).
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  void SelfQuery(QueryResults& results) override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+
+  // Finds only the closest object along the ray. The walk stops as soon as the closest hit
+  // so far is nearer than the next cell boundary. Returns false if nothing was hit.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Walks the cells until the first confirmed hit or the first cell past maxT.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+
+  // Changing the cell size re-buckets every object.
+  void SetCellSize(float cellSize);
+  // Sets the cell size to the mean of the objects' largest aabb extent.
+  void AutoTuneCellSize();
+
+  // Whether SelfQuery re-tunes the cell size once the mean object extent has drifted
+  // more than a factor of cAutoTuneDrift away from it.
+  bool mAutoTune;
+  float mCellSize;
+  static const float cDefaultCellSize;
+  static const float cAutoTuneDrift;
+  static const int cMaxCellsPerProxy = 64;
+
+  // An object stored in the grid. The key is the proxy's index.
+  struct Proxy
+  {
+    Aabb mAabb;
+    void* mClientData;
+    // Inclusive range of cells the aabb overlaps
+    int mMinCell[3];
+    int mMaxCell[3];
+    // Last query that visited this proxy (so objects in several cells are only tested once)
+    unsigned int mQueryStamp;
+    bool mActive;
+    // In mOversizedProxies instead of the cells (it overlaps more than cMaxCellsPerProxy of them)
+    bool mOversized;
+  };
+
+  typedef std::vector<unsigned int> Cell;
+  typedef std::unordered_map<unsigned long long, Cell> CellMap;
+
+  static unsigned long long GetCellKey(int x, int y, int z);
+  void ComputeCellRange(const Aabb& aabb, int* minCell, int* maxCell) const;
+  // Adds the proxy to the cells in its range (or to mOversizedProxies if there are too many of them).
+  void AddToCells(unsigned int proxy);
+  void RemoveFromCells(unsigned int proxy);
+  // Starts a query that marks the proxies it visits (resetting every mark when the stamp wraps).
+  void NextQueryStamp();
+  // Largest extent of an aabb, used for the running mean that auto-tuning uses.
+  static float GetExtent(const Aabb& aabb);
+
+  // Calls visitor(cell, tCellExit) for each occupied cell the ray passes through (in order)
+  // until it returns false or the ray leaves the grid's bounds.
+  template <typename Visitor>
+  void WalkRay(const Ray& ray, Visitor& visitor);
+
+  std::vector<Proxy> mProxies;
+  std::vector<unsigned int> mFreeProxies;
+  CellMap mCells;
+  std::vector<unsigned int> mOversizedProxies;
+  unsigned int mQueryStamp;
+
+  // Conservative bounds of everything put in the cells since the last re-bucket (the ray walk stops once it leaves these)
+  Aabb mBounds;
+  size_t mActiveCount;
+  double mExtentSum;
+};
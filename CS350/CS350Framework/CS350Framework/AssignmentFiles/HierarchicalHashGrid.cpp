@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Hierarchical (multi-level) hash grid spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "HierarchicalHashGrid.hpp"
+
+const float HierarchicalHashGrid::cDefaultMinCellSize = 0.25f;
+
+//-----------------------------------------------------------------------------HierarchicalHashGrid
+HierarchicalHashGrid::HierarchicalHashGrid()
+{
+  mType = SpatialPartitionTypes::HierarchicalHashGrid;
+  mMinCellSize = cDefaultMinCellSize;
+}
+
+void HierarchicalHashGrid::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index;
+  if(mFreeProxies.empty())
+  {
+    index = static_cast<unsigned int>(mProxies.size());
+    mProxies.push_back(Proxy());
+  }
+  else
+  {
+    index = mFreeProxies.back();
+    mFreeProxies.pop_back();
+  }
+
+  Proxy& proxy = mProxies[index];
+  proxy.mLevel = GetLevel(data.mAabb);
+  proxy.mActive = true;
+  GetOrCreateLevel(proxy.mLevel).InsertData(proxy.mLevelKey, data);
+
+  key.mUIntKey = index;
+}
+
+void HierarchicalHashGrid::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  Proxy& proxy = mProxies[key.mUIntKey];
+  int level = GetLevel(data.mAabb);
+  if(level == proxy.mLevel)
+  {
+    mLevels[level].UpdateData(proxy.mLevelKey, data);
+    return;
+  }
+
+  // The object changed size enough to belong to another level
+  mLevels[proxy.mLevel].RemoveData(proxy.mLevelKey);
+  proxy.mLevel = level;
+  GetOrCreateLevel(level).InsertData(proxy.mLevelKey, data);
+}
+
+void HierarchicalHashGrid::RemoveData(SpatialPartitionKey& key)
+{
+  Proxy& proxy = mProxies[key.mUIntKey];
+  mLevels[proxy.mLevel].RemoveData(proxy.mLevelKey);
+  proxy.mActive = false;
+  mFreeProxies.push_back(key.mUIntKey);
+}
+
+void HierarchicalHashGrid::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    if(level == -1 || level == static_cast<int>(i))
+      mLevels[i].DebugDraw(-1, transform, color, bitMask);
+  }
+}
+
+void HierarchicalHashGrid::CastRay(const Ray& ray, CastResults& results)
+{
+  // The levels count into this partition's statistics (see GetOrCreateLevel) but this is one query
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t queryCount = statistics.mQueries);
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    if(mLevels[i].mActiveCount != 0)
+      mLevels[i].CastRay(ray, results);
+  }
+  QueryStatistic(statistics.mQueries = queryCount);
+}
+
+void HierarchicalHashGrid::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  // The levels count into this partition's statistics (see GetOrCreateLevel) but this is one query
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t queryCount = statistics.mQueries);
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    if(mLevels[i].mActiveCount != 0)
+      mLevels[i].CastFrustum(frustum, results);
+  }
+  QueryStatistic(statistics.mQueries = queryCount);
+}
+
+void HierarchicalHashGrid::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    if(mLevels[i].mActiveCount != 0)
+      mLevels[i].QueryRegion(region, results);
+  }
+}
+
+void HierarchicalHashGrid::SelfQuery(QueryResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t queryCount = statistics.mQueries);
+  for(size_t fine = 0; fine < mLevels.size(); ++fine)
+  {
+    HashGridSpatialPartition& fineGrid = mLevels[fine];
+    if(fineGrid.mActiveCount == 0)
+      continue;
+
+    fineGrid.SelfQuery(results);
+
+    // Test every object in this level against the cells it overlaps in each coarser level. Since the
+    // coarser cells are larger than the object that's at most 2 cells per axis.
+    for(size_t coarse = fine + 1; coarse < mLevels.size(); ++coarse)
+    {
+      const HashGridSpatialPartition& coarseGrid = mLevels[coarse];
+      if(coarseGrid.mActiveCount == 0)
+        continue;
+
+      for(size_t i = 0; i < fineGrid.mProxies.size(); ++i)
+      {
+        const HashGridSpatialPartition::Proxy& proxyA = fineGrid.mProxies[i];
+        if(!proxyA.mActive)
+          continue;
+
+        int minCell[3];
+        int maxCell[3];
+        coarseGrid.ComputeCellRange(proxyA.mAabb, minCell, maxCell);
+        for(int x = minCell[0]; x <= maxCell[0]; ++x)
+        {
+          for(int y = minCell[1]; y <= maxCell[1]; ++y)
+          {
+            for(int z = minCell[2]; z <= maxCell[2]; ++z)
+            {
+              HashGridSpatialPartition::CellMap::const_iterator it = coarseGrid.mCells.find(HashGridSpatialPartition::GetCellKey(x, y, z));
+              if(it == coarseGrid.mCells.end())
+                continue;
+
+              const HashGridSpatialPartition::Cell& cell = it->second;
+              for(size_t j = 0; j < cell.size(); ++j)
+              {
+                // Only report the pair from the first cell both objects overlap
+                const HashGridSpatialPartition::Proxy& proxyB = coarseGrid.mProxies[cell[j]];
+                if(x != Math::Max(minCell[0], proxyB.mMinCell[0]) ||
+                   y != Math::Max(minCell[1], proxyB.mMinCell[1]) ||
+                   z != Math::Max(minCell[2], proxyB.mMinCell[2]))
+                  continue;
+
+                QueryStatistic(statistics.Visit(true));
+                if(AabbAabb(proxyA.mAabb.mMin, proxyA.mAabb.mMax, proxyB.mAabb.mMin, proxyB.mAabb.mMax))
+                {
+                  results.AddResult(QueryResult(proxyA.mClientData, proxyB.mClientData));
+                  QueryStatistic(++statistics.mResults);
+                }
+              }
+            }
+          }
+        }
+
+        // The coarse grid's oversized objects aren't in its cells
+        for(size_t j = 0; j < coarseGrid.mOversizedProxies.size(); ++j)
+        {
+          const HashGridSpatialPartition::Proxy& proxyB = coarseGrid.mProxies[coarseGrid.mOversizedProxies[j]];
+          QueryStatistic(statistics.Visit(true));
+          if(AabbAabb(proxyA.mAabb.mMin, proxyA.mAabb.mMax, proxyB.mAabb.mMin, proxyB.mAabb.mMax))
+          {
+            results.AddResult(QueryResult(proxyA.mClientData, proxyB.mClientData));
+            QueryStatistic(++statistics.mResults);
+          }
+        }
+      }
+    }
+  }
+  QueryStatistic(statistics.mQueries = queryCount);
+}
+
+void HierarchicalHashGrid::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Proxy& proxy = mProxies[key.mUIntKey];
+  mLevels[proxy.mLevel].GetDataFromKey(proxy.mLevelKey, data);
+}
+
+void HierarchicalHashGrid::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    size_t start = results.size();
+    mLevels[i].FilloutData(results);
+    for(size_t j = start; j < results.size(); ++j)
+      results[j].mDepth = static_cast<int>(i);
+  }
+}
+
+bool HierarchicalHashGrid::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  bool hit = false;
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    CastResult levelResult;
+    if(mLevels[i].mActiveCount == 0 || !mLevels[i].CastRayClosest(ray, levelResult, refiner))
+      continue;
+
+    if(!hit || levelResult.mTime < result.mTime)
+      result = levelResult;
+    hit = true;
+  }
+  return hit;
+}
+
+bool HierarchicalHashGrid::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  for(size_t i = 0; i < mLevels.size(); ++i)
+  {
+    if(mLevels[i].mActiveCount != 0 && mLevels[i].CastRayAny(ray, maxT, refiner))
+      return true;
+  }
+  return false;
+}
+
+int HierarchicalHashGrid::GetLevel(const Aabb& aabb) const
+{
+  float extent = HashGridSpatialPartition::GetExtent(aabb);
+  float cellSize = mMinCellSize;
+  int level = 0;
+  while(cellSize < extent && level < cMaxLevels - 1)
+  {
+    cellSize *= 2.0f;
+    ++level;
+  }
+  return level;
+}
+
+HashGridSpatialPartition& HierarchicalHashGrid::GetOrCreateLevel(int level)
+{
+  while(static_cast<int>(mLevels.size()) <= level)
+  {
+    float cellSize = mMinCellSize * static_cast<float>(1 << mLevels.size());
+    mLevels.push_back(HashGridSpatialPartition());
+    mLevels.back().mAutoTune = false;
+    // Queries on a level are part of a query on this grid, so they're counted as one
+    mLevels.back().mType = mType;
+    mLevels.back().SetCellSize(cellSize);
+  }
+  return mLevels[level];
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Hierarchical (multi-level) hash grid spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "HashGrid.hpp"
+
+//-----------------------------------------------------------------------------HierarchicalHashGrid
+// A stack of hash grids whose cell sizes double from one level to the next. Each object goes into
+// the finest level whose cells are at least as big as the object, so it overlaps at most 2 cells per
+// axis no matter how large or small it is. That keeps a single grid from breaking down when tiny
+// debris and huge level geometry are mixed. SelfQuery tests each level against itself and every
+// object against the (few) cells it overlaps in each coarser level.
+class HierarchicalHashGrid : public SpatialPartition
+{
+public:
+  HierarchicalHashGrid();
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+
+  // Draws the occupied cells of the given grid level (or of every level with -1).
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  void CastRay(const Ray& ray, CastResults& results) override;
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  void SelfQuery(QueryResults& results) override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  // The depth of each object is the grid level it's stored in.
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+
+  // The closest hit of each level's walk.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Any hit from any level's walk.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+
+  // The grid level whose cell size best fits the aabb.
+  int GetLevel(const Aabb& aabb) const;
+  HashGridSpatialPartition& GetOrCreateLevel(int level);
+
+  // Cell size of level 0 (anything smaller also goes there). Only change this while the grid is empty.
+  float mMinCellSize;
+  static const float cDefaultMinCellSize;
+  static const int cMaxLevels = 24;
+
+  // The key is the proxy's index. mLevelKey is the object's key within its level's grid.
+  struct Proxy
+  {
+    SpatialPartitionKey mLevelKey;
+    int mLevel;
+    bool mActive;
+  };
+
+  std::vector<Proxy> mProxies;
+  std::vector<unsigned int> mFreeProxies;
+  std::vector<HashGridSpatialPartition> mLevels;
+};
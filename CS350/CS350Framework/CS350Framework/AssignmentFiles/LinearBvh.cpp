@@ -0,0 +1,887 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Linear bvh (morton code ordered) spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "LinearBvh.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Runs function(begin, end, chunkIndex) over [0, count) split into chunkCount contiguous
+// chunks with one thread per chunk. The chunk boundaries only depend on count and chunkCount.
+// Threads are spawned per call rather than pooled; this only runs above cParallelThreshold
+// where each pass is long enough for the spawn cost to be noise.
+template <typename Function>
+static void ParallelFor(size_t count, size_t chunkCount, const Function& function)
+{
+  if(chunkCount <= 1)
+  {
+    function(size_t(0), count, size_t(0));
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(chunkCount - 1);
+  for(size_t chunk = 1; chunk < chunkCount; ++chunk)
+    threads.push_back(std::thread(function, count * chunk / chunkCount, count * (chunk + 1) / chunkCount, chunk));
+
+  function(size_t(0), count / chunkCount, size_t(0));
+
+  for(size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+}
+
+static size_t GetChunkCount(size_t count)
+{
+  if(count < LinearBvh::cParallelThreshold)
+    return 1;
+
+  size_t threadCount = std::thread::hardware_concurrency();
+  return Math::Max(threadCount, size_t(1));
+}
+
+// Spreads the low 10 bits of value out so there are two zero bits between each of them.
+static unsigned int ExpandBits(unsigned int value)
+{
+  value = (value * 0x00010001u) & 0xFF0000FFu;
+  value = (value * 0x00000101u) & 0x0F00F00Fu;
+  value = (value * 0x00000011u) & 0xC30C30C3u;
+  value = (value * 0x00000005u) & 0x49249249u;
+  return value;
+}
+
+// 30-bit morton code of a point in the unit cube.
+static unsigned int MortonCode(float x, float y, float z)
+{
+  unsigned int ix = static_cast<unsigned int>(Math::Clamp(x * 1024.0f, 0.0f, 1023.0f));
+  unsigned int iy = static_cast<unsigned int>(Math::Clamp(y * 1024.0f, 0.0f, 1023.0f));
+  unsigned int iz = static_cast<unsigned int>(Math::Clamp(z * 1024.0f, 0.0f, 1023.0f));
+  return (ExpandBits(ix) << 2) | (ExpandBits(iy) << 1) | ExpandBits(iz);
+}
+
+static int CountLeadingZeros(unsigned long long value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  if(_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+    return 31 - static_cast<int>(index);
+  if(_BitScanReverse(&index, static_cast<unsigned long>(value)))
+    return 63 - static_cast<int>(index);
+  return 64;
+#else
+  return (value == 0) ? 64 : __builtin_clzll(value);
+#endif
+}
+
+//-----------------------------------------------------------------------------LinearBvh
+LinearBvh::LinearBvh()
+{
+  mType = SpatialPartitionTypes::LinearBvh;
+  mActiveCount = 0;
+  mDirty = false;
+  mSelfQuerySplitDepth = cDefaultSelfQuerySplitDepth;
+}
+
+void LinearBvh::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index;
+  if(mFreeProxies.empty())
+  {
+    index = static_cast<unsigned int>(mProxies.size());
+    mProxies.push_back(Proxy());
+  }
+  else
+  {
+    index = mFreeProxies.back();
+    mFreeProxies.pop_back();
+  }
+
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  proxy.mActive = true;
+
+  ++mActiveCount;
+  mDirty = true;
+  key.mUIntKey = index;
+}
+
+void LinearBvh::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  Proxy& proxy = mProxies[key.mUIntKey];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  mDirty = true;
+}
+
+void LinearBvh::RemoveData(SpatialPartitionKey& key)
+{
+  Proxy& proxy = mProxies[key.mUIntKey];
+  proxy.mActive = false;
+  proxy.mClientData = nullptr;
+  mFreeProxies.push_back(key.mUIntKey);
+
+  --mActiveCount;
+  mDirty = true;
+}
+
+void LinearBvh::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  mProxies.resize(count);
+  mFreeProxies.clear();
+  for(size_t i = 0; i < count; ++i)
+  {
+    mProxies[i].mAabb = data[i].mAabb;
+    mProxies[i].mClientData = data[i].mClientData;
+    mProxies[i].mActive = true;
+
+    if(keys != nullptr)
+      keys[i].mUIntKey = static_cast<unsigned int>(i);
+  }
+
+  mActiveCount = count;
+  mDirty = true;
+  Rebuild();
+}
+
+void LinearBvh::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root != cInvalidIndex)
+    DebugDraw(root, 0, level, transform, color, bitMask);
+}
+
+void LinearBvh::CastRay(const Ray& ray, CastResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return;
+
+  std::vector<unsigned int> stack;
+  stack.push_back(root);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+    QueryStatistic(statistics.Visit(IsLeaf(index), stack.size() + 1));
+
+    const Aabb& aabb = GetAabb(index);
+    float t;
+    if(!RayAabb(ray.mStart, ray.mDirection, aabb.mMin, aabb.mMax, t))
+      continue;
+
+    if(IsLeaf(index))
+    {
+      results.AddResult(CastResult(mLeaves[index & ~cLeafBit].mClientData, t));
+      continue;
+    }
+
+    stack.push_back(mNodes[index].mRight);
+    stack.push_back(mNodes[index].mLeft);
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool LinearBvh::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return false;
+
+  float t;
+  const Aabb& rootAabb = GetAabb(root);
+  if(!RayAabb(ray.mStart, ray.mDirection, rootAabb.mMin, rootAabb.mMax, t))
+    return false;
+
+  // Each entry is a node the ray hits and the time it enters it
+  ClosestHitQuery query(ray, refiner);
+  std::vector<std::pair<unsigned int, float> > stack;
+  stack.push_back(std::make_pair(root, t));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    float tEnter = stack.back().second;
+    stack.pop_back();
+
+    // A closer hit may have been found since the node was pushed
+    if(tEnter >= query.GetMaxTime())
+      continue;
+
+    if(IsLeaf(index))
+    {
+      query.AddObject(mLeaves[index & ~cLeafBit].mClientData, tEnter);
+      continue;
+    }
+
+    unsigned int leftIndex = mNodes[index].mLeft;
+    unsigned int rightIndex = mNodes[index].mRight;
+    const Aabb& left = GetAabb(leftIndex);
+    const Aabb& right = GetAabb(rightIndex);
+    float tLeft, tRight;
+    bool hitLeft = RayAabb(ray.mStart, ray.mDirection, left.mMin, left.mMax, tLeft) && tLeft < query.GetMaxTime();
+    bool hitRight = RayAabb(ray.mStart, ray.mDirection, right.mMin, right.mMax, tRight) && tRight < query.GetMaxTime();
+
+    // Push the farther child first so the nearer one is visited next
+    if(hitLeft && hitRight && tLeft < tRight)
+    {
+      stack.push_back(std::make_pair(rightIndex, tRight));
+      stack.push_back(std::make_pair(leftIndex, tLeft));
+      continue;
+    }
+    if(hitLeft)
+      stack.push_back(std::make_pair(leftIndex, tLeft));
+    if(hitRight)
+      stack.push_back(std::make_pair(rightIndex, tRight));
+  }
+  return query.GetResult(result);
+}
+
+bool LinearBvh::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return false;
+
+  AnyHitQuery query(ray, maxT, refiner);
+  std::vector<unsigned int> stack;
+  stack.push_back(root);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+
+    const Aabb& aabb = GetAabb(index);
+    float t;
+    if(!RayAabb(ray.mStart, ray.mDirection, aabb.mMin, aabb.mMax, t) || t > maxT)
+      continue;
+
+    if(IsLeaf(index))
+    {
+      if(query.IsHit(mLeaves[index & ~cLeafBit].mClientData, t))
+        return true;
+      continue;
+    }
+
+    stack.push_back(mNodes[index].mRight);
+    stack.push_back(mNodes[index].mLeft);
+  }
+  return false;
+}
+
+void LinearBvh::CastRays(const Ray* rays, size_t count, CastResults* results)
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return;
+
+  // Each entry is a node and the rays of the packet that reached it
+  std::vector<std::pair<unsigned int, int> > stack;
+  for(size_t first = 0; first < count; first += RayPacket::cWidth)
+  {
+    RayPacket packet;
+    packet.Load(rays + first, Math::Min(count - first, static_cast<size_t>(RayPacket::cWidth)));
+
+    stack.push_back(std::make_pair(root, packet.mMask));
+    while(!stack.empty())
+    {
+      unsigned int index = stack.back().first;
+      const Aabb& aabb = GetAabb(index);
+      int mask = packet.TestAabb(aabb, stack.back().second);
+      stack.pop_back();
+      if(mask == 0)
+        continue;
+
+      if(IsLeaf(index))
+      {
+        // Confirm each ray with the scalar test so the hits and times match CastRay
+        void* clientData = mLeaves[index & ~cLeafBit].mClientData;
+        for(int lane = 0; lane < RayPacket::cWidth; ++lane)
+        {
+          if((mask & (1 << lane)) == 0)
+            continue;
+
+          const Ray& ray = rays[first + lane];
+          float t;
+          if(RayAabb(ray.mStart, ray.mDirection, aabb.mMin, aabb.mMax, t))
+            results[first + lane].AddResult(CastResult(clientData, t));
+        }
+        continue;
+      }
+
+      stack.push_back(std::make_pair(mNodes[index].mRight, mask));
+      stack.push_back(std::make_pair(mNodes[index].mLeft, mask));
+    }
+  }
+}
+
+void LinearBvh::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return;
+
+  const Vector4* planes = frustum.GetPlanes();
+  mLastFrustumPlanes.resize(mNodes.size() + mLeaves.size(), 0);
+
+  // Each entry is a node and the planes it still has to be tested against
+  std::vector<std::pair<unsigned int, int> > stack;
+  stack.push_back(std::make_pair(root, cAllFrustumPlanes));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    int planeMask = stack.back().second;
+    stack.pop_back();
+    QueryStatistic(statistics.Visit(IsLeaf(index), stack.size() + 1));
+
+    size_t slot = IsLeaf(index) ? mNodes.size() + (index & ~cLeafBit) : index;
+    const Aabb& aabb = GetAabb(index);
+    size_t lastAxis = mLastFrustumPlanes[slot];
+    IntersectionType::Type type = FrustumAabb(planes, aabb.mMin, aabb.mMax, lastAxis, planeMask);
+    if(type == IntersectionType::Outside)
+    {
+      mLastFrustumPlanes[slot] = static_cast<unsigned char>(lastAxis);
+      continue;
+    }
+
+    // Everything below a fully contained node is also contained
+    if(type == IntersectionType::Inside || IsLeaf(index))
+    {
+      AddAllLeaves(index, results);
+      continue;
+    }
+
+    stack.push_back(std::make_pair(mNodes[index].mRight, planeMask));
+    stack.push_back(std::make_pair(mNodes[index].mLeft, planeMask));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void LinearBvh::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return;
+
+  NearestQuery query(point, k, maxDistance);
+  NearestNodeQueue queue;
+  queue.Push(GetAabb(root).GetDistanceSquared(point), root);
+
+  unsigned int index;
+  while(queue.Pop(query, index))
+  {
+    if(IsLeaf(index))
+    {
+      query.AddObject(mLeaves[index & ~cLeafBit].mClientData, GetAabb(index));
+      continue;
+    }
+
+    // Leaf children go straight into the query instead of through the queue
+    unsigned int children[2] = {mNodes[index].mLeft, mNodes[index].mRight};
+    for(int i = 0; i < 2; ++i)
+    {
+      float distanceSq = GetAabb(children[i]).GetDistanceSquared(point);
+      if(IsLeaf(children[i]))
+        query.AddObject(mLeaves[children[i] & ~cLeafBit].mClientData, distanceSq);
+      else if(distanceSq <= query.GetMaxDistanceSq())
+        queue.Push(distanceSq, children[i]);
+    }
+  }
+  query.GetResults(results);
+}
+
+void LinearBvh::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return;
+
+  std::vector<unsigned int> stack;
+  stack.push_back(root);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+
+    // Leaves only need the overlap test
+    if(IsLeaf(index))
+    {
+      const Leaf& leaf = mLeaves[index & ~cLeafBit];
+      if(region.Overlaps(leaf.mAabb))
+        results.AddResult(CastResult(leaf.mClientData, 0.0f));
+      continue;
+    }
+
+    IntersectionType::Type type = region.Classify(mNodes[index].mAabb);
+    if(type == IntersectionType::Outside)
+      continue;
+
+    if(type == IntersectionType::Inside)
+    {
+      AddAllLeaves(index, results);
+      continue;
+    }
+
+    stack.push_back(mNodes[index].mRight);
+    stack.push_back(mNodes[index].mLeft);
+  }
+}
+
+void LinearBvh::SelfQuery(QueryResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  unsigned int root = GetRoot();
+  if(root == cInvalidIndex)
+    return;
+
+  size_t threadCount = GetSelfQueryThreadCount(mLeaves.size());
+  if(threadCount == 1 || mSelfQuerySplitDepth <= 0)
+  {
+    // Every overlapping pair meets at exactly one internal node (their lowest common ancestor)
+    // so testing each node's left subtree against its right subtree finds every pair once.
+    SelfQueryWorker worker(mType);
+    for(size_t i = 0; i < mNodes.size(); ++i)
+      SelfQuery(mNodes[i].mLeft, mNodes[i].mRight, worker);
+    worker.Flush(results);
+    QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+    return;
+  }
+
+  std::vector<SelfQueryTask> tasks;
+  SelfQueryWorker splitter(mType);
+  SplitSelfQuery(root, root, mSelfQuerySplitDepth, tasks, splitter);
+  splitter.Flush(results);
+
+  RunSelfQueryTasks(tasks, threadCount, [this](const SelfQueryTask& task, SelfQueryWorker& worker)
+  {
+    if(task.mIndexA == task.mIndexB)
+      SelfQuery(task.mIndexA, worker);
+    else
+      SelfQuery(task.mIndexA, task.mIndexB, worker);
+  }, results, mType);
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool LinearBvh::GetHierarchyRoot(HierarchyNode& root)
+{
+  Rebuild();
+  unsigned int index = GetRoot();
+  if(index == cInvalidIndex)
+    return false;
+
+  root.mAabb = GetAabb(index);
+  root.mIndex = index;
+  root.mIsObject = IsLeaf(index);
+  root.mClientData = IsLeaf(index) ? mLeaves[index & ~cLeafBit].mClientData : nullptr;
+  return true;
+}
+
+void LinearBvh::GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const
+{
+  unsigned int nodeChildren[2] = {mNodes[node.mIndex].mLeft, mNodes[node.mIndex].mRight};
+  for(int i = 0; i < 2; ++i)
+  {
+    unsigned int index = nodeChildren[i];
+    HierarchyNode result;
+    result.mAabb = GetAabb(index);
+    result.mIndex = index;
+    result.mIsObject = IsLeaf(index);
+    result.mClientData = IsLeaf(index) ? mLeaves[index & ~cLeafBit].mClientData : nullptr;
+    children.push_back(result);
+  }
+}
+
+void LinearBvh::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Proxy& proxy = mProxies[key.mUIntKey];
+  data.mClientData = proxy.mClientData;
+  data.mAabb = proxy.mAabb;
+}
+
+void LinearBvh::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  Rebuild();
+  unsigned int root = GetRoot();
+  if(root != cInvalidIndex)
+    FilloutData(root, 0, results);
+}
+
+size_t LinearBvh::GetMemoryUsage() const
+{
+  return sizeof(*this) + mProxies.capacity() * sizeof(Proxy) + mFreeProxies.capacity() * sizeof(unsigned int) +
+         mNodes.capacity() * sizeof(Node) + mLeaves.capacity() * sizeof(Leaf) + mLastFrustumPlanes.capacity();
+}
+
+void LinearBvh::Rebuild() const
+{
+  if(!mDirty)
+    return;
+  mDirty = false;
+
+  mNodes.clear();
+  mLeaves.clear();
+  if(mActiveCount == 0)
+    return;
+
+  std::vector<unsigned int> activeProxies;
+  activeProxies.reserve(mActiveCount);
+  Aabb centerBounds;
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    if(!mProxies[i].mActive)
+      continue;
+
+    activeProxies.push_back(static_cast<unsigned int>(i));
+    centerBounds.Expand(mProxies[i].mAabb.GetCenter());
+  }
+
+  // Quantize each center to a 1024^3 grid over the center bounds. The key is the morton code in the high
+  // 32 bits and the object's index in the low 32 bits so every key is unique and the sort is deterministic.
+  size_t count = activeProxies.size();
+  size_t chunkCount = GetChunkCount(count);
+  Vector3 extents = centerBounds.mMax - centerBounds.mMin;
+  Vector3 scale;
+  for(uint32_t axis = 0; axis < 3; ++axis)
+    scale[axis] = (extents[axis] > 0.0f) ? 1.0f / extents[axis] : 0.0f;
+
+  std::vector<unsigned long long> keys(count);
+  ParallelFor(count, chunkCount, [&](size_t begin, size_t end, size_t)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      Vector3 local = mProxies[activeProxies[i]].mAabb.GetCenter() - centerBounds.mMin;
+      unsigned long long code = MortonCode(local.x * scale.x, local.y * scale.y, local.z * scale.z);
+      keys[i] = (code << 32) | i;
+    }
+  });
+
+  SortByMortonCode(keys);
+
+  mLeaves.resize(count);
+  ParallelFor(count, chunkCount, [&](size_t begin, size_t end, size_t)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      const Proxy& proxy = mProxies[activeProxies[keys[i] & 0xffffffffu]];
+      mLeaves[i].mAabb = proxy.mAabb;
+      mLeaves[i].mClientData = proxy.mClientData;
+      mLeaves[i].mParent = cInvalidIndex;
+    }
+  });
+
+  if(count == 1)
+    return;
+
+  mNodes.resize(count - 1);
+  EmitHierarchy(keys);
+  ComputeBounds();
+}
+
+const Aabb& LinearBvh::GetAabb(unsigned int index) const
+{
+  if(IsLeaf(index))
+    return mLeaves[index & ~cLeafBit].mAabb;
+  return mNodes[index].mAabb;
+}
+
+unsigned int LinearBvh::GetRoot() const
+{
+  if(mLeaves.empty())
+    return cInvalidIndex;
+  // A single object has no internal nodes so the root is the leaf itself
+  if(mNodes.empty())
+    return cLeafBit;
+  return 0;
+}
+
+void LinearBvh::SortByMortonCode(std::vector<unsigned long long>& keys) const
+{
+  // Least significant digit radix sort on the morton code (bits 32-61) in 8 bit digits. Each chunk
+  // histograms its own range, then the offsets are laid out bucket major/chunk minor so each chunk
+  // can scatter independently while keeping the sort stable.
+  size_t count = keys.size();
+  size_t chunkCount = GetChunkCount(count);
+  const size_t bucketCount = 256;
+
+  std::vector<unsigned long long> sorted(count);
+  std::vector<size_t> offsets(chunkCount * bucketCount);
+  for(int shift = 32; shift < 64; shift += 8)
+  {
+    std::fill(offsets.begin(), offsets.end(), size_t(0));
+    ParallelFor(count, chunkCount, [&](size_t begin, size_t end, size_t chunk)
+    {
+      size_t* histogram = &offsets[chunk * bucketCount];
+      for(size_t i = begin; i < end; ++i)
+        ++histogram[(keys[i] >> shift) & 0xff];
+    });
+
+    size_t total = 0;
+    for(size_t bucket = 0; bucket < bucketCount; ++bucket)
+    {
+      for(size_t chunk = 0; chunk < chunkCount; ++chunk)
+      {
+        size_t& offset = offsets[chunk * bucketCount + bucket];
+        size_t bucketSize = offset;
+        offset = total;
+        total += bucketSize;
+      }
+    }
+
+    ParallelFor(count, chunkCount, [&](size_t begin, size_t end, size_t chunk)
+    {
+      size_t* offset = &offsets[chunk * bucketCount];
+      for(size_t i = begin; i < end; ++i)
+        sorted[offset[(keys[i] >> shift) & 0xff]++] = keys[i];
+    });
+
+    keys.swap(sorted);
+  }
+}
+
+void LinearBvh::EmitHierarchy(const std::vector<unsigned long long>& keys) const
+{
+  // Length of the common prefix of keys i and j (-1 when j is out of range)
+  int count = static_cast<int>(keys.size());
+  auto delta = [&](int i, int j) -> int
+  {
+    if(j < 0 || j >= count)
+      return -1;
+    return CountLeadingZeros(keys[i] ^ keys[j]);
+  };
+
+  // Each internal node can be found independently (Karras, "Maximizing Parallelism in the
+  // Construction of BVHs, Octrees, and k-d Trees"). Node i covers a range of keys that starts or
+  // ends at i and is split where the common prefix of the range changes.
+  ParallelFor(count - 1, GetChunkCount(count), [&](size_t begin, size_t end, size_t)
+  {
+    for(size_t nodeIndex = begin; nodeIndex < end; ++nodeIndex)
+    {
+      int i = static_cast<int>(nodeIndex);
+
+      // Direction of the range and the prefix length the range must exceed
+      int direction = (delta(i, i + 1) - delta(i, i - 1)) >= 0 ? 1 : -1;
+      int deltaMin = delta(i, i - direction);
+
+      // Find the other end of the range with an exponential then binary search
+      int lengthMax = 2;
+      while(delta(i, i + lengthMax * direction) > deltaMin)
+        lengthMax *= 2;
+      int length = 0;
+      for(int step = lengthMax / 2; step >= 1; step /= 2)
+      {
+        if(delta(i, i + (length + step) * direction) > deltaMin)
+          length += step;
+      }
+      int j = i + length * direction;
+
+      // Binary search for the split position inside the range
+      int deltaNode = delta(i, j);
+      int split = 0;
+      for(int divisor = 2; ; divisor *= 2)
+      {
+        int step = (length + divisor - 1) / divisor;
+        if(delta(i, i + (split + step) * direction) > deltaNode)
+          split += step;
+        if(step == 1)
+          break;
+      }
+      int gamma = i + split * direction + Math::Min(direction, 0);
+
+      Node& node = mNodes[i];
+      node.mLeft = static_cast<unsigned int>(gamma);
+      node.mRight = static_cast<unsigned int>(gamma + 1);
+      if(Math::Min(i, j) == gamma)
+      {
+        node.mLeft |= cLeafBit;
+        mLeaves[gamma].mParent = i;
+      }
+      else
+        mNodes[gamma].mParent = i;
+
+      if(Math::Max(i, j) == gamma + 1)
+      {
+        node.mRight |= cLeafBit;
+        mLeaves[gamma + 1].mParent = i;
+      }
+      else
+        mNodes[gamma + 1].mParent = i;
+    }
+  });
+
+  mNodes[0].mParent = cInvalidIndex;
+}
+
+void LinearBvh::ComputeBounds() const
+{
+  // Walk up from every leaf in parallel. The first child to reach a node stops there and the
+  // second one (which knows both children are done) computes the node's aabb and keeps going.
+  size_t nodeCount = mNodes.size();
+  std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[nodeCount]);
+  for(size_t i = 0; i < nodeCount; ++i)
+    visits[i].store(0, std::memory_order_relaxed);
+
+  ParallelFor(mLeaves.size(), GetChunkCount(mLeaves.size()), [&](size_t begin, size_t end, size_t)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      unsigned int index = mLeaves[i].mParent;
+      while(index != cInvalidIndex)
+      {
+        if(visits[index].fetch_add(1, std::memory_order_acq_rel) == 0)
+          break;
+
+        Node& node = mNodes[index];
+        node.mAabb = Aabb::Combine(GetAabb(node.mLeft), GetAabb(node.mRight));
+        index = node.mParent;
+      }
+    }
+  });
+}
+
+void LinearBvh::SelfQuery(unsigned int index, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  if(IsLeaf(index))
+    return;
+
+  const Node& node = mNodes[index];
+  SelfQuery(node.mLeft, worker);
+  SelfQuery(node.mRight, worker);
+  SelfQuery(node.mLeft, node.mRight, worker);
+}
+
+void LinearBvh::SelfQuery(unsigned int indexA, unsigned int indexB, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  const Aabb& aabbA = GetAabb(indexA);
+  const Aabb& aabbB = GetAabb(indexB);
+  QueryStatistic(worker.mQueryStatistics.Visit(IsLeaf(indexA) && IsLeaf(indexB)));
+  if(!worker.TestAabbs(aabbA, aabbB))
+    return;
+
+  bool leafA = IsLeaf(indexA);
+  bool leafB = IsLeaf(indexB);
+  if(leafA && leafB)
+  {
+    worker.AddResult(mLeaves[indexA & ~cLeafBit].mClientData, mLeaves[indexB & ~cLeafBit].mClientData);
+    return;
+  }
+
+  // Split the larger node (by surface area) to keep the descent balanced
+  if(leafB || (!leafA && aabbA.GetSurfaceArea() >= aabbB.GetSurfaceArea()))
+  {
+    SelfQuery(mNodes[indexA].mLeft, indexB, worker);
+    SelfQuery(mNodes[indexA].mRight, indexB, worker);
+  }
+  else
+  {
+    SelfQuery(indexA, mNodes[indexB].mLeft, worker);
+    SelfQuery(indexA, mNodes[indexB].mRight, worker);
+  }
+}
+
+void LinearBvh::SplitSelfQuery(unsigned int indexA, unsigned int indexB, int depth, std::vector<SelfQueryTask>& tasks, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  if(depth <= 0)
+  {
+    tasks.push_back(SelfQueryTask(indexA, indexB));
+    return;
+  }
+
+  bool leafA = IsLeaf(indexA);
+  if(indexA == indexB)
+  {
+    if(leafA)
+      return;
+
+    const Node& node = mNodes[indexA];
+    SplitSelfQuery(node.mLeft, node.mLeft, depth - 1, tasks, worker);
+    SplitSelfQuery(node.mRight, node.mRight, depth - 1, tasks, worker);
+    SplitSelfQuery(node.mLeft, node.mRight, depth - 1, tasks, worker);
+    return;
+  }
+
+  const Aabb& aabbA = GetAabb(indexA);
+  const Aabb& aabbB = GetAabb(indexB);
+  QueryStatistic(worker.mQueryStatistics.Visit(IsLeaf(indexA) && IsLeaf(indexB)));
+  if(!worker.TestAabbs(aabbA, aabbB))
+    return;
+
+  bool leafB = IsLeaf(indexB);
+  if(leafA && leafB)
+  {
+    worker.AddResult(mLeaves[indexA & ~cLeafBit].mClientData, mLeaves[indexB & ~cLeafBit].mClientData);
+    return;
+  }
+
+  if(leafB || (!leafA && aabbA.GetSurfaceArea() >= aabbB.GetSurfaceArea()))
+  {
+    SplitSelfQuery(mNodes[indexA].mLeft, indexB, depth - 1, tasks, worker);
+    SplitSelfQuery(mNodes[indexA].mRight, indexB, depth - 1, tasks, worker);
+  }
+  else
+  {
+    SplitSelfQuery(indexA, mNodes[indexB].mLeft, depth - 1, tasks, worker);
+    SplitSelfQuery(indexA, mNodes[indexB].mRight, depth - 1, tasks, worker);
+  }
+}
+
+void LinearBvh::AddAllLeaves(unsigned int index, CastResults& results) const
+{
+  if(IsLeaf(index))
+  {
+    results.AddResult(CastResult(mLeaves[index & ~cLeafBit].mClientData, 0.0f));
+    return;
+  }
+
+  AddAllLeaves(mNodes[index].mLeft, results);
+  AddAllLeaves(mNodes[index].mRight, results);
+}
+
+void LinearBvh::DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const
+{
+  if(level == -1 || level == depth)
+    gDebugDrawer->DrawAabb(GetAabb(index)).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+
+  if(IsLeaf(index) || (level != -1 && depth >= level))
+    return;
+
+  DebugDraw(mNodes[index].mLeft, depth + 1, level, transform, color, bitMask);
+  DebugDraw(mNodes[index].mRight, depth + 1, level, transform, color, bitMask);
+}
+
+void LinearBvh::FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const
+{
+  SpatialPartitionQueryData data;
+  data.mAabb = GetAabb(index);
+  data.mClientData = IsLeaf(index) ? mLeaves[index & ~cLeafBit].mClientData : nullptr;
+  data.mDepth = depth;
+  results.push_back(data);
+
+  if(IsLeaf(index))
+    return;
+
+  FilloutData(mNodes[index].mLeft, depth + 1, results);
+  FilloutData(mNodes[index].mRight, depth + 1, results);
+}
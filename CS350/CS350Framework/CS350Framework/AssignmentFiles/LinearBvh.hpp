@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Linear bvh (morton code ordered) spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+#include "ParallelSelfQuery.hpp"
+
+//-----------------------------------------------------------------------------LinearBvh
+// A bvh that is thrown away and rebuilt from scratch whenever its contents change.
+// Objects are sorted by the 30-bit morton code of their aabb center (with a parallel
+// radix sort) and the hierarchy is emitted directly from the sorted codes (Karras 2012),
+// again in parallel. Insert/Update/Remove only touch a flat proxy array and mark the
+// tree dirty; the rebuild happens lazily before the next query. When most objects move
+// every frame this is cheaper than re-inserting them into a DynamicAabbTree.
+class LinearBvh : public SpatialPartition
+{
+public:
+  LinearBvh();
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  void CastRay(const Ray& ray, CastResults& results) override;
+  // Traverses with packets of RayPacket::cWidth rays, testing each node against the whole packet at once.
+  void CastRays(const Ray* rays, size_t count, CastResults* results) override;
+  // Visits the nearer child first and skips nodes entered after the closest hit so far.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Depth first, skipping nodes entered after maxT, until the first confirmed hit.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  // Children only test the planes their parent straddles and each node starts with the plane that
+  // last rejected it (see mLastFrustumPlanes).
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Best-first over the node bounds, closest node first.
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  // Nodes fully inside the region add their whole subtree without testing it.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  // Large hierarchies split the top mSelfQuerySplitDepth levels of the descent into tasks and run them
+  // on every core (see ParallelSelfQuery.hpp). The pairs are the same as the serial query's.
+  void SelfQuery(QueryResults& results) override;
+
+  bool GetHierarchyRoot(HierarchyNode& root) override;
+  void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+  size_t GetMemoryUsage() const override;
+
+  // Rebuild the hierarchy if anything changed since the last build.
+  void Rebuild() const;
+
+  // Below this many objects the build runs on the calling thread only.
+  static const size_t cParallelThreshold = 4096;
+  // Child indices with this bit set refer to mLeaves instead of mNodes.
+  static const unsigned int cLeafBit = 0x80000000u;
+  static const unsigned int cInvalidIndex = 0xffffffffu;
+
+  // An object stored in the partition. The key is the proxy's index.
+  struct Proxy
+  {
+    Aabb mAabb;
+    void* mClientData;
+    bool mActive;
+  };
+
+  // Internal node of the hierarchy. There are always leafCount - 1 of these and node 0 is the root.
+  struct Node
+  {
+    Aabb mAabb;
+    unsigned int mLeft;
+    unsigned int mRight;
+    unsigned int mParent;
+  };
+
+  // A leaf of the hierarchy in morton order.
+  struct Leaf
+  {
+    Aabb mAabb;
+    void* mClientData;
+    unsigned int mParent;
+  };
+
+  static bool IsLeaf(unsigned int index) { return (index & cLeafBit) != 0; }
+  const Aabb& GetAabb(unsigned int index) const;
+  unsigned int GetRoot() const;
+
+  void SortByMortonCode(std::vector<unsigned long long>& keys) const;
+  void EmitHierarchy(const std::vector<unsigned long long>& keys) const;
+  void ComputeBounds() const;
+
+  void SelfQuery(unsigned int index, SelfQueryWorker& worker) const;
+  void SelfQuery(unsigned int indexA, unsigned int indexB, SelfQueryWorker& worker) const;
+  // Walks the self query descent of (indexA, indexB) like the two above (indexA == indexB being a
+  // subtree against itself) but stops depth levels down and adds what's left as tasks.
+  void SplitSelfQuery(unsigned int indexA, unsigned int indexB, int depth, std::vector<SelfQueryTask>& tasks, SelfQueryWorker& worker) const;
+  void AddAllLeaves(unsigned int index, CastResults& results) const;
+  void DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const;
+  void FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const;
+
+  std::vector<Proxy> mProxies;
+  std::vector<unsigned int> mFreeProxies;
+  size_t mActiveCount;
+
+  // The built hierarchy is a cache of mProxies so it is rebuilt from const queries.
+  mutable std::vector<Node> mNodes;
+  mutable std::vector<Leaf> mLeaves;
+  mutable bool mDirty;
+  // How many levels of the self query are split into parallel tasks (0 runs it on one thread).
+  int mSelfQuerySplitDepth;
+  // Index of the frustum plane that last culled each node (internal nodes first, then leaves).
+  // Only a hint, so it survives rebuilds as is.
+  std::vector<unsigned char> mLastFrustumPlanes;
+};
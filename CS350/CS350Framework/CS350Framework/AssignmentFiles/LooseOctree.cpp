@@ -0,0 +1,612 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Loose octree spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "LooseOctree.hpp"
+#include <cmath>
+
+const float LooseOctree::cDefaultHalfSize = 256.0f;
+const unsigned int LooseOctree::cInvalidNode = (unsigned int)-1;
+const unsigned int LooseOctree::cRoot = 0;
+
+//-----------------------------------------------------------------------------LooseOctree
+LooseOctree::LooseOctree(const Vector3& center, float halfSize, int maxDepth)
+{
+  mType = SpatialPartitionTypes::LooseOctree;
+  mCenter = center;
+  mHalfSize = halfSize;
+  mMaxDepth = maxDepth;
+
+  Node root;
+  root.mCenter = center;
+  root.mHalfSize = halfSize;
+  root.mDepth = 0;
+  root.mParent = cInvalidNode;
+  for(int i = 0; i < 8; ++i)
+    root.mChildren[i] = cInvalidNode;
+  root.mSubtreeCount = 0;
+  root.mLastFrustumPlane = 0;
+  mNodes.push_back(root);
+}
+
+void LooseOctree::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index;
+  if(mFreeProxies.empty())
+  {
+    index = static_cast<unsigned int>(mProxies.size());
+    mProxies.push_back(Proxy());
+  }
+  else
+  {
+    index = mFreeProxies.back();
+    mFreeProxies.pop_back();
+  }
+
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  proxy.mActive = true;
+  AddToNode(index, FindNode(data.mAabb));
+
+  key.mUIntKey = index;
+}
+
+void LooseOctree::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index = key.mUIntKey;
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+
+  // Stay put as long as the loose bounds still hold the object and it's still the right size for this depth
+  const Node& node = mNodes[proxy.mNode];
+  float radius = Math::Length(data.mAabb.GetHalfSize());
+  if(node.mDepth == GetDepth(radius) && GetLooseAabb(proxy.mNode).Contains(data.mAabb))
+    return;
+
+  RemoveFromNode(index);
+  AddToNode(index, FindNode(data.mAabb));
+}
+
+void LooseOctree::RemoveData(SpatialPartitionKey& key)
+{
+  unsigned int index = key.mUIntKey;
+  RemoveFromNode(index);
+
+  Proxy& proxy = mProxies[index];
+  proxy.mClientData = nullptr;
+  proxy.mActive = false;
+  mFreeProxies.push_back(index);
+}
+
+void LooseOctree::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  for(size_t i = 0; i < mNodes.size(); ++i)
+  {
+    const Node& node = mNodes[i];
+    if(node.mSubtreeCount == 0)
+      continue;
+
+    if(level == -1 || level == node.mDepth)
+      gDebugDrawer->DrawAabb(GetLooseAabb(static_cast<unsigned int>(i))).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+  }
+}
+
+void LooseOctree::CastRay(const Ray& ray, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  std::vector<unsigned int> stack;
+  stack.push_back(cRoot);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    // The root isn't culled since objects outside of the world are stored there
+    float t;
+    if(index != cRoot)
+    {
+      QueryStatistic(statistics.Visit(false, stack.size() + 1));
+      Aabb looseAabb = GetLooseAabb(index);
+      if(!RayAabb(ray.mStart, ray.mDirection, looseAabb.mMin, looseAabb.mMax, t))
+        continue;
+    }
+
+    for(size_t i = 0; i < node.mObjects.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[node.mObjects[i]];
+      QueryStatistic(statistics.Visit(true));
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+        results.AddResult(CastResult(proxy.mClientData, t));
+    }
+
+    for(int i = 0; i < 8; ++i)
+    {
+      if(node.mChildren[i] != cInvalidNode)
+        stack.push_back(node.mChildren[i]);
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool LooseOctree::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  ClosestHitQuery query(ray, refiner);
+
+  // Each entry is a node the ray hits and the time it enters it. The root always is (see CastRay).
+  std::vector<std::pair<unsigned int, float> > stack;
+  stack.push_back(std::make_pair(cRoot, 0.0f));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    float tEnter = stack.back().second;
+    stack.pop_back();
+
+    // A closer hit may have been found since the node was pushed
+    if(tEnter >= query.GetMaxTime())
+      continue;
+
+    for(size_t i = 0; i < node.mObjects.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[node.mObjects[i]];
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+        query.AddObject(proxy.mClientData, t);
+    }
+
+    // Push the children farthest first so the nearest one is visited next
+    std::pair<float, unsigned int> hits[8];
+    int hitCount = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+      unsigned int child = node.mChildren[i];
+      if(child == cInvalidNode)
+        continue;
+
+      Aabb looseAabb = GetLooseAabb(child);
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, looseAabb.mMin, looseAabb.mMax, t) && t < query.GetMaxTime())
+        hits[hitCount++] = std::make_pair(t, child);
+    }
+    std::sort(hits, hits + hitCount);
+    for(int i = hitCount - 1; i >= 0; --i)
+      stack.push_back(std::make_pair(hits[i].second, hits[i].first));
+  }
+  return query.GetResult(result);
+}
+
+bool LooseOctree::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  AnyHitQuery query(ray, maxT, refiner);
+  std::vector<unsigned int> stack;
+  stack.push_back(cRoot);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    // The root isn't culled since objects outside of the world are stored there
+    float t;
+    if(index != cRoot)
+    {
+      Aabb looseAabb = GetLooseAabb(index);
+      if(!RayAabb(ray.mStart, ray.mDirection, looseAabb.mMin, looseAabb.mMax, t) || t > maxT)
+        continue;
+    }
+
+    for(size_t i = 0; i < node.mObjects.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[node.mObjects[i]];
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t) && query.IsHit(proxy.mClientData, t))
+        return true;
+    }
+
+    for(int i = 0; i < 8; ++i)
+    {
+      if(node.mChildren[i] != cInvalidNode)
+        stack.push_back(node.mChildren[i]);
+    }
+  }
+  return false;
+}
+
+void LooseOctree::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  const Vector4* planes = frustum.GetPlanes();
+
+  // Each entry is a node and the planes it still has to be tested against
+  std::vector<std::pair<unsigned int, int> > stack;
+  stack.push_back(std::make_pair(cRoot, cAllFrustumPlanes));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    int planeMask = stack.back().second;
+    stack.pop_back();
+    Node& node = mNodes[index];
+
+    size_t lastAxis = node.mLastFrustumPlane;
+    if(index != cRoot)
+    {
+      QueryStatistic(statistics.Visit(false, stack.size() + 1));
+      Aabb looseAabb = GetLooseAabb(index);
+      IntersectionType::Type type = FrustumAabb(planes, looseAabb.mMin, looseAabb.mMax, lastAxis, planeMask);
+      if(type == IntersectionType::Outside)
+      {
+        node.mLastFrustumPlane = static_cast<unsigned char>(lastAxis);
+        continue;
+      }
+
+      // Everything below a fully contained node is also contained
+      if(type == IntersectionType::Inside)
+      {
+        AddAllObjects(index, results);
+        continue;
+      }
+    }
+
+    for(size_t i = 0; i < node.mObjects.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[node.mObjects[i]];
+      QueryStatistic(statistics.Visit(true));
+      int objectMask = planeMask;
+      if(FrustumAabb(planes, proxy.mAabb.mMin, proxy.mAabb.mMax, lastAxis, objectMask) != IntersectionType::Outside)
+        results.AddResult(CastResult(proxy.mClientData, 0.0f));
+    }
+
+    for(int i = 0; i < 8; ++i)
+    {
+      if(node.mChildren[i] != cInvalidNode)
+        stack.push_back(std::make_pair(node.mChildren[i], planeMask));
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void LooseOctree::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  NearestQuery query(point, k, maxDistance);
+  NearestNodeQueue queue;
+  // The root isn't culled since objects outside of the world are stored there
+  queue.Push(0.0f, cRoot);
+
+  unsigned int index;
+  while(queue.Pop(query, index))
+  {
+    const Node& node = mNodes[index];
+    for(size_t i = 0; i < node.mObjects.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[node.mObjects[i]];
+      query.AddObject(proxy.mClientData, proxy.mAabb);
+    }
+
+    for(int i = 0; i < 8; ++i)
+    {
+      unsigned int child = node.mChildren[i];
+      if(child == cInvalidNode || mNodes[child].mSubtreeCount == 0)
+        continue;
+
+      float distanceSq = GetLooseAabb(child).GetDistanceSquared(point);
+      if(distanceSq <= query.GetMaxDistanceSq())
+        queue.Push(distanceSq, child);
+    }
+  }
+  query.GetResults(results);
+}
+
+void LooseOctree::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  std::vector<unsigned int> stack;
+  stack.push_back(cRoot);
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    // The root isn't culled since objects outside of the world are stored there
+    if(index != cRoot)
+    {
+      IntersectionType::Type type = region.Classify(GetLooseAabb(index));
+      if(type == IntersectionType::Outside)
+        continue;
+
+      if(type == IntersectionType::Inside)
+      {
+        AddAllObjects(index, results);
+        continue;
+      }
+    }
+
+    for(size_t i = 0; i < node.mObjects.size(); ++i)
+    {
+      const Proxy& proxy = mProxies[node.mObjects[i]];
+      if(region.Overlaps(proxy.mAabb))
+        results.AddResult(CastResult(proxy.mClientData, 0.0f));
+    }
+
+    for(int i = 0; i < 8; ++i)
+    {
+      unsigned int child = node.mChildren[i];
+      if(child != cInvalidNode && mNodes[child].mSubtreeCount != 0)
+        stack.push_back(child);
+    }
+  }
+}
+
+void LooseOctree::SelfQuery(QueryResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  // Siblings' loose bounds overlap, so an object can hit objects anywhere in the tree that its
+  // aabb reaches, not just in its own node's ancestors and descendants. Each object walks down
+  // from the root and only reports objects with a larger proxy index so every pair is found once.
+  // Each task is the run of proxies [mIndexA, mIndexB).
+  std::vector<SelfQueryTask> tasks;
+  unsigned int proxyCount = static_cast<unsigned int>(mProxies.size());
+  for(unsigned int begin = 0; begin < proxyCount; begin += cSelfQueryTaskSize)
+    tasks.push_back(SelfQueryTask(begin, Math::Min(begin + cSelfQueryTaskSize, proxyCount)));
+
+  size_t threadCount = GetSelfQueryThreadCount(mProxies.size() - mFreeProxies.size());
+  RunSelfQueryTasks(tasks, threadCount, [this](const SelfQueryTask& task, SelfQueryWorker& worker)
+  {
+    for(unsigned int i = task.mIndexA; i < task.mIndexB; ++i)
+    {
+      if(mProxies[i].mActive)
+        QueryNode(cRoot, i, worker);
+    }
+  }, results, mType);
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool LooseOctree::GetHierarchyRoot(HierarchyNode& root)
+{
+  if(mNodes[cRoot].mSubtreeCount == 0)
+    return false;
+
+  // Objects outside of the world are stored in the root so its bounds have to include them
+  const Node& node = mNodes[cRoot];
+  root.mAabb = GetLooseAabb(cRoot);
+  for(size_t i = 0; i < node.mObjects.size(); ++i)
+    root.mAabb = Aabb::Combine(root.mAabb, mProxies[node.mObjects[i]].mAabb);
+  root.mIndex = cRoot;
+  root.mIsObject = false;
+  root.mClientData = nullptr;
+  return true;
+}
+
+void LooseOctree::GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const
+{
+  const Node& octreeNode = mNodes[node.mIndex];
+  for(size_t i = 0; i < octreeNode.mObjects.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[octreeNode.mObjects[i]];
+    HierarchyNode result;
+    result.mAabb = proxy.mAabb;
+    result.mIndex = octreeNode.mObjects[i];
+    result.mIsObject = true;
+    result.mClientData = proxy.mClientData;
+    children.push_back(result);
+  }
+
+  for(int i = 0; i < 8; ++i)
+  {
+    unsigned int child = octreeNode.mChildren[i];
+    if(child == cInvalidNode || mNodes[child].mSubtreeCount == 0)
+      continue;
+
+    HierarchyNode result;
+    result.mAabb = GetLooseAabb(child);
+    result.mIndex = child;
+    result.mIsObject = false;
+    result.mClientData = nullptr;
+    children.push_back(result);
+  }
+}
+
+void LooseOctree::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Proxy& proxy = mProxies[key.mUIntKey];
+  data.mClientData = proxy.mClientData;
+  data.mAabb = proxy.mAabb;
+}
+
+void LooseOctree::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    SpatialPartitionQueryData data;
+    data.mAabb = proxy.mAabb;
+    data.mClientData = proxy.mClientData;
+    data.mDepth = mNodes[proxy.mNode].mDepth;
+    results.push_back(data);
+  }
+}
+
+Aabb LooseOctree::GetLooseAabb(unsigned int index) const
+{
+  const Node& node = mNodes[index];
+  return Aabb::BuildFromCenterAndHalfExtents(node.mCenter, Vector3(2.0f * node.mHalfSize));
+}
+
+int LooseOctree::GetDepth(float radius) const
+{
+  if(radius <= 0.0f)
+    return mMaxDepth;
+
+  // The deepest cells whose half size (mHalfSize / 2^depth) is still >= radius, i.e. floor(log2(mHalfSize / radius)).
+  // Comparing the exponents and mantissas directly keeps this exact where a divide and log2 could round.
+  int sizeExponent, radiusExponent;
+  float sizeMantissa = std::frexp(mHalfSize, &sizeExponent);
+  float radiusMantissa = std::frexp(radius, &radiusExponent);
+  int depth = sizeExponent - radiusExponent - (sizeMantissa >= radiusMantissa ? 0 : 1);
+  return Math::Clamp(depth, 0, mMaxDepth);
+}
+
+unsigned int LooseOctree::FindNode(const Aabb& aabb)
+{
+  Vector3 center = aabb.GetCenter();
+  int depth = GetDepth(Math::Length(aabb.GetHalfSize()));
+
+  // Index of the cell holding the center at that depth. Centers outside the world clamp to a
+  // border cell, which may not hold the object, in which case move up until a cell does.
+  int cell[3];
+  while(true)
+  {
+    int cellCount = 1 << depth;
+    float cellSize = 2.0f * mHalfSize / cellCount;
+    Vector3 cellCenter;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      int index = static_cast<int>(Math::Floor((center[axis] - (mCenter[axis] - mHalfSize)) / cellSize));
+      cell[axis] = Math::Clamp(index, 0, cellCount - 1);
+      cellCenter[axis] = mCenter[axis] - mHalfSize + (cell[axis] + 0.5f) * cellSize;
+    }
+
+    if(depth == 0 || Aabb::BuildFromCenterAndHalfExtents(cellCenter, Vector3(cellSize)).Contains(aabb))
+      break;
+    --depth;
+  }
+
+  // Each bit of the cell index (from the top) picks the octant at the next level down
+  unsigned int index = cRoot;
+  for(int level = depth - 1; level >= 0; --level)
+  {
+    int octant = ((cell[0] >> level) & 1) | (((cell[1] >> level) & 1) << 1) | (((cell[2] >> level) & 1) << 2);
+    index = GetOrCreateChild(index, octant);
+  }
+  return index;
+}
+
+unsigned int LooseOctree::GetOrCreateChild(unsigned int parent, int octant)
+{
+  if(mNodes[parent].mChildren[octant] != cInvalidNode)
+    return mNodes[parent].mChildren[octant];
+
+  unsigned int index;
+  if(mFreeNodes.empty())
+  {
+    index = static_cast<unsigned int>(mNodes.size());
+    mNodes.push_back(Node());
+  }
+  else
+  {
+    index = mFreeNodes.back();
+    mFreeNodes.pop_back();
+  }
+
+  // Allocating can grow the pool so the parent is looked up again
+  Node& parentNode = mNodes[parent];
+  Node& node = mNodes[index];
+  node.mHalfSize = parentNode.mHalfSize * 0.5f;
+  for(int axis = 0; axis < 3; ++axis)
+    node.mCenter[axis] = parentNode.mCenter[axis] + ((octant & (1 << axis)) ? node.mHalfSize : -node.mHalfSize);
+  node.mDepth = parentNode.mDepth + 1;
+  node.mParent = parent;
+  for(int i = 0; i < 8; ++i)
+    node.mChildren[i] = cInvalidNode;
+  node.mObjects.clear();
+  node.mSubtreeCount = 0;
+  node.mLastFrustumPlane = 0;
+
+  parentNode.mChildren[octant] = index;
+  return index;
+}
+
+void LooseOctree::AddToNode(unsigned int proxyIndex, unsigned int nodeIndex)
+{
+  Proxy& proxy = mProxies[proxyIndex];
+  Node& node = mNodes[nodeIndex];
+  proxy.mNode = nodeIndex;
+  proxy.mSlot = static_cast<unsigned int>(node.mObjects.size());
+  node.mObjects.push_back(proxyIndex);
+
+  for(unsigned int index = nodeIndex; index != cInvalidNode; index = mNodes[index].mParent)
+    ++mNodes[index].mSubtreeCount;
+}
+
+void LooseOctree::RemoveFromNode(unsigned int proxyIndex)
+{
+  const Proxy& proxy = mProxies[proxyIndex];
+  Node& node = mNodes[proxy.mNode];
+  unsigned int moved = node.mObjects.back();
+  node.mObjects[proxy.mSlot] = moved;
+  mProxies[moved].mSlot = proxy.mSlot;
+  node.mObjects.pop_back();
+
+  // Free every node whose subtree became empty (never the root)
+  unsigned int index = proxy.mNode;
+  while(index != cInvalidNode)
+  {
+    Node& current = mNodes[index];
+    unsigned int parent = current.mParent;
+    --current.mSubtreeCount;
+    if(current.mSubtreeCount == 0 && index != cRoot)
+    {
+      Node& parentNode = mNodes[parent];
+      for(int i = 0; i < 8; ++i)
+      {
+        if(parentNode.mChildren[i] == index)
+          parentNode.mChildren[i] = cInvalidNode;
+      }
+      current.mParent = cInvalidNode;
+      mFreeNodes.push_back(index);
+    }
+    index = parent;
+  }
+}
+
+void LooseOctree::QueryNode(unsigned int index, unsigned int proxyIndex, SelfQueryWorker& worker) const
+{
+  QueryStatistic(QueryDepthScope depthScope(worker.mQueryStatistics));
+  const Node& node = mNodes[index];
+  const Proxy& proxy = mProxies[proxyIndex];
+  if(index != cRoot)
+  {
+    QueryStatistic(worker.mQueryStatistics.Visit(false));
+    if(!worker.TestAabbs(GetLooseAabb(index), proxy.mAabb))
+      return;
+  }
+
+  for(size_t i = 0; i < node.mObjects.size(); ++i)
+  {
+    if(node.mObjects[i] <= proxyIndex)
+      continue;
+
+    const Proxy& other = mProxies[node.mObjects[i]];
+    QueryStatistic(worker.mQueryStatistics.Visit(true));
+    if(worker.TestAabbs(proxy.mAabb, other.mAabb))
+      worker.AddResult(proxy.mClientData, other.mClientData);
+  }
+
+  for(int i = 0; i < 8; ++i)
+  {
+    if(node.mChildren[i] != cInvalidNode)
+      QueryNode(node.mChildren[i], proxyIndex, worker);
+  }
+}
+
+void LooseOctree::AddAllObjects(unsigned int index, CastResults& results) const
+{
+  const Node& node = mNodes[index];
+  for(size_t i = 0; i < node.mObjects.size(); ++i)
+    results.AddResult(CastResult(mProxies[node.mObjects[i]].mClientData, 0.0f));
+
+  for(int i = 0; i < 8; ++i)
+  {
+    if(node.mChildren[i] != cInvalidNode)
+      AddAllObjects(node.mChildren[i], results);
+  }
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Loose octree spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+#include "ParallelSelfQuery.hpp"
+
+//-----------------------------------------------------------------------------LooseOctree
+// An octree over a fixed cube of the world whose nodes' bounds are loosened by a factor of 2
+// (each node's loose aabb is twice the size of its cell). An object whose bounding sphere radius is
+// at most a cell's half size is guaranteed to fit in the loose bounds of the cell holding its center,
+// so the depth comes straight from the radius and the node from the center, without any descent
+// tests. Objects can drift up to half a cell past their cell before they have to move.
+// Nodes are only allocated on the way to an object and freed once their subtree is empty.
+class LooseOctree : public SpatialPartition
+{
+public:
+  LooseOctree(const Vector3& center = Vector3::cZero, float halfSize = cDefaultHalfSize, int maxDepth = cDefaultMaxDepth);
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  void CastRay(const Ray& ray, CastResults& results) override;
+  // Children are visited in the order the ray enters their loose bounds and skipped once the
+  // closest hit so far is before that.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Depth first, skipping nodes entered after maxT, until the first confirmed hit.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  // Nodes that are fully inside the frustum add their whole subtree without testing it and
+  // children only test the planes their parent straddles.
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Best-first over the loose node bounds, closest node first.
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  // Nodes whose loose bounds are fully inside the region add their whole subtree without testing it.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  // Every object's walk is independent, so large trees hand out runs of cSelfQueryTaskSize proxies
+  // as tasks to every core (see ParallelSelfQuery.hpp).
+  void SelfQuery(QueryResults& results) override;
+
+  // The children of a node are its objects and its non-empty child nodes (with their loose bounds).
+  bool GetHierarchyRoot(HierarchyNode& root) override;
+  void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  // The depth of each object is the depth of the node it's stored in.
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+
+  static const float cDefaultHalfSize;
+  static const int cDefaultMaxDepth = 8;
+  static const unsigned int cSelfQueryTaskSize = 256;
+  static const unsigned int cInvalidNode;
+  // The root is always node 0 (it's never freed).
+  static const unsigned int cRoot;
+
+  struct Node
+  {
+    // The (tight) cell. The loose bounds are twice as big around the same center.
+    Vector3 mCenter;
+    float mHalfSize;
+    int mDepth;
+    unsigned int mParent;
+    unsigned int mChildren[8];
+    // Objects stored directly in this node
+    std::vector<unsigned int> mObjects;
+    // Objects stored in this node and all of its descendants. Free nodes have 0.
+    unsigned int mSubtreeCount;
+    // Index of the frustum plane that last culled this node, tested first next time.
+    unsigned char mLastFrustumPlane;
+  };
+
+  // An object stored in the tree. The key is the proxy's index.
+  struct Proxy
+  {
+    Aabb mAabb;
+    void* mClientData;
+    unsigned int mNode;
+    // Index in the node's object list
+    unsigned int mSlot;
+    bool mActive;
+  };
+
+  Aabb GetLooseAabb(unsigned int node) const;
+  // Depth whose cells are just big enough for an object of the given bounding sphere radius.
+  int GetDepth(float radius) const;
+  // Finds (allocating if needed) the node an aabb belongs in.
+  unsigned int FindNode(const Aabb& aabb);
+  unsigned int GetOrCreateChild(unsigned int node, int octant);
+
+  void AddToNode(unsigned int proxy, unsigned int node);
+  void RemoveFromNode(unsigned int proxy);
+
+  // Tests a proxy against the objects in a node's subtree with a larger proxy index.
+  void QueryNode(unsigned int node, unsigned int proxy, SelfQueryWorker& worker) const;
+  void AddAllObjects(unsigned int node, CastResults& results) const;
+
+  Vector3 mCenter;
+  float mHalfSize;
+  int mMaxDepth;
+
+  std::vector<Node> mNodes;
+  std::vector<unsigned int> mFreeNodes;
+  std::vector<Proxy> mProxies;
+  std::vector<unsigned int> mFreeProxies;
+};
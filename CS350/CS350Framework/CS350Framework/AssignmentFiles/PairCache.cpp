@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Persistent cache of broadphase pairs.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "PairCache.hpp"
+
+//-----------------------------------------------------------------------------PairCache
+size_t PairCache::PairHasher::operator()(const QueryResult& result) const
+{
+  size_t hash0 = std::hash<void*>()(result.mClientData0);
+  size_t hash1 = std::hash<void*>()(result.mClientData1);
+  return hash0 ^ (hash1 + 0x9e3779b9 + (hash0 << 6) + (hash0 >> 2));
+}
+
+PairCache::PairCache()
+{
+  mFrame = 0;
+}
+
+size_t PairCache::Update(const QueryResults& results)
+{
+  ++mFrame;
+  mBegan.clear();
+  mPersisted.clear();
+  mEnded.clear();
+
+  size_t duplicates = 0;
+  for(size_t i = 0; i < results.mResults.size(); ++i)
+  {
+    const QueryResult& result = results.mResults[i];
+    PairMap::iterator it = mPairMap.find(result);
+    if(it == mPairMap.end())
+    {
+      Pair pair = {result, mFrame, mFrame, cUnknownUserData};
+      mPairMap.insert(std::make_pair(result, static_cast<unsigned int>(mPairs.size())));
+      mPairs.push_back(pair);
+      continue;
+    }
+
+    Pair& pair = mPairs[it->second];
+    if(pair.mLastFrame == mFrame)
+      ++duplicates;
+    pair.mLastFrame = mFrame;
+  }
+
+  // Everything that wasn't reported this frame ended. Walking backwards means the pair swapped
+  // into a removed pair's slot has already been checked.
+  for(size_t i = mPairs.size(); i > 0; --i)
+  {
+    if(mPairs[i - 1].mLastFrame == mFrame)
+      continue;
+
+    mEnded.push_back(mPairs[i - 1].mResult);
+    RemovePair(static_cast<unsigned int>(i - 1));
+  }
+
+  for(size_t i = 0; i < mPairs.size(); ++i)
+  {
+    if(mPairs[i].mFirstFrame == mFrame)
+      mBegan.push_back(static_cast<unsigned int>(i));
+    else
+      mPersisted.push_back(static_cast<unsigned int>(i));
+  }
+  return duplicates;
+}
+
+void PairCache::RemoveClientData(void* clientData)
+{
+  for(size_t i = mPairs.size(); i > 0; --i)
+  {
+    const QueryResult& result = mPairs[i - 1].mResult;
+    if(result.mClientData0 == clientData || result.mClientData1 == clientData)
+      RemovePair(static_cast<unsigned int>(i - 1));
+  }
+
+  // The indices from the last update may have moved
+  mBegan.clear();
+  mPersisted.clear();
+}
+
+void PairCache::ClearUserData()
+{
+  for(size_t i = 0; i < mPairs.size(); ++i)
+    mPairs[i].mUserData = cUnknownUserData;
+}
+
+void PairCache::Clear()
+{
+  mPairs.clear();
+  mPairMap.clear();
+  mBegan.clear();
+  mPersisted.clear();
+  mEnded.clear();
+}
+
+void PairCache::RemovePair(unsigned int index)
+{
+  mPairMap.erase(mPairs[index].mResult);
+
+  // Move the last pair into the hole
+  unsigned int last = static_cast<unsigned int>(mPairs.size() - 1);
+  if(index != last)
+  {
+    mPairs[index] = mPairs[last];
+    mPairMap[mPairs[index].mResult] = index;
+  }
+  mPairs.pop_back();
+}
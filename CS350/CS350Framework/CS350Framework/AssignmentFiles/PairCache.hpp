@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Persistent cache of broadphase pairs.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+
+#include <unordered_map>
+
+//-----------------------------------------------------------------------------PairCache
+// Remembers the pairs a spatial partition's SelfQuery reported from one frame to the next so each
+// frame's pairs can be split into the ones that began, persisted or ended this frame. Pairs are keyed
+// by their client data in the (min, max) order QueryResult already uses, so the order a partition
+// reports a pair in doesn't matter. Each pair carries a user value the narrow phase can use to cache
+// its result (e.g. to skip or warm-start persistent pairs).
+class PairCache
+{
+public:
+  PairCache();
+
+  // Merges this frame's results into the cache and fills out mBegan, mPersisted and mEnded.
+  // Returns the number of pairs that were reported more than once (the repeats are ignored).
+  size_t Update(const QueryResults& results);
+  // Drops every pair with the given client data without reporting it as ended. Needed when
+  // an object is destroyed since its pairs would otherwise end next frame with a dangling pointer.
+  void RemoveClientData(void* clientData);
+  // Resets every pair's user data to cUnknownUserData. Used when whatever produced the
+  // cached values changed so they have to be recomputed.
+  void ClearUserData();
+  void Clear();
+
+  static const int cUnknownUserData = -1;
+
+  struct Pair
+  {
+    QueryResult mResult;
+    // The frames the pair was first and last reported in
+    size_t mFirstFrame;
+    size_t mLastFrame;
+    // Free for the narrow phase to use. New pairs start as cUnknownUserData.
+    int mUserData;
+  };
+
+  struct PairHasher
+  {
+    size_t operator()(const QueryResult& result) const;
+  };
+  struct PairEquals
+  {
+    bool operator()(const QueryResult& lhs, const QueryResult& rhs) const { return lhs == rhs; }
+  };
+  typedef std::unordered_map<QueryResult, unsigned int, PairHasher, PairEquals> PairMap;
+
+  void RemovePair(unsigned int index);
+
+  // All current pairs and the index of each one in mPairs
+  std::vector<Pair> mPairs;
+  PairMap mPairMap;
+  size_t mFrame;
+
+  // The results of the last Update. mBegan and mPersisted are indices into mPairs (valid until the
+  // cache is changed again) and together hold every pair in the cache.
+  std::vector<unsigned int> mBegan;
+  std::vector<unsigned int> mPersisted;
+  std::vector<QueryResult> mEnded;
+};
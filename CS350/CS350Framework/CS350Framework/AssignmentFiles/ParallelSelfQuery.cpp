@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Helpers for running a spatial partition's self query on several threads.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "ParallelSelfQuery.hpp"
+
+//-----------------------------------------------------------------------------SelfQueryWorker
+SelfQueryWorker::SelfQueryWorker(SpatialPartitionTypes::Types partitionType)
+{
+  mAabbAabbTests = 0;
+  mPartitionType = partitionType;
+}
+
+bool SelfQueryWorker::TestAabbs(const Aabb& aabb0, const Aabb& aabb1)
+{
+  ++mAabbAabbTests;
+
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    if(aabb0.mMax[axis] < aabb1.mMin[axis] || aabb1.mMax[axis] < aabb0.mMin[axis])
+      return false;
+  }
+  return true;
+}
+
+void SelfQueryWorker::AddResult(void* clientData0, void* clientData1)
+{
+  mResults.AddResult(QueryResult(clientData0, clientData1));
+}
+
+void SelfQueryWorker::Flush(QueryResults& results)
+{
+  if(results.mResults.empty())
+    results.mResults.swap(mResults.mResults);
+  else
+    results.mResults.insert(results.mResults.end(), mResults.mResults.begin(), mResults.mResults.end());
+  mResults.mResults.clear();
+
+  Application::mStatistics.mAabbAabbTests += mAabbAabbTests;
+  mAabbAabbTests = 0;
+
+#if SPATIAL_PARTITION_STATISTICS
+  QueryStatistics& statistics = Application::mStatistics.mPartitionStatistics[mPartitionType].mQueries[QueryStatisticsTypes::SelfQuery];
+  statistics.Add(mQueryStatistics);
+  mQueryStatistics.Clear();
+#endif
+}
+
+size_t GetSelfQueryThreadCount(size_t objectCount)
+{
+  if(objectCount < cParallelSelfQueryThreshold)
+    return 1;
+
+  size_t threadCount = std::thread::hardware_concurrency();
+  return Math::Max(threadCount, size_t(1));
+}
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Helpers for running a spatial partition's self query on several threads.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+
+#include <atomic>
+#include <thread>
+
+//-----------------------------------------------------------------------------SelfQueryTask
+// One independent piece of a self query. For the trees this is a (nodeA, nodeB) descent where
+// nodeA == nodeB means a node's subtree against itself, but what the indices mean is up to the partition.
+struct SelfQueryTask
+{
+  SelfQueryTask(unsigned int indexA, unsigned int indexB) : mIndexA(indexA), mIndexB(indexB) {}
+
+  unsigned int mIndexA;
+  unsigned int mIndexB;
+};
+
+//-----------------------------------------------------------------------------SelfQueryWorker
+// Everything one thread of a self query writes to. Workers share nothing, so the aabb tests (and
+// query statistics) are counted here instead of in Application::mStatistics and are merged once the
+// query is done. partitionType is whose query statistics they're merged into.
+class SelfQueryWorker
+{
+public:
+  SelfQueryWorker(SpatialPartitionTypes::Types partitionType = SpatialPartitionTypes::Unknown);
+
+  // Same test as AabbAabb.
+  bool TestAabbs(const Aabb& aabb0, const Aabb& aabb1);
+  void AddResult(void* clientData0, void* clientData1);
+  // Appends the results to the given ones and adds the statistics to Application::mStatistics.
+  void Flush(QueryResults& results);
+
+  QueryResults mResults;
+  size_t mAabbAabbTests;
+  SpatialPartitionTypes::Types mPartitionType;
+#if SPATIAL_PARTITION_STATISTICS
+  // The nodes and leaves visited and the recursion depth (the query and its results are counted by the partition).
+  QueryStatistics mQueryStatistics;
+#endif
+};
+
+// Below this many objects a self query isn't worth the cost of starting threads.
+static const size_t cParallelSelfQueryThreshold = 4096;
+
+// How many levels of a tree's self query descent are split off into tasks by default. Deep enough to
+// give every thread plenty of tasks, shallow enough that splitting stays cheap.
+static const int cDefaultSelfQuerySplitDepth = 8;
+
+// The number of threads to run a self query over objectCount objects with (1 means run it serially).
+size_t GetSelfQueryThreadCount(size_t objectCount);
+
+// Runs runTask(task, worker) for every task on threadCount threads, each with its own worker, and
+// flushes the workers into results in order. The cost of a task can vary a lot so instead of giving
+// each thread a fixed range the threads take the next task from a shared counter.
+template <typename Function>
+void RunSelfQueryTasks(const std::vector<SelfQueryTask>& tasks, size_t threadCount, const Function& runTask, QueryResults& results,
+                       SpatialPartitionTypes::Types partitionType = SpatialPartitionTypes::Unknown)
+{
+  threadCount = Math::Max(Math::Min(threadCount, tasks.size()), size_t(1));
+  std::vector<SelfQueryWorker> workers(threadCount, SelfQueryWorker(partitionType));
+  std::atomic<size_t> nextTask(0);
+
+  auto work = [&](size_t workerIndex)
+  {
+    SelfQueryWorker& worker = workers[workerIndex];
+    for(size_t i = nextTask++; i < tasks.size(); i = nextTask++)
+      runTask(tasks[i], worker);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount - 1);
+  for(size_t i = 1; i < threadCount; ++i)
+    threads.push_back(std::thread(work, i));
+  work(0);
+
+  for(size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+
+  for(size_t i = 0; i < workers.size(); ++i)
+    workers[i].Flush(results);
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Overlap queries between two different spatial partitions.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "PartitionQuery.hpp"
+
+// A node from each partition that still has to be tested. B's bounds are also kept in A's space.
+struct PartitionQueryEntry
+{
+  HierarchyNode mNodeA;
+  HierarchyNode mNodeB;
+  Aabb mAabbB;
+};
+
+// Partitions that don't keep bounds (e.g. n-squared) fill out the default inverted aabb. Those
+// objects could touch anything so they're given these bounds instead.
+static const Aabb cUnboundedAabb(Vector3(-Math::PositiveMax()), Vector3(Math::PositiveMax()));
+
+static bool IsInverted(const Aabb& aabb)
+{
+  return aabb.mMin.x > aabb.mMax.x;
+}
+
+static bool IsUnbounded(const Aabb& aabb)
+{
+  return aabb.mMin.x == -Math::PositiveMax() && aabb.mMax.x == Math::PositiveMax();
+}
+
+// The root of the partition's hierarchy, or every object in it if it doesn't have one.
+static void GetStartNodes(SpatialPartition& partition, std::vector<HierarchyNode>& nodes)
+{
+  HierarchyNode root;
+  if(partition.GetHierarchyRoot(root))
+  {
+    nodes.push_back(root);
+    return;
+  }
+
+  std::vector<SpatialPartitionQueryData> data;
+  partition.FilloutData(data);
+  for(size_t i = 0; i < data.size(); ++i)
+  {
+    HierarchyNode object;
+    object.mAabb = IsInverted(data[i].mAabb) ? cUnboundedAabb : data[i].mAabb;
+    object.mIndex = static_cast<unsigned int>(i);
+    object.mIsObject = true;
+    object.mClientData = data[i].mClientData;
+    nodes.push_back(object);
+  }
+}
+
+// Descends every pair on the stack (splitting the larger node of each) until it's empty.
+static void DescendPairs(SpatialPartition& partitionA, SpatialPartition& partitionB, const Matrix4& bToA,
+                         std::vector<PartitionQueryEntry>& stack, std::vector<HierarchyNode>& children, QueryResults& results)
+{
+  while(!stack.empty())
+  {
+    PartitionQueryEntry entry = stack.back();
+    stack.pop_back();
+
+    const Aabb& aabbA = entry.mNodeA.mAabb;
+    if(!AabbAabb(aabbA.mMin, aabbA.mMax, entry.mAabbB.mMin, entry.mAabbB.mMax))
+      continue;
+
+    if(entry.mNodeA.mIsObject && entry.mNodeB.mIsObject)
+    {
+      // Keep the partition order instead of QueryResult's pointer order
+      QueryResult result(entry.mNodeA.mClientData, entry.mNodeB.mClientData);
+      result.mClientData0 = entry.mNodeA.mClientData;
+      result.mClientData1 = entry.mNodeB.mClientData;
+      results.AddResult(result);
+      continue;
+    }
+
+    // Split the larger node (by surface area, in A's space)
+    children.clear();
+    bool splitA = !entry.mNodeA.mIsObject && (entry.mNodeB.mIsObject || aabbA.GetSurfaceArea() >= entry.mAabbB.GetSurfaceArea());
+    if(splitA)
+    {
+      partitionA.GetHierarchyChildren(entry.mNodeA, children);
+      for(size_t i = 0; i < children.size(); ++i)
+      {
+        PartitionQueryEntry childEntry = {children[i], entry.mNodeB, entry.mAabbB};
+        stack.push_back(childEntry);
+      }
+    }
+    else
+    {
+      partitionB.GetHierarchyChildren(entry.mNodeB, children);
+      for(size_t i = 0; i < children.size(); ++i)
+      {
+        PartitionQueryEntry childEntry = {entry.mNodeA, children[i], children[i].mAabb};
+        childEntry.mAabbB.Transform(bToA);
+        stack.push_back(childEntry);
+      }
+    }
+  }
+}
+
+void QueryPartitions(SpatialPartition& partitionA, SpatialPartition& partitionB, const Matrix4& bToA, QueryResults& results)
+{
+  std::vector<HierarchyNode> nodesA;
+  std::vector<HierarchyNode> nodesB;
+  GetStartNodes(partitionA, nodesA);
+  GetStartNodes(partitionB, nodesB);
+  std::vector<Aabb> aabbsB(nodesB.size());
+  for(size_t i = 0; i < nodesB.size(); ++i)
+  {
+    // Transforming the unbounded aabb would overflow (and produce nans), it's the same in any space
+    if(IsUnbounded(nodesB[i].mAabb))
+      aabbsB[i] = cUnboundedAabb;
+    else
+    {
+      aabbsB[i] = nodesB[i].mAabb;
+      aabbsB[i].Transform(bToA);
+    }
+  }
+
+  // Each of A's start nodes is finished before the next one so the stack stays small even when
+  // neither partition has a hierarchy (and every pair of objects is a start pair)
+  std::vector<PartitionQueryEntry> stack;
+  std::vector<HierarchyNode> children;
+  for(size_t i = 0; i < nodesA.size(); ++i)
+  {
+    for(size_t j = 0; j < nodesB.size(); ++j)
+    {
+      PartitionQueryEntry entry = {nodesA[i], nodesB[j], aabbsB[j]};
+      stack.push_back(entry);
+    }
+    DescendPairs(partitionA, partitionB, bToA, stack, children, results);
+  }
+}
+
+void QueryPartitions(SpatialPartition& partitionA, SpatialPartition& partitionB, QueryResults& results)
+{
+  QueryPartitions(partitionA, partitionB, Matrix4::cIdentity, results);
+}
@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Overlap queries between two different spatial partitions.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+
+// Finds every pair of objects (one from each partition) whose bounds overlap, with partitionB's bounds
+// moved into partitionA's space by bToA. That lets two midphases be tested against each other in
+// their own local spaces (bToA = inverse(worldA) * worldB) without rebuilding either one.
+// Unlike a SelfQuery's results, mClientData0 is always partitionA's object and mClientData1 partitionB's.
+// The two hierarchies are descended together, always splitting the larger node, so only overlapping
+// branches are ever paired up. A partition without a hierarchy (see GetHierarchyRoot) has each of
+// its objects descend the other partition instead. Objects without bounds (such as the n-squared
+// partition's) are paired with everything they're tested against.
+void QueryPartitions(SpatialPartition& partitionA, SpatialPartition& partitionB, const Matrix4& bToA, QueryResults& results);
+void QueryPartitions(SpatialPartition& partitionA, SpatialPartition& partitionB, QueryResults& results);
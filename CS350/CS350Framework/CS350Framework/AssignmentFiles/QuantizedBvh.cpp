@@ -0,0 +1,703 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Bvh with 16-bit quantized node bounds for static data (e.g. a model's midphase).
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "QuantizedBvh.hpp"
+
+//-----------------------------------------------------------------------------QuantizedBvh
+QuantizedBvh::QuantizedBvh()
+{
+  mType = SpatialPartitionTypes::QuantizedBvh;
+  mRoot = cInvalidIndex;
+}
+
+void QuantizedBvh::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  if(mPendingData.empty())
+    GatherLeaves(mPendingData);
+
+  key.mUIntKey = static_cast<unsigned int>(mPendingData.size());
+  mPendingData.push_back(data);
+}
+
+void QuantizedBvh::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  if(mPendingData.empty())
+    GatherLeaves(mPendingData);
+
+  mPendingData[key.mUIntKey] = data;
+}
+
+void QuantizedBvh::RemoveData(SpatialPartitionKey&)
+{
+  ErrorIf(true, "QuantizedBvh - Objects can't be removed. Build the tree again without them.");
+}
+
+void QuantizedBvh::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  mNodes.clear();
+  mClientData.clear();
+  mRoot = cInvalidIndex;
+  if(count == 0)
+    return;
+
+  // Build the float tree over the keys so its leaves say which object they are
+  std::vector<SpatialPartitionData> items(count);
+  mClientData.resize(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    items[i].mAabb = data[i].mAabb;
+    items[i].mClientData = reinterpret_cast<void*>(i);
+    mClientData[i] = data[i].mClientData;
+
+    if(keys != nullptr)
+      keys[i].mUIntKey = static_cast<unsigned int>(i);
+  }
+
+  DynamicAabbTree tree;
+  tree.Build(items.data(), count);
+
+  const DynamicAabbTree::Node& root = tree.mNodes[tree.mRoot];
+  mRootAabb = root.mAabb;
+  if(root.IsLeaf())
+  {
+    mRoot = cLeafBit;
+    return;
+  }
+
+  // A tree with count leaves has count - 1 internal nodes
+  mNodes.reserve(count - 1);
+  mRoot = Compress(tree, tree.mRoot, mRootAabb);
+}
+
+void QuantizedBvh::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  Rebuild();
+  if(mRoot != cInvalidIndex)
+    DebugDraw(mRoot, mRootAabb, 0, level, transform, color, bitMask);
+}
+
+void QuantizedBvh::CastRay(const Ray& ray, CastResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mRoot == cInvalidIndex)
+    return;
+
+  QueryStatistic(statistics.Visit(IsLeaf(mRoot), 1));
+  float t;
+  if(!RayAabb(ray.mStart, ray.mDirection, mRootAabb.mMin, mRootAabb.mMax, t))
+    return;
+
+  if(IsLeaf(mRoot))
+  {
+    results.AddResult(CastResult(mClientData[mRoot & ~cLeafBit], t));
+    QueryStatistic(++statistics.mResults);
+    return;
+  }
+
+  // Each entry is a node that was hit and its decoded bounds
+  std::vector<std::pair<unsigned int, Aabb> > stack;
+  stack.push_back(std::make_pair(mRoot, mRootAabb));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    Aabb box = stack.back().second;
+    stack.pop_back();
+
+    Vector3 scale = ComputeScale(box);
+    for(int i = 1; i >= 0; --i)
+    {
+      Aabb childBox;
+      DecodeChild(box, scale, node, i, childBox);
+      QueryStatistic(statistics.Visit(IsLeaf(node.mChildren[i]), stack.size() + 1));
+      if(!RayAabb(ray.mStart, ray.mDirection, childBox.mMin, childBox.mMax, t))
+        continue;
+
+      unsigned int child = node.mChildren[i];
+      if(IsLeaf(child))
+        results.AddResult(CastResult(mClientData[child & ~cLeafBit], t));
+      else
+        stack.push_back(std::make_pair(child, childBox));
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool QuantizedBvh::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  Rebuild();
+  if(mRoot == cInvalidIndex)
+    return false;
+
+  float t;
+  if(!RayAabb(ray.mStart, ray.mDirection, mRootAabb.mMin, mRootAabb.mMax, t))
+    return false;
+
+  ClosestHitQuery query(ray, refiner);
+  if(IsLeaf(mRoot))
+  {
+    query.AddObject(mClientData[mRoot & ~cLeafBit], t);
+    return query.GetResult(result);
+  }
+
+  // A node the ray hits, its decoded bounds and the time the ray enters it
+  struct Entry
+  {
+    unsigned int mIndex;
+    Aabb mBox;
+    float mTime;
+  };
+  std::vector<Entry> stack;
+  Entry rootEntry = {mRoot, mRootAabb, t};
+  stack.push_back(rootEntry);
+  while(!stack.empty())
+  {
+    Entry entry = stack.back();
+    stack.pop_back();
+
+    // A closer hit may have been found since the node was pushed
+    if(entry.mTime >= query.GetMaxTime())
+      continue;
+
+    const Node& node = mNodes[entry.mIndex];
+    Vector3 scale = ComputeScale(entry.mBox);
+    Entry children[2];
+    bool hits[2];
+    for(int i = 0; i < 2; ++i)
+    {
+      children[i].mIndex = node.mChildren[i];
+      DecodeChild(entry.mBox, scale, node, i, children[i].mBox);
+      hits[i] = RayAabb(ray.mStart, ray.mDirection, children[i].mBox.mMin, children[i].mBox.mMax, children[i].mTime);
+    }
+
+    // Handle the farther child last so a leaf hit on the nearer one can already prune it.
+    // Nodes are pushed farther first so the nearer one is visited next.
+    int nearChild = (hits[0] && hits[1] && children[1].mTime < children[0].mTime) ? 1 : 0;
+    int order[2] = {nearChild, 1 - nearChild};
+    for(int i = 0; i < 2; ++i)
+    {
+      const Entry& child = children[order[i]];
+      if(hits[order[i]] && IsLeaf(child.mIndex))
+        query.AddObject(mClientData[child.mIndex & ~cLeafBit], child.mTime);
+    }
+    for(int i = 1; i >= 0; --i)
+    {
+      const Entry& child = children[order[i]];
+      if(hits[order[i]] && !IsLeaf(child.mIndex) && child.mTime < query.GetMaxTime())
+        stack.push_back(child);
+    }
+  }
+  return query.GetResult(result);
+}
+
+bool QuantizedBvh::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  Rebuild();
+  if(mRoot == cInvalidIndex)
+    return false;
+
+  float t;
+  if(!RayAabb(ray.mStart, ray.mDirection, mRootAabb.mMin, mRootAabb.mMax, t) || t > maxT)
+    return false;
+
+  AnyHitQuery query(ray, maxT, refiner);
+  if(IsLeaf(mRoot))
+    return query.IsHit(mClientData[mRoot & ~cLeafBit], t);
+
+  // Each entry is a node that was hit and its decoded bounds
+  std::vector<std::pair<unsigned int, Aabb> > stack;
+  stack.push_back(std::make_pair(mRoot, mRootAabb));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    Aabb box = stack.back().second;
+    stack.pop_back();
+
+    Vector3 scale = ComputeScale(box);
+    for(int i = 1; i >= 0; --i)
+    {
+      Aabb childBox;
+      DecodeChild(box, scale, node, i, childBox);
+      if(!RayAabb(ray.mStart, ray.mDirection, childBox.mMin, childBox.mMax, t) || t > maxT)
+        continue;
+
+      unsigned int child = node.mChildren[i];
+      if(!IsLeaf(child))
+        stack.push_back(std::make_pair(child, childBox));
+      else if(query.IsHit(mClientData[child & ~cLeafBit], t))
+        return true;
+    }
+  }
+  return false;
+}
+
+void QuantizedBvh::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mRoot == cInvalidIndex)
+    return;
+
+  // Each entry is a node, its decoded bounds and the planes it still has to be tested against
+  struct Entry
+  {
+    unsigned int mIndex;
+    Aabb mBox;
+    int mPlaneMask;
+  };
+
+  const Vector4* planes = frustum.GetPlanes();
+  mLastFrustumPlanes.resize(mNodes.size() + mClientData.size(), 0);
+
+  Entry root = {mRoot, mRootAabb, cAllFrustumPlanes};
+  std::vector<Entry> stack;
+  stack.push_back(root);
+  while(!stack.empty())
+  {
+    Entry entry = stack.back();
+    stack.pop_back();
+    QueryStatistic(statistics.Visit(IsLeaf(entry.mIndex), stack.size() + 1));
+
+    size_t slot = IsLeaf(entry.mIndex) ? mNodes.size() + (entry.mIndex & ~cLeafBit) : entry.mIndex;
+    size_t lastAxis = mLastFrustumPlanes[slot];
+    IntersectionType::Type type = FrustumAabb(planes, entry.mBox.mMin, entry.mBox.mMax, lastAxis, entry.mPlaneMask);
+    if(type == IntersectionType::Outside)
+    {
+      mLastFrustumPlanes[slot] = static_cast<unsigned char>(lastAxis);
+      continue;
+    }
+
+    // Everything below a fully contained node is also contained
+    if(type == IntersectionType::Inside || IsLeaf(entry.mIndex))
+    {
+      AddAllLeaves(entry.mIndex, results);
+      continue;
+    }
+
+    const Node& node = mNodes[entry.mIndex];
+    Vector3 scale = ComputeScale(entry.mBox);
+    for(int i = 1; i >= 0; --i)
+    {
+      Entry child = {node.mChildren[i], Aabb(), entry.mPlaneMask};
+      DecodeChild(entry.mBox, scale, node, i, child.mBox);
+      stack.push_back(child);
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void QuantizedBvh::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  Rebuild();
+  if(mRoot == cInvalidIndex)
+    return;
+
+  NearestQuery query(point, k, maxDistance);
+  if(IsLeaf(mRoot))
+  {
+    query.AddObject(mClientData[mRoot & ~cLeafBit], mRootAabb);
+    query.GetResults(results);
+    return;
+  }
+
+  // The queue holds indices into boxes, which keeps each queued node's decoded bounds
+  std::vector<std::pair<unsigned int, Aabb> > boxes;
+  boxes.push_back(std::make_pair(mRoot, mRootAabb));
+  NearestNodeQueue queue;
+  queue.Push(mRootAabb.GetDistanceSquared(point), 0);
+
+  unsigned int entry;
+  while(queue.Pop(query, entry))
+  {
+    const Node& node = mNodes[boxes[entry].first];
+    Aabb box = boxes[entry].second;
+    Vector3 scale = ComputeScale(box);
+    for(int i = 0; i < 2; ++i)
+    {
+      Aabb childBox;
+      DecodeChild(box, scale, node, i, childBox);
+      float distanceSq = childBox.GetDistanceSquared(point);
+
+      unsigned int child = node.mChildren[i];
+      if(IsLeaf(child))
+        query.AddObject(mClientData[child & ~cLeafBit], distanceSq);
+      else if(distanceSq <= query.GetMaxDistanceSq())
+      {
+        queue.Push(distanceSq, static_cast<unsigned int>(boxes.size()));
+        boxes.push_back(std::make_pair(child, childBox));
+      }
+    }
+  }
+  query.GetResults(results);
+}
+
+void QuantizedBvh::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  Rebuild();
+  if(mRoot == cInvalidIndex)
+    return;
+
+  IntersectionType::Type type = region.Classify(mRootAabb);
+  if(type == IntersectionType::Outside)
+    return;
+
+  if(type == IntersectionType::Inside || IsLeaf(mRoot))
+  {
+    AddAllLeaves(mRoot, results);
+    return;
+  }
+
+  // Each entry is a node that overlaps the region and its decoded bounds
+  std::vector<std::pair<unsigned int, Aabb> > stack;
+  stack.push_back(std::make_pair(mRoot, mRootAabb));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    Aabb box = stack.back().second;
+    stack.pop_back();
+
+    Vector3 scale = ComputeScale(box);
+    for(int i = 1; i >= 0; --i)
+    {
+      Aabb childBox;
+      DecodeChild(box, scale, node, i, childBox);
+
+      unsigned int child = node.mChildren[i];
+      if(IsLeaf(child))
+      {
+        if(region.Overlaps(childBox))
+          results.AddResult(CastResult(mClientData[child & ~cLeafBit], 0.0f));
+        continue;
+      }
+
+      type = region.Classify(childBox);
+      if(type == IntersectionType::Inside)
+        AddAllLeaves(child, results);
+      else if(type == IntersectionType::Overlaps)
+        stack.push_back(std::make_pair(child, childBox));
+    }
+  }
+}
+
+void QuantizedBvh::SelfQuery(QueryResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mRoot != cInvalidIndex)
+    SelfQuery(mRoot, mRootAabb, results);
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool QuantizedBvh::GetHierarchyRoot(HierarchyNode& root)
+{
+  Rebuild();
+  if(mRoot == cInvalidIndex)
+    return false;
+
+  root.mAabb = mRootAabb;
+  root.mIndex = mRoot;
+  root.mIsObject = IsLeaf(mRoot);
+  root.mClientData = IsLeaf(mRoot) ? mClientData[mRoot & ~cLeafBit] : nullptr;
+  return true;
+}
+
+void QuantizedBvh::GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const
+{
+  // The step sizes only depend on the decoded bounds
+  Vector3 scale = ComputeScale(node.mAabb);
+
+  const Node& quantizedNode = mNodes[node.mIndex];
+  for(int i = 0; i < 2; ++i)
+  {
+    Aabb childBox;
+    DecodeChild(node.mAabb, scale, quantizedNode, i, childBox);
+
+    unsigned int child = quantizedNode.mChildren[i];
+    HierarchyNode result;
+    result.mAabb = childBox;
+    result.mIndex = child;
+    result.mIsObject = IsLeaf(child);
+    result.mClientData = IsLeaf(child) ? mClientData[child & ~cLeafBit] : nullptr;
+    children.push_back(result);
+  }
+}
+
+void QuantizedBvh::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  if(!mPendingData.empty())
+  {
+    data = mPendingData[key.mUIntKey];
+    return;
+  }
+
+  // Nodes don't know their parents so the leaf has to be found from the root
+  std::vector<SpatialPartitionData> leaves;
+  GatherLeaves(leaves);
+  data = leaves[key.mUIntKey];
+}
+
+void QuantizedBvh::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  if(!mPendingData.empty())
+  {
+    for(size_t i = 0; i < mPendingData.size(); ++i)
+      results.push_back(SpatialPartitionQueryData(mPendingData[i]));
+    return;
+  }
+
+  if(mRoot != cInvalidIndex)
+    FilloutData(mRoot, mRootAabb, 0, results);
+}
+
+size_t QuantizedBvh::GetMemoryUsage() const
+{
+  return sizeof(*this) + mNodes.capacity() * sizeof(Node) + mClientData.capacity() * sizeof(void*) +
+         mPendingData.capacity() * sizeof(SpatialPartitionData) + mLastFrustumPlanes.capacity();
+}
+
+Vector3 QuantizedBvh::ComputeScale(const Aabb& box)
+{
+  Vector3 result;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    float min = box.mMin[axis];
+    float max = box.mMax[axis];
+    float scale = (max - min) / static_cast<float>(cQuantizedMax);
+
+    // The division (and the decode's multiply-add) can round down, so grow the step until the
+    // last quantized value reaches the max
+    while(min + scale * static_cast<float>(cQuantizedMax) < max)
+      scale = (scale > 0.0f) ? scale * 1.0001f : Math::PositiveMin();
+    result[axis] = scale;
+  }
+  return result;
+}
+
+void QuantizedBvh::EncodeChild(const Aabb& parent, const Vector3& scales, const Aabb& aabb, Node& node, int child)
+{
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    float min = parent.mMin[axis];
+    float scale = scales[axis];
+    float maxQuantized = static_cast<float>(cQuantizedMax);
+    float quantizedMin = 0.0f;
+    float quantizedMax = 0.0f;
+    if(scale > 0.0f)
+    {
+      quantizedMin = Math::Clamp(Math::Floor((aabb.mMin[axis] - min) / scale), 0.0f, maxQuantized);
+      quantizedMax = Math::Clamp(Math::Ceil((aabb.mMax[axis] - min) / scale), 0.0f, maxQuantized);
+    }
+
+    // Fix up any rounding in the divide by checking against exactly what DecodeChild computes
+    unsigned int qMin = static_cast<unsigned int>(quantizedMin);
+    unsigned int qMax = static_cast<unsigned int>(quantizedMax);
+    while(qMin > 0 && min + scale * static_cast<float>(qMin) > aabb.mMin[axis])
+      --qMin;
+    while(qMax < cQuantizedMax && min + scale * static_cast<float>(qMax) < aabb.mMax[axis])
+      ++qMax;
+
+    node.mMin[child][axis] = static_cast<unsigned short>(qMin);
+    node.mMax[child][axis] = static_cast<unsigned short>(qMax);
+  }
+}
+
+void QuantizedBvh::DecodeChild(const Aabb& parent, const Vector3& scales, const Node& node, int child, Aabb& result)
+{
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    float min = parent.mMin[axis];
+    float scale = scales[axis];
+    result.mMin[axis] = min + scale * static_cast<float>(node.mMin[child][axis]);
+    result.mMax[axis] = min + scale * static_cast<float>(node.mMax[child][axis]);
+  }
+}
+
+unsigned int QuantizedBvh::Compress(const DynamicAabbTree& tree, unsigned int treeIndex, const Aabb& box)
+{
+  unsigned int index = static_cast<unsigned int>(mNodes.size());
+  mNodes.push_back(Node());
+  Vector3 scale = ComputeScale(box);
+
+  const DynamicAabbTree::Node& treeNode = tree.mNodes[treeIndex];
+  unsigned int treeChildren[2] = {treeNode.mLeft, treeNode.mRight};
+  for(int i = 0; i < 2; ++i)
+  {
+    const DynamicAabbTree::Node& treeChild = tree.mNodes[treeChildren[i]];
+    EncodeChild(box, scale, treeChild.mAabb, mNodes[index], i);
+
+    unsigned int child;
+    if(treeChild.IsLeaf())
+      child = static_cast<unsigned int>(reinterpret_cast<size_t>(treeChild.mClientData)) | cLeafBit;
+    else
+    {
+      // The child's children are quantized against its decoded bounds, not its real ones,
+      // since that's all a query will know
+      Aabb childBox;
+      DecodeChild(box, scale, mNodes[index], i, childBox);
+      child = Compress(tree, treeChildren[i], childBox);
+    }
+    mNodes[index].mChildren[i] = child;
+  }
+  return index;
+}
+
+void QuantizedBvh::Rebuild()
+{
+  if(mPendingData.empty())
+    return;
+
+  std::vector<SpatialPartitionData> data;
+  data.swap(mPendingData);
+  Build(data.data(), data.size());
+}
+
+void QuantizedBvh::GatherLeaves(std::vector<SpatialPartitionData>& data) const
+{
+  data.resize(mClientData.size());
+  if(mRoot == cInvalidIndex)
+    return;
+
+  std::vector<std::pair<unsigned int, Aabb> > stack;
+  stack.push_back(std::make_pair(mRoot, mRootAabb));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    Aabb box = stack.back().second;
+    stack.pop_back();
+
+    if(IsLeaf(index))
+    {
+      SpatialPartitionData& leaf = data[index & ~cLeafBit];
+      leaf.mAabb = box;
+      leaf.mClientData = mClientData[index & ~cLeafBit];
+      continue;
+    }
+
+    const Node& node = mNodes[index];
+    Vector3 scale = ComputeScale(box);
+    for(int i = 0; i < 2; ++i)
+    {
+      Aabb childBox;
+      DecodeChild(box, scale, node, i, childBox);
+      stack.push_back(std::make_pair(node.mChildren[i], childBox));
+    }
+  }
+}
+
+void QuantizedBvh::SelfQuery(unsigned int index, const Aabb& box, QueryResults& results) const
+{
+  QueryStatistic(QueryStatistics& statistics = GetQueryStatistics(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(QueryDepthScope depthScope(statistics));
+  if(IsLeaf(index))
+    return;
+
+  const Node& node = mNodes[index];
+  Vector3 scale = ComputeScale(box);
+  Aabb left;
+  Aabb right;
+  DecodeChild(box, scale, node, 0, left);
+  DecodeChild(box, scale, node, 1, right);
+
+  SelfQuery(node.mChildren[0], left, results);
+  SelfQuery(node.mChildren[1], right, results);
+  SelfQuery(node.mChildren[0], left, node.mChildren[1], right, results);
+}
+
+void QuantizedBvh::SelfQuery(unsigned int indexA, const Aabb& boxA, unsigned int indexB, const Aabb& boxB, QueryResults& results) const
+{
+  QueryStatistic(QueryStatistics& statistics = GetQueryStatistics(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(QueryDepthScope depthScope(statistics));
+  QueryStatistic(statistics.Visit(IsLeaf(indexA) && IsLeaf(indexB)));
+  if(!AabbAabb(boxA.mMin, boxA.mMax, boxB.mMin, boxB.mMax))
+    return;
+
+  bool leafA = IsLeaf(indexA);
+  bool leafB = IsLeaf(indexB);
+  if(leafA && leafB)
+  {
+    results.AddResult(QueryResult(mClientData[indexA & ~cLeafBit], mClientData[indexB & ~cLeafBit]));
+    return;
+  }
+
+  // Split the larger node (by surface area) to keep the descent balanced
+  if(leafB || (!leafA && boxA.GetSurfaceArea() >= boxB.GetSurfaceArea()))
+  {
+    const Node& node = mNodes[indexA];
+    Vector3 scale = ComputeScale(boxA);
+    for(int i = 0; i < 2; ++i)
+    {
+      Aabb child;
+      DecodeChild(boxA, scale, node, i, child);
+      SelfQuery(node.mChildren[i], child, indexB, boxB, results);
+    }
+  }
+  else
+  {
+    const Node& node = mNodes[indexB];
+    Vector3 scale = ComputeScale(boxB);
+    for(int i = 0; i < 2; ++i)
+    {
+      Aabb child;
+      DecodeChild(boxB, scale, node, i, child);
+      SelfQuery(indexA, boxA, node.mChildren[i], child, results);
+    }
+  }
+}
+
+void QuantizedBvh::AddAllLeaves(unsigned int index, CastResults& results) const
+{
+  if(IsLeaf(index))
+  {
+    results.AddResult(CastResult(mClientData[index & ~cLeafBit], 0.0f));
+    return;
+  }
+
+  AddAllLeaves(mNodes[index].mChildren[0], results);
+  AddAllLeaves(mNodes[index].mChildren[1], results);
+}
+
+void QuantizedBvh::DebugDraw(unsigned int index, const Aabb& box, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const
+{
+  if(level == -1 || level == depth)
+    gDebugDrawer->DrawAabb(box).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+
+  if(IsLeaf(index) || (level != -1 && depth >= level))
+    return;
+
+  const Node& node = mNodes[index];
+  Vector3 scale = ComputeScale(box);
+  for(int i = 0; i < 2; ++i)
+  {
+    Aabb child;
+    DecodeChild(box, scale, node, i, child);
+    DebugDraw(node.mChildren[i], child, depth + 1, level, transform, color, bitMask);
+  }
+}
+
+void QuantizedBvh::FilloutData(unsigned int index, const Aabb& box, int depth, std::vector<SpatialPartitionQueryData>& results) const
+{
+  SpatialPartitionQueryData data;
+  data.mAabb = box;
+  data.mClientData = IsLeaf(index) ? mClientData[index & ~cLeafBit] : nullptr;
+  data.mDepth = depth;
+  results.push_back(data);
+
+  if(IsLeaf(index))
+    return;
+
+  const Node& node = mNodes[index];
+  Vector3 scale = ComputeScale(box);
+  for(int i = 0; i < 2; ++i)
+  {
+    Aabb child;
+    DecodeChild(box, scale, node, i, child);
+    FilloutData(node.mChildren[i], child, depth + 1, results);
+  }
+}
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Bvh with 16-bit quantized node bounds for static data (e.g. a model's midphase).
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+
+class DynamicAabbTree;
+
+//-----------------------------------------------------------------------------QuantizedBvh
+// A binary bvh built with DynamicAabbTree's SAH build and then compressed into 32-byte nodes. A node
+// stores both of its children's bounds as 16-bit offsets into its own bounds, so only the root's
+// bounds are kept as floats and every other box is decoded on the way down. Quantizing always
+// rounds outward (mins down, maxes up) against the decoded parent bounds, so a decoded box always
+// contains the real one and queries never miss anything, they can only visit a bit more.
+// A leaf is just a child index, so the whole tree costs about 40 bytes per object instead of the
+// 100+ of the float trees.
+// This is meant for data that doesn't change. Inserting or updating an object rebuilds the tree
+// (lazily, on the next query) from the decoded, slightly loose, bounds of everything else.
+class QuantizedBvh : public SpatialPartition
+{
+public:
+  QuantizedBvh();
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  // Not supported (the tree is for static data).
+  void RemoveData(SpatialPartitionKey& key) override;
+  // The key of object i is i.
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  void CastRay(const Ray& ray, CastResults& results) override;
+  // Nearer child first, skipping anything entered after the closest hit so far. Times are the
+  // decoded bounds' entry times unless refined.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Depth first, skipping nodes entered after maxT, until the first confirmed hit.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  // Children only test the planes their parent straddles and each node starts with the plane that
+  // last rejected it (see mLastFrustumPlanes).
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Best-first over the decoded node bounds. Distances are to the decoded (slightly larger) bounds.
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  // Tests the decoded bounds, so objects just outside the region can be returned too.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  void SelfQuery(QueryResults& results) override;
+
+  // Nodes are handed out with their decoded bounds (which is all it takes to decode their children).
+  bool GetHierarchyRoot(HierarchyNode& root) override;
+  void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const override;
+
+  // The decoded (conservative) bounds of the object.
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+
+  size_t GetMemoryUsage() const override;
+
+  // Child indices with this bit set are leaves (the rest is the object's key).
+  static const unsigned int cLeafBit = 0x80000000u;
+  static const unsigned int cInvalidIndex = 0xffffffffu;
+  static const unsigned short cQuantizedMax = 0xffff;
+
+  // The bounds of both children quantized against this node's decoded bounds: value q on an
+  // axis decodes to min + q * scale (see ComputeScale).
+  struct Node
+  {
+    unsigned short mMin[2][3];
+    unsigned short mMax[2][3];
+    unsigned int mChildren[2];
+  };
+
+  static bool IsLeaf(unsigned int index) { return (index & cLeafBit) != 0; }
+  // Computes the size of one quantization step per axis so that cQuantizedMax steps cover the
+  // whole box (rounding up). Only needed once a node is expanded, so traversals compute it once
+  // per expanded node and share it between both children.
+  static Vector3 ComputeScale(const Aabb& box);
+  static void EncodeChild(const Aabb& parent, const Vector3& scale, const Aabb& aabb, Node& node, int child);
+  static void DecodeChild(const Aabb& parent, const Vector3& scale, const Node& node, int child, Aabb& result);
+
+  // Adds a compressed copy of the float tree's subtree to mNodes and returns its index.
+  unsigned int Compress(const DynamicAabbTree& tree, unsigned int treeIndex, const Aabb& box);
+  // Rebuilds the tree if objects were inserted or updated since the last build.
+  void Rebuild();
+  // Decodes every leaf's bounds into data (indexed by key).
+  void GatherLeaves(std::vector<SpatialPartitionData>& data) const;
+
+  void SelfQuery(unsigned int index, const Aabb& box, QueryResults& results) const;
+  void SelfQuery(unsigned int indexA, const Aabb& boxA, unsigned int indexB, const Aabb& boxB, QueryResults& results) const;
+  void AddAllLeaves(unsigned int index, CastResults& results) const;
+  void DebugDraw(unsigned int index, const Aabb& box, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const;
+  void FilloutData(unsigned int index, const Aabb& box, int depth, std::vector<SpatialPartitionQueryData>& results) const;
+
+  std::vector<Node> mNodes;
+  // The client data of each object (by key)
+  std::vector<void*> mClientData;
+  unsigned int mRoot;
+  Aabb mRootAabb;
+
+  // Every object's data while a rebuild is pending (empty otherwise).
+  std::vector<SpatialPartitionData> mPendingData;
+  // Index of the frustum plane that last culled each node (nodes first, then leaves by key).
+  // Only a hint, so it survives rebuilds as is.
+  std::vector<unsigned char> mLastFrustumPlanes;
+};
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Packets of rays tested against an aabb together with SSE.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "RayPacket.hpp"
+
+//-----------------------------------------------------------------------------RayPacket
+void RayPacket::Load(const Ray* rays, size_t count)
+{
+  float start[3][cWidth];
+  float inverseDirection[3][cWidth];
+  mMask = 0;
+  for(int lane = 0; lane < cWidth; ++lane)
+  {
+    // Unused lanes repeat the last ray so they don't produce nans (they're masked off anyway)
+    const Ray& ray = rays[Math::Min(static_cast<size_t>(lane), count - 1)];
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      start[axis][lane] = ray.mStart[axis];
+      // Zero components become +/-inf so the slab is either everything or nothing
+      inverseDirection[axis][lane] = 1.0f / ray.mDirection[axis];
+    }
+
+    if(static_cast<size_t>(lane) < count)
+      mMask |= 1 << lane;
+  }
+
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    mStart[axis] = _mm_loadu_ps(start[axis]);
+    mInverseDirection[axis] = _mm_loadu_ps(inverseDirection[axis]);
+  }
+}
+
+int RayPacket::TestAabb(const Aabb& aabb, int activeMask) const
+{
+  ++Application::mStatistics.mRayPacketAabbTests;
+
+  // Rays start at t = 0
+  __m128 tMin = _mm_setzero_ps();
+  __m128 tMax = _mm_set1_ps(Math::PositiveMax());
+  __m128 negativeInfinity = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+  __m128 positiveInfinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.mMin[axis]), mStart[axis]), mInverseDirection[axis]);
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.mMax[axis]), mStart[axis]), mInverseDirection[axis]);
+
+    // A ray with a zero direction starting exactly on a slab plane gives 0 * inf = nan. Like
+    // RayAabb that counts as inside the slab so those lanes don't limit the interval at all.
+    __m128 nanMask = _mm_cmpunord_ps(t0, t1);
+    __m128 slabMin = _mm_or_ps(_mm_andnot_ps(nanMask, _mm_min_ps(t0, t1)), _mm_and_ps(nanMask, negativeInfinity));
+    __m128 slabMax = _mm_or_ps(_mm_andnot_ps(nanMask, _mm_max_ps(t0, t1)), _mm_and_ps(nanMask, positiveInfinity));
+    tMin = _mm_max_ps(tMin, slabMin);
+    tMax = _mm_min_ps(tMax, slabMax);
+  }
+
+  // Pad the exit time a bit so rounding differences with the scalar test never cull a hit
+  tMax = _mm_add_ps(tMax, _mm_mul_ps(tMax, _mm_set1_ps(1.0f / 65536.0f)));
+  int hitMask = _mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+  return hitMask & activeMask;
+}
@@ -0,0 +1,32 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Packets of rays tested against an aabb together with SSE.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "Shapes.hpp"
+#include <xmmintrin.h>
+
+//-----------------------------------------------------------------------------RayPacket
+// Up to cWidth rays stored as one SSE register per component so a node's aabb can be tested
+// against every ray in the packet with a single slab test. Trees traverse with a packet and a
+// bit mask of the rays still alive in each subtree, so each node is fetched once per packet.
+class RayPacket
+{
+public:
+  static const int cWidth = 4;
+
+  // Loads rays [0, count) where count is from 1 to cWidth. Lanes past count are left out of mMask.
+  void Load(const Ray* rays, size_t count);
+
+  // Returns which of the rays in activeMask hit the aabb. Rounding is in favor of a hit
+  // so this is only meant for culling nodes; leaves should still be confirmed with RayAabb.
+  int TestAabb(const Aabb& aabb, int activeMask) const;
+
+  __m128 mStart[3];
+  __m128 mInverseDirection[3];
+  // One bit per loaded ray.
+  int mMask;
+};
@@ -180,26 +180,35 @@ Aabb Aabb::BuildFromCenterAndHalfExtents(const Vector3& center, const Vector3& h
 
 float Aabb::GetVolume() const
 {
-  /******Student:Assignment2******/
-  // Return the aabb's volume
-  Warn("Assignment2: Required function un-implemented");
-  return 0;
+  Vector3 size = mMax - mMin;
+  return size.x * size.y * size.z;
 }
 
 float Aabb::GetSurfaceArea() const
 {
-  /******Student:Assignment2******/
-  // Return the aabb's surface area
-  Warn("Assignment2: Required function un-implemented");
-  return 0;
+  Vector3 size = mMax - mMin;
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
 }
 
 bool Aabb::Contains(const Aabb& aabb) const
 {
-  /******Student:Assignment2******/
-  // Return if aabb is completely contained in this
-  Warn("Assignment2: Required function un-implemented");
-  return false;
+  for(uint32_t i = 0; i < 3; ++i)
+  {
+    if(aabb.mMin[i] < mMin[i] || aabb.mMax[i] > mMax[i])
+      return false;
+  }
+  return true;
+}
+
+float Aabb::GetDistanceSquared(const Vector3& point) const
+{
+  float distanceSq = 0.0f;
+  for(uint32_t i = 0; i < 3; ++i)
+  {
+    float offset = Math::Max(Math::Max(mMin[i] - point[i], point[i] - mMax[i]), 0.0f);
+    distanceSq += offset * offset;
+  }
+  return distanceSq;
 }
 
 void Aabb::Expand(const Vector3& point)
@@ -232,10 +241,24 @@ bool Aabb::Compare(const Aabb& rhs, float epsilon) const
 
 void Aabb::Transform(const Vector3& scale, const Matrix3& rotation, const Vector3& translation)
 {
-  /******Student:Assignment2******/
-  // Compute aabb of the this aabb after it is transformed.
-  // You should use the optimize method discussed in class (not transforming all 8 points).
-  Warn("Assignment2: Required function un-implemented");
+  Math::Matrix4 transform;
+  transform.BuildTransform(translation, rotation, scale);
+  Transform(transform);
+}
+
+void Aabb::Transform(const Matrix4& transform)
+{
+  // The new half extents are the absolute (projected) lengths of the transformed half-size axes
+  Vector3 center = Math::TransformPoint(transform, GetCenter());
+  Vector3 halfSize = GetHalfSize();
+  Vector3 halfExtents = Vector3::cZero;
+  for(int i = 0; i < 3; ++i)
+  {
+    Vector3 axis = Vector3::cZero;
+    axis[i] = halfSize[i];
+    halfExtents += Math::Abs(Math::TransformNormal(transform, axis));
+  }
+  *this = BuildFromCenterAndHalfExtents(center, halfExtents);
 }
 
 Vector3 Aabb::GetMin() const
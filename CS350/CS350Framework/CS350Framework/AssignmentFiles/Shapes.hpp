@@ -101,6 +101,8 @@ public:
 
   // Does this aabb completely contain the given aabb (not an intersection test).
   bool Contains(const Aabb& aabb) const;
+  // Squared distance from the point to the closest point on this aabb (0 if the point is inside).
+  float GetDistanceSquared(const Vector3& point) const;
   // Expand the to include the given point.
   void Expand(const Vector3& point);
   // Combine the two aabbs into a new one
@@ -109,6 +111,8 @@ public:
   bool Compare(const Aabb& rhs, float epsilon) const;
 
   void Transform(const Vector3& scale, const Matrix3& rotation, const Vector3& translation);
+  // Transforms this aabb to another space by the given matrix 4 (looser than the original when there's a rotation).
+  void Transform(const Matrix4& transform);
   
   Vector3 GetMin() const;
   Vector3 GetMax() const;
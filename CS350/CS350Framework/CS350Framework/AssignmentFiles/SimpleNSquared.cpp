@@ -46,6 +46,8 @@ void NSquaredSpatialPartition::DebugDraw(int level, const Math::Matrix4& transfo
 
 void NSquaredSpatialPartition::CastRay(const Ray& ray, CastResults& results)
 {
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
   // Add everything
   for(size_t i = 0; i < mData.size(); ++i)
   {
@@ -53,10 +55,13 @@ void NSquaredSpatialPartition::CastRay(const Ray& ray, CastResults& results)
     result.mClientData = mData[i];
     results.AddResult(result);
   }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
 }
 
 void NSquaredSpatialPartition::CastFrustum(const Frustum& frustum, CastResults& results)
 {
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
   // Add everything
   for(size_t i = 0; i < mData.size(); ++i)
   {
@@ -64,10 +69,36 @@ void NSquaredSpatialPartition::CastFrustum(const Frustum& frustum, CastResults&
     result.mClientData = mData[i];
     results.AddResult(result);
   }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void NSquaredSpatialPartition::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  // There are no bounds to rank or cull by (so everything is at a distance of 0),
+  // but there can't be more than k results
+  size_t count = Math::Min(k, mData.size());
+  for(size_t i = 0; i < count; ++i)
+    results.AddResult(CastResult(mData[i], 0.0f));
+}
+
+void NSquaredSpatialPartition::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  // Add everything
+  for(size_t i = 0; i < mData.size(); ++i)
+    results.AddResult(CastResult(mData[i], 0.0f));
+}
+
+void NSquaredSpatialPartition::CastAabb(const Aabb& start, const Vector3& displacement, CastResults& results)
+{
+  // Add everything
+  for(size_t i = 0; i < mData.size(); ++i)
+    results.AddResult(CastResult(mData[i], 0.0f));
 }
 
 void NSquaredSpatialPartition::SelfQuery(QueryResults& results)
 {
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
   // Add everything
   for(size_t i = 0; i < mData.size(); ++i)
   {
@@ -76,6 +107,7 @@ void NSquaredSpatialPartition::SelfQuery(QueryResults& results)
       results.AddResult(QueryResult(mData[i], mData[j]));
     }
   }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
 }
 
 void NSquaredSpatialPartition::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
@@ -129,6 +161,11 @@ void BoundingSphereSpatialPartition::CastFrustum(const Frustum& frustum, CastRes
   Warn("Assignment2: Required function un-implemented");
 }
 
+void BoundingSphereSpatialPartition::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  Warn("Assignment2: Required function un-implemented");
+}
+
 void BoundingSphereSpatialPartition::SelfQuery(QueryResults& results)
 {
   Warn("Assignment2: Required function un-implemented");
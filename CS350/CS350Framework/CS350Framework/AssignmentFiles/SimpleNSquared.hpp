@@ -24,6 +24,10 @@ public:
 
   void CastRay(const Ray& ray, CastResults& results) override;
   void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // No bounds are stored so, like the casts, this returns every object (at distance 0).
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+  void CastAabb(const Aabb& start, const Vector3& displacement, CastResults& results) override;
 
   void SelfQuery(QueryResults& results) override;
 
@@ -49,6 +53,7 @@ public:
 
   void CastRay(const Ray& ray, CastResults& results) override;
   void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
 
   void SelfQuery(QueryResults& results) override;
 
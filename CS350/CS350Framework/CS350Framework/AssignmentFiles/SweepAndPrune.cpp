@@ -0,0 +1,480 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Sweep and prune spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "SweepAndPrune.hpp"
+
+//-----------------------------------------------------------------------------SweepAndPrune
+SweepAndPrune::SweepAndPrune()
+{
+  mType = SpatialPartitionTypes::SweepAndPrune;
+}
+
+void SweepAndPrune::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index;
+  if(mFreeProxies.empty())
+  {
+    index = static_cast<unsigned int>(mProxies.size());
+    mProxies.push_back(Proxy());
+  }
+  else
+  {
+    index = mFreeProxies.back();
+    mFreeProxies.pop_back();
+  }
+
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  proxy.mActive = true;
+
+  // Start the new endpoints past the end of every list and sort them down into place
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    std::vector<Endpoint>& endpoints = mEndpoints[axis];
+    Endpoint endpoint;
+    endpoint.mValue = Math::PositiveMax();
+
+    endpoint.mData = index << 1;
+    proxy.mMinEndpoint[axis] = static_cast<unsigned int>(endpoints.size());
+    endpoints.push_back(endpoint);
+
+    endpoint.mData = (index << 1) | 1;
+    proxy.mMaxEndpoint[axis] = static_cast<unsigned int>(endpoints.size());
+    endpoints.push_back(endpoint);
+  }
+
+  for(int axis = 0; axis < 3; ++axis)
+    UpdateAxis(index, axis);
+
+  key.mUIntKey = index;
+}
+
+void SweepAndPrune::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index = key.mUIntKey;
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+
+  for(int axis = 0; axis < 3; ++axis)
+    UpdateAxis(index, axis);
+}
+
+void SweepAndPrune::RemoveData(SpatialPartitionKey& key)
+{
+  unsigned int index = key.mUIntKey;
+  Proxy& proxy = mProxies[index];
+
+  // Moving the endpoints to the end of every list removes all of the proxy's pairs
+  proxy.mAabb.mMin = proxy.mAabb.mMax = Vector3(Math::PositiveMax());
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    UpdateAxis(index, axis);
+
+    // Other endpoints can only be past these if they're also at the max value so this is nearly free
+    std::vector<Endpoint>& endpoints = mEndpoints[axis];
+    unsigned int minEndpoint = proxy.mMinEndpoint[axis];
+    endpoints.erase(endpoints.begin() + proxy.mMaxEndpoint[axis]);
+    endpoints.erase(endpoints.begin() + minEndpoint);
+    for(size_t i = minEndpoint; i < endpoints.size(); ++i)
+      SetEndpointIndex(axis, static_cast<unsigned int>(i));
+  }
+
+  proxy.mClientData = nullptr;
+  proxy.mActive = false;
+  mFreeProxies.push_back(index);
+}
+
+void SweepAndPrune::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  mProxies.resize(count);
+  mFreeProxies.clear();
+  for(int axis = 0; axis < 3; ++axis)
+    mEndpoints[axis].resize(2 * count);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    Proxy& proxy = mProxies[i];
+    proxy.mAabb = data[i].mAabb;
+    proxy.mClientData = data[i].mClientData;
+    proxy.mActive = true;
+
+    unsigned int index = static_cast<unsigned int>(i);
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      Endpoint* endpoints = &mEndpoints[axis][2 * i];
+      endpoints[0].mValue = proxy.mAabb.mMin[axis];
+      endpoints[0].mData = index << 1;
+      endpoints[1].mValue = proxy.mAabb.mMax[axis];
+      endpoints[1].mData = (index << 1) | 1;
+    }
+
+    if(keys != nullptr)
+      keys[i].mUIntKey = index;
+  }
+
+  SortAndSweep();
+}
+
+void SweepAndPrune::InsertBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count)
+{
+  // Sorting each new proxy into place takes O(n) swaps while re-sorting everything is O(n log n),
+  // so only small batches are inserted one at a time
+  size_t activeCount = mProxies.size() - mFreeProxies.size();
+  size_t logCount = 0;
+  while((static_cast<size_t>(1) << logCount) < activeCount)
+    ++logCount;
+  if(count <= logCount)
+  {
+    SpatialPartition::InsertBatch(keys, data, count);
+    return;
+  }
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    unsigned int index;
+    if(mFreeProxies.empty())
+    {
+      index = static_cast<unsigned int>(mProxies.size());
+      mProxies.push_back(Proxy());
+    }
+    else
+    {
+      index = mFreeProxies.back();
+      mFreeProxies.pop_back();
+    }
+
+    Proxy& proxy = mProxies[index];
+    proxy.mAabb = data[i].mAabb;
+    proxy.mClientData = data[i].mClientData;
+    proxy.mActive = true;
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      Endpoint endpoint;
+      endpoint.mValue = proxy.mAabb.mMin[axis];
+      endpoint.mData = index << 1;
+      mEndpoints[axis].push_back(endpoint);
+
+      endpoint.mValue = proxy.mAabb.mMax[axis];
+      endpoint.mData = (index << 1) | 1;
+      mEndpoints[axis].push_back(endpoint);
+    }
+
+    keys[i].mUIntKey = index;
+  }
+
+  SortAndSweep();
+}
+
+void SweepAndPrune::RemoveBatch(SpatialPartitionKey* keys, size_t count)
+{
+  if(count == 0)
+    return;
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    Proxy& proxy = mProxies[keys[i].mUIntKey];
+    proxy.mClientData = nullptr;
+    proxy.mActive = false;
+    mFreeProxies.push_back(keys[i].mUIntKey);
+  }
+
+  // Compact every list in a single pass instead of erasing two endpoints at a time per proxy
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    std::vector<Endpoint>& endpoints = mEndpoints[axis];
+    size_t size = 0;
+    for(size_t i = 0; i < endpoints.size(); ++i)
+    {
+      if(mProxies[endpoints[i].GetProxy()].mActive)
+        endpoints[size++] = endpoints[i];
+    }
+    endpoints.resize(size);
+    for(size_t i = 0; i < endpoints.size(); ++i)
+      SetEndpointIndex(axis, static_cast<unsigned int>(i));
+  }
+
+  for(PairSet::iterator it = mPairs.begin(); it != mPairs.end();)
+  {
+    unsigned int proxyA = static_cast<unsigned int>(*it >> 32);
+    unsigned int proxyB = static_cast<unsigned int>(*it & 0xffffffffu);
+    if(!mProxies[proxyA].mActive || !mProxies[proxyB].mActive)
+      it = mPairs.erase(it);
+    else
+      ++it;
+  }
+}
+
+void SweepAndPrune::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  // There's no hierarchy so every object is at level 0
+  if(level != -1 && level != 0)
+    return;
+
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    if(mProxies[i].mActive)
+      gDebugDrawer->DrawAabb(mProxies[i].mAabb).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+  }
+}
+
+void SweepAndPrune::CastRay(const Ray& ray, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    QueryStatistic(statistics.Visit(true));
+    float t;
+    if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+      results.AddResult(CastResult(proxy.mClientData, t));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool SweepAndPrune::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  AnyHitQuery query(ray, maxT, refiner);
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    float t;
+    if(proxy.mActive && RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t) && query.IsHit(proxy.mClientData, t))
+      return true;
+  }
+  return false;
+}
+
+void SweepAndPrune::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  const Vector4* planes = frustum.GetPlanes();
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    QueryStatistic(statistics.Visit(true));
+    size_t lastAxis = 0;
+    if(FrustumAabb(planes, proxy.mAabb.mMin, proxy.mAabb.mMax, lastAxis) != IntersectionType::Outside)
+      results.AddResult(CastResult(proxy.mClientData, 0.0f));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void SweepAndPrune::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  // An object overlapping the region on x has its min endpoint before the region's max and its max
+  // endpoint after the region's min. Walk whichever of those two runs of endpoints is shorter.
+  const std::vector<Endpoint>& endpoints = mEndpoints[0];
+  Endpoint regionMin;
+  regionMin.mValue = region.mAabb.mMin.x;
+  regionMin.mData = 0;
+  Endpoint regionMax;
+  regionMax.mValue = region.mAabb.mMax.x;
+  regionMax.mData = 1;
+  size_t first = std::lower_bound(endpoints.begin(), endpoints.end(), regionMin, Less) - endpoints.begin();
+  size_t last = std::upper_bound(endpoints.begin(), endpoints.end(), regionMax, Less) - endpoints.begin();
+
+  bool walkMins = last < endpoints.size() - first;
+  size_t begin = walkMins ? 0 : first;
+  size_t end = walkMins ? last : endpoints.size();
+  for(size_t i = begin; i < end; ++i)
+  {
+    if(endpoints[i].IsMax() == walkMins)
+      continue;
+
+    const Proxy& proxy = mProxies[endpoints[i].GetProxy()];
+    if(region.Overlaps(proxy.mAabb))
+      results.AddResult(CastResult(proxy.mClientData, 0.0f));
+  }
+}
+
+void SweepAndPrune::SelfQuery(QueryResults& results)
+{
+  // The pairs are kept up to date as objects move so there's nothing left to test here
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  std::unordered_set<unsigned long long>::const_iterator it;
+  for(it = mPairs.begin(); it != mPairs.end(); ++it)
+  {
+    unsigned int proxyA = static_cast<unsigned int>(*it >> 32);
+    unsigned int proxyB = static_cast<unsigned int>(*it & 0xffffffffu);
+    results.AddResult(QueryResult(mProxies[proxyA].mClientData, mProxies[proxyB].mClientData));
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void SweepAndPrune::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Proxy& proxy = mProxies[key.mUIntKey];
+  data.mClientData = proxy.mClientData;
+  data.mAabb = proxy.mAabb;
+}
+
+void SweepAndPrune::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    const Proxy& proxy = mProxies[i];
+    if(!proxy.mActive)
+      continue;
+
+    SpatialPartitionQueryData data;
+    data.mAabb = proxy.mAabb;
+    data.mClientData = proxy.mClientData;
+    data.mDepth = 0;
+    results.push_back(data);
+  }
+}
+
+bool SweepAndPrune::Less(const Endpoint& lhs, const Endpoint& rhs)
+{
+  if(lhs.mValue != rhs.mValue)
+    return lhs.mValue < rhs.mValue;
+  return !lhs.IsMax() && rhs.IsMax();
+}
+
+unsigned long long SweepAndPrune::GetPairKey(unsigned int proxyA, unsigned int proxyB)
+{
+  if(proxyA > proxyB)
+    std::swap(proxyA, proxyB);
+  return (static_cast<unsigned long long>(proxyA) << 32) | proxyB;
+}
+
+void SweepAndPrune::UpdateAxis(unsigned int index, int axis)
+{
+  Proxy& proxy = mProxies[index];
+  std::vector<Endpoint>& endpoints = mEndpoints[axis];
+  Endpoint& minEndpoint = endpoints[proxy.mMinEndpoint[axis]];
+  Endpoint& maxEndpoint = endpoints[proxy.mMaxEndpoint[axis]];
+
+  float oldMin = minEndpoint.mValue;
+  float oldMax = maxEndpoint.mValue;
+  float newMin = proxy.mAabb.mMin[axis];
+  float newMax = proxy.mAabb.mMax[axis];
+  minEndpoint.mValue = newMin;
+  maxEndpoint.mValue = newMax;
+
+  // Grow the interval before shrinking it. That way a pair is only removed when
+  // the final intervals are separated and only added when the final aabbs overlap.
+  if(newMin < oldMin)
+    SortDown(axis, proxy.mMinEndpoint[axis]);
+  if(newMax > oldMax)
+    SortUp(axis, proxy.mMaxEndpoint[axis]);
+  if(newMin > oldMin)
+    SortUp(axis, proxy.mMinEndpoint[axis]);
+  if(newMax < oldMax)
+    SortDown(axis, proxy.mMaxEndpoint[axis]);
+}
+
+void SweepAndPrune::SortDown(int axis, unsigned int index)
+{
+  std::vector<Endpoint>& endpoints = mEndpoints[axis];
+  Endpoint endpoint = endpoints[index];
+  while(index > 0 && Less(endpoint, endpoints[index - 1]))
+  {
+    // A min moving below another max starts an overlap on this axis and a max moving below another min ends one
+    const Endpoint& previous = endpoints[index - 1];
+    if(!endpoint.IsMax() && previous.IsMax())
+      AddPairIfOverlapping(endpoint.GetProxy(), previous.GetProxy());
+    else if(endpoint.IsMax() && !previous.IsMax())
+      RemovePair(endpoint.GetProxy(), previous.GetProxy());
+
+    endpoints[index] = previous;
+    SetEndpointIndex(axis, index);
+    --index;
+  }
+
+  endpoints[index] = endpoint;
+  SetEndpointIndex(axis, index);
+}
+
+void SweepAndPrune::SortUp(int axis, unsigned int index)
+{
+  std::vector<Endpoint>& endpoints = mEndpoints[axis];
+  Endpoint endpoint = endpoints[index];
+  while(index + 1 < endpoints.size() && Less(endpoints[index + 1], endpoint))
+  {
+    // A max moving above another min starts an overlap on this axis and a min moving above another max ends one
+    const Endpoint& next = endpoints[index + 1];
+    if(endpoint.IsMax() && !next.IsMax())
+      AddPairIfOverlapping(endpoint.GetProxy(), next.GetProxy());
+    else if(!endpoint.IsMax() && next.IsMax())
+      RemovePair(endpoint.GetProxy(), next.GetProxy());
+
+    endpoints[index] = next;
+    SetEndpointIndex(axis, index);
+    ++index;
+  }
+
+  endpoints[index] = endpoint;
+  SetEndpointIndex(axis, index);
+}
+
+void SweepAndPrune::SetEndpointIndex(int axis, unsigned int index)
+{
+  const Endpoint& endpoint = mEndpoints[axis][index];
+  Proxy& proxy = mProxies[endpoint.GetProxy()];
+  if(endpoint.IsMax())
+    proxy.mMaxEndpoint[axis] = index;
+  else
+    proxy.mMinEndpoint[axis] = index;
+}
+
+void SweepAndPrune::SortAndSweep()
+{
+  mPairs.clear();
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    std::sort(mEndpoints[axis].begin(), mEndpoints[axis].end(), Less);
+    for(size_t i = 0; i < mEndpoints[axis].size(); ++i)
+      SetEndpointIndex(axis, static_cast<unsigned int>(i));
+  }
+
+  // Sweep along x keeping a list of proxies whose x interval is open and test
+  // each proxy that opens against all of them
+  std::vector<unsigned int> open;
+  const std::vector<Endpoint>& endpoints = mEndpoints[0];
+  for(size_t i = 0; i < endpoints.size(); ++i)
+  {
+    unsigned int proxy = endpoints[i].GetProxy();
+    if(endpoints[i].IsMax())
+    {
+      std::vector<unsigned int>::iterator it = std::find(open.begin(), open.end(), proxy);
+      *it = open.back();
+      open.pop_back();
+      continue;
+    }
+
+    for(size_t j = 0; j < open.size(); ++j)
+      AddPairIfOverlapping(proxy, open[j]);
+    open.push_back(proxy);
+  }
+}
+
+void SweepAndPrune::AddPairIfOverlapping(unsigned int proxyA, unsigned int proxyB)
+{
+  // Overlapping on one axis isn't enough, the other two have to overlap as well
+  const Aabb& aabbA = mProxies[proxyA].mAabb;
+  const Aabb& aabbB = mProxies[proxyB].mAabb;
+  if(AabbAabb(aabbA.mMin, aabbA.mMax, aabbB.mMin, aabbB.mMax))
+    mPairs.insert(GetPairKey(proxyA, proxyB));
+}
+
+void SweepAndPrune::RemovePair(unsigned int proxyA, unsigned int proxyB)
+{
+  mPairs.erase(GetPairKey(proxyA, proxyB));
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Sweep and prune spatial partition.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+
+#include <unordered_set>
+
+//-----------------------------------------------------------------------------SweepAndPrune
+// Keeps the min/max of every aabb in a sorted endpoint list per axis. When an object moves its
+// endpoints are insertion-sorted into place and every swap between a min and a max endpoint
+// either starts or stops an overlap on that axis, which is used to keep a persistent set of
+// overlapping pairs. With good temporal coherence updates only do a handful of swaps and
+// SelfQuery just reads the pair set. Casts have no hierarchy to use so they test every object.
+class SweepAndPrune : public SpatialPartition
+{
+public:
+  SweepAndPrune();
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+  // Sorts all endpoints at once and finds the initial pairs with a single sweep.
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+  // Large inserts append every endpoint and then re-sort and re-sweep once. Removes compact the
+  // endpoint lists and the pair set in a single pass.
+  void InsertBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count) override;
+  void RemoveBatch(SpatialPartitionKey* keys, size_t count) override;
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  void CastRay(const Ray& ray, CastResults& results) override;
+  // Tests every object until the first confirmed hit.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Only tests the objects on the smaller side of the region's x range in the sorted x endpoints.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  void SelfQuery(QueryResults& results) override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+
+  // An object stored in the partition. The key is the proxy's index.
+  struct Proxy
+  {
+    Aabb mAabb;
+    void* mClientData;
+    // Where this proxy's endpoints currently are in each axis' endpoint list
+    unsigned int mMinEndpoint[3];
+    unsigned int mMaxEndpoint[3];
+    bool mActive;
+  };
+
+  // One side of a proxy's aabb on one axis. mData is the proxy index shifted up by one
+  // with the low bit set for max endpoints.
+  struct Endpoint
+  {
+    bool IsMax() const { return (mData & 1) != 0; }
+    unsigned int GetProxy() const { return mData >> 1; }
+
+    float mValue;
+    unsigned int mData;
+  };
+
+  // Endpoint order. Mins sort before maxes with the same value so touching aabbs overlap.
+  static bool Less(const Endpoint& lhs, const Endpoint& rhs);
+  static unsigned long long GetPairKey(unsigned int proxyA, unsigned int proxyB);
+
+  // Moves the proxy's endpoints on the given axis to match its (already updated) aabb.
+  void UpdateAxis(unsigned int proxy, int axis);
+  // Insertion sort an endpoint towards the start/end of the list, updating pairs on every min/max swap.
+  void SortDown(int axis, unsigned int index);
+  void SortUp(int axis, unsigned int index);
+  void SetEndpointIndex(int axis, unsigned int index);
+  // Sorts every endpoint list from scratch and rebuilds the pair set with a sweep along x.
+  void SortAndSweep();
+
+  void AddPairIfOverlapping(unsigned int proxyA, unsigned int proxyB);
+  void RemovePair(unsigned int proxyA, unsigned int proxyB);
+
+  std::vector<Proxy> mProxies;
+  std::vector<unsigned int> mFreeProxies;
+  std::vector<Endpoint> mEndpoints[3];
+  typedef std::unordered_set<unsigned long long> PairSet;
+  PairSet mPairs;
+};
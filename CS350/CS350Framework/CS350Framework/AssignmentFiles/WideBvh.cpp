@@ -0,0 +1,708 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// 4-wide bvh with structure-of-arrays nodes tested with SSE.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.hpp"
+#include "WideBvh.hpp"
+
+const unsigned int WideBvh::cRoot = 0;
+
+//-----------------------------------------------------------------------------WideBvh::Node
+Aabb WideBvh::Node::GetChildAabb(int child) const
+{
+  return Aabb(Vector3(mMin[0][child], mMin[1][child], mMin[2][child]),
+              Vector3(mMax[0][child], mMax[1][child], mMax[2][child]));
+}
+
+void WideBvh::Node::SetChildAabb(int child, const Aabb& aabb)
+{
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    mMin[axis][child] = aabb.mMin[axis];
+    mMax[axis][child] = aabb.mMax[axis];
+  }
+}
+
+void WideBvh::SimdRay::Set(const Ray& ray)
+{
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    mStart[axis] = _mm_set1_ps(ray.mStart[axis]);
+    // Zero components become +/-inf so the slab is either everything or nothing
+    mInverseDirection[axis] = _mm_set1_ps(1.0f / ray.mDirection[axis]);
+  }
+}
+
+//-----------------------------------------------------------------------------WideBvh
+WideBvh::WideBvh()
+{
+  mType = SpatialPartitionTypes::WideBvh;
+  mActiveCount = 0;
+  mDirty = false;
+}
+
+void WideBvh::InsertData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  unsigned int index;
+  if(mFreeProxies.empty())
+  {
+    index = static_cast<unsigned int>(mProxies.size());
+    mProxies.push_back(Proxy());
+  }
+  else
+  {
+    index = mFreeProxies.back();
+    mFreeProxies.pop_back();
+  }
+
+  Proxy& proxy = mProxies[index];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  proxy.mActive = true;
+
+  ++mActiveCount;
+  mDirty = true;
+  key.mUIntKey = index;
+}
+
+void WideBvh::UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data)
+{
+  Proxy& proxy = mProxies[key.mUIntKey];
+  proxy.mAabb = data.mAabb;
+  proxy.mClientData = data.mClientData;
+  mDirty = true;
+}
+
+void WideBvh::RemoveData(SpatialPartitionKey& key)
+{
+  Proxy& proxy = mProxies[key.mUIntKey];
+  proxy.mActive = false;
+  proxy.mClientData = nullptr;
+  mFreeProxies.push_back(key.mUIntKey);
+
+  --mActiveCount;
+  mDirty = true;
+}
+
+void WideBvh::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  mProxies.resize(count);
+  mFreeProxies.clear();
+  for(size_t i = 0; i < count; ++i)
+  {
+    mProxies[i].mAabb = data[i].mAabb;
+    mProxies[i].mClientData = data[i].mClientData;
+    mProxies[i].mActive = true;
+
+    if(keys != nullptr)
+      keys[i].mUIntKey = static_cast<unsigned int>(i);
+  }
+
+  mActiveCount = count;
+  mDirty = true;
+  Rebuild();
+}
+
+void WideBvh::DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color, int bitMask)
+{
+  Rebuild();
+  if(mNodes.empty())
+    return;
+
+  if(level == -1 || level == 0)
+    gDebugDrawer->DrawAabb(mRootAabb).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+  DebugDraw(cRoot, 0, level, transform, color, bitMask);
+}
+
+void WideBvh::CastRay(const Ray& ray, CastResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastRay));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mNodes.empty())
+    return;
+
+  SimdRay simdRay;
+  simdRay.Set(ray);
+
+  std::vector<unsigned int> stack;
+  stack.push_back(cRoot);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    // All of a node's children are tested at once, but each one's bounds count as a visit
+    int hitMask = TestRay(simdRay, node);
+    QueryStatistic(size_t stackDepth = stack.size() + 1);
+    for(int i = node.mCount - 1; i >= 0; --i)
+    {
+      QueryStatistic(statistics.Visit(IsLeaf(node.mChildren[i]), stackDepth));
+      if((hitMask & (1 << i)) == 0)
+        continue;
+
+      unsigned int child = node.mChildren[i];
+      if(!IsLeaf(child))
+      {
+        stack.push_back(child);
+        continue;
+      }
+
+      const Proxy& proxy = mProxies[child & ~cLeafBit];
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+        results.AddResult(CastResult(proxy.mClientData, t));
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool WideBvh::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  Rebuild();
+  if(mNodes.empty())
+    return false;
+
+  SimdRay simdRay;
+  simdRay.Set(ray);
+
+  // Each entry is a node the ray hits and the time it enters it
+  ClosestHitQuery query(ray, refiner);
+  std::vector<std::pair<unsigned int, float> > stack;
+  stack.push_back(std::make_pair(cRoot, 0.0f));
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back().first];
+    float tEnter = stack.back().second;
+    stack.pop_back();
+
+    // A closer hit may have been found since the node was pushed
+    if(tEnter >= query.GetMaxTime())
+      continue;
+
+    float entryTimes[cWidth];
+    int hitMask = TestRay(simdRay, node, entryTimes);
+
+    // Visit the children nearest first. Leaves are confirmed right away (which can prune the
+    // farther children) and nodes are pushed farthest first so the nearest one is popped next.
+    std::pair<float, int> hits[cWidth];
+    int hitCount = 0;
+    for(int i = 0; i < node.mCount; ++i)
+    {
+      if((hitMask & (1 << i)) != 0)
+        hits[hitCount++] = std::make_pair(entryTimes[i], i);
+    }
+    std::sort(hits, hits + hitCount);
+
+    size_t firstPushed = stack.size();
+    for(int i = 0; i < hitCount; ++i)
+    {
+      if(hits[i].first >= query.GetMaxTime())
+        break;
+
+      unsigned int child = node.mChildren[hits[i].second];
+      if(!IsLeaf(child))
+      {
+        stack.push_back(std::make_pair(child, hits[i].first));
+        continue;
+      }
+
+      const Proxy& proxy = mProxies[child & ~cLeafBit];
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t))
+        query.AddObject(proxy.mClientData, t);
+    }
+    std::reverse(stack.begin() + firstPushed, stack.end());
+  }
+  return query.GetResult(result);
+}
+
+bool WideBvh::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  Rebuild();
+  if(mNodes.empty())
+    return false;
+
+  SimdRay simdRay;
+  simdRay.Set(ray);
+
+  AnyHitQuery query(ray, maxT, refiner);
+  std::vector<unsigned int> stack;
+  stack.push_back(cRoot);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float entryTimes[cWidth];
+    int hitMask = TestRay(simdRay, node, entryTimes);
+    for(int i = node.mCount - 1; i >= 0; --i)
+    {
+      if((hitMask & (1 << i)) == 0 || entryTimes[i] > maxT)
+        continue;
+
+      unsigned int child = node.mChildren[i];
+      if(!IsLeaf(child))
+      {
+        stack.push_back(child);
+        continue;
+      }
+
+      const Proxy& proxy = mProxies[child & ~cLeafBit];
+      float t;
+      if(RayAabb(ray.mStart, ray.mDirection, proxy.mAabb.mMin, proxy.mAabb.mMax, t) && query.IsHit(proxy.mClientData, t))
+        return true;
+    }
+  }
+  return false;
+}
+
+void WideBvh::CastFrustum(const Frustum& frustum, CastResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::CastFrustum));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(mNodes.empty())
+    return;
+
+  const Vector4* planes = frustum.GetPlanes();
+  mLastFrustumPlanes.resize(mNodes.size() * cWidth, 0);
+
+  // Each entry is a node and the planes its children still have to be tested against
+  std::vector<std::pair<unsigned int, int> > stack;
+  stack.push_back(std::make_pair(cRoot, cAllFrustumPlanes));
+  while(!stack.empty())
+  {
+    unsigned int index = stack.back().first;
+    int planeMask = stack.back().second;
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    for(int i = 0; i < node.mCount; ++i)
+    {
+      QueryStatistic(statistics.Visit(IsLeaf(node.mChildren[i]), stack.size() + 1));
+      Aabb aabb = node.GetChildAabb(i);
+      size_t slot = index * cWidth + i;
+      size_t lastAxis = mLastFrustumPlanes[slot];
+      int childMask = planeMask;
+      IntersectionType::Type type = FrustumAabb(planes, aabb.mMin, aabb.mMax, lastAxis, childMask);
+      if(type == IntersectionType::Outside)
+      {
+        mLastFrustumPlanes[slot] = static_cast<unsigned char>(lastAxis);
+        continue;
+      }
+
+      // Everything below a fully contained node is also contained
+      unsigned int child = node.mChildren[i];
+      if(type == IntersectionType::Inside || IsLeaf(child))
+        AddAllLeaves(child, results);
+      else
+        stack.push_back(std::make_pair(child, childMask));
+    }
+  }
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+void WideBvh::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  Rebuild();
+  if(mNodes.empty())
+    return;
+
+  NearestQuery query(point, k, maxDistance);
+  NearestNodeQueue queue;
+  queue.Push(mRootAabb.GetDistanceSquared(point), cRoot);
+
+  unsigned int index;
+  while(queue.Pop(query, index))
+  {
+    const Node& node = mNodes[index];
+    float distancesSq[cWidth];
+    GetDistancesSquared(point, node, distancesSq);
+    for(int i = 0; i < node.mCount; ++i)
+    {
+      unsigned int child = node.mChildren[i];
+      if(IsLeaf(child))
+        query.AddObject(mProxies[child & ~cLeafBit].mClientData, distancesSq[i]);
+      else if(distancesSq[i] <= query.GetMaxDistanceSq())
+        queue.Push(distancesSq[i], child);
+    }
+  }
+  query.GetResults(results);
+}
+
+void WideBvh::QueryRegion(const RegionQuery& region, CastResults& results)
+{
+  Rebuild();
+  if(mNodes.empty())
+    return;
+
+  float radiusSq = region.mSphere.mRadius * region.mSphere.mRadius;
+  std::vector<unsigned int> stack;
+  stack.push_back(cRoot);
+  while(!stack.empty())
+  {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    int overlapMask = 0;
+    if(region.mIsSphere)
+    {
+      ++Application::mStatistics.mWideAabbTests;
+      float distancesSq[cWidth];
+      GetDistancesSquared(region.mSphere.mCenter, node, distancesSq);
+      for(int i = 0; i < node.mCount; ++i)
+      {
+        if(distancesSq[i] <= radiusSq)
+          overlapMask |= 1 << i;
+      }
+    }
+    else
+      overlapMask = TestAabb(region.mAabb, node);
+
+    for(int i = 0; i < node.mCount; ++i)
+    {
+      if((overlapMask & (1 << i)) == 0)
+        continue;
+
+      unsigned int child = node.mChildren[i];
+      if(IsLeaf(child) || region.Contains(node.GetChildAabb(i)))
+        AddAllLeaves(child, results);
+      else
+        stack.push_back(child);
+    }
+  }
+}
+
+void WideBvh::SelfQuery(QueryResults& results)
+{
+  Rebuild();
+  QueryStatistic(QueryStatistics& statistics = BeginQuery(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(size_t resultCount = results.mResults.size());
+  if(!mNodes.empty())
+    SelfQuery(cRoot, results);
+  QueryStatistic(statistics.mResults += results.mResults.size() - resultCount);
+}
+
+bool WideBvh::GetHierarchyRoot(HierarchyNode& root)
+{
+  Rebuild();
+  if(mNodes.empty())
+    return false;
+
+  root.mAabb = mRootAabb;
+  root.mIndex = cRoot;
+  root.mIsObject = false;
+  root.mClientData = nullptr;
+  return true;
+}
+
+void WideBvh::GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const
+{
+  const Node& wideNode = mNodes[node.mIndex];
+  for(int i = 0; i < wideNode.mCount; ++i)
+  {
+    unsigned int child = wideNode.mChildren[i];
+    HierarchyNode result;
+    result.mAabb = wideNode.GetChildAabb(i);
+    result.mIndex = child;
+    result.mIsObject = IsLeaf(child);
+    result.mClientData = IsLeaf(child) ? mProxies[child & ~cLeafBit].mClientData : nullptr;
+    children.push_back(result);
+  }
+}
+
+void WideBvh::GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const
+{
+  const Proxy& proxy = mProxies[key.mUIntKey];
+  data.mAabb = proxy.mAabb;
+  data.mClientData = proxy.mClientData;
+}
+
+void WideBvh::FilloutData(std::vector<SpatialPartitionQueryData>& results) const
+{
+  Rebuild();
+  if(mNodes.empty())
+    return;
+
+  SpatialPartitionQueryData root;
+  root.mAabb = mRootAabb;
+  root.mClientData = nullptr;
+  root.mDepth = 0;
+  results.push_back(root);
+  FilloutData(cRoot, 0, results);
+}
+
+size_t WideBvh::GetMemoryUsage() const
+{
+  return sizeof(*this) + mProxies.capacity() * sizeof(Proxy) + mFreeProxies.capacity() * sizeof(unsigned int) +
+         mNodes.capacity() * sizeof(Node) + mLastFrustumPlanes.capacity();
+}
+
+void WideBvh::Rebuild() const
+{
+  if(!mDirty)
+    return;
+  mDirty = false;
+
+  mNodes.clear();
+  if(mActiveCount == 0)
+    return;
+
+  // Build the binary tree over the proxy indices so its leaves say which proxy they are
+  std::vector<SpatialPartitionData> data;
+  data.reserve(mActiveCount);
+  for(size_t i = 0; i < mProxies.size(); ++i)
+  {
+    if(!mProxies[i].mActive)
+      continue;
+
+    SpatialPartitionData item;
+    item.mAabb = mProxies[i].mAabb;
+    item.mClientData = reinterpret_cast<void*>(i);
+    data.push_back(item);
+  }
+
+  DynamicAabbTree tree;
+  tree.Build(data.data(), data.size());
+  mRootAabb = tree.mNodes[tree.mRoot].mAabb;
+
+  // Every node but the last few has cWidth children
+  mNodes.reserve(data.size() / (cWidth - 1) + 1);
+  Collapse(tree, tree.mRoot);
+}
+
+int WideBvh::TestRay(const SimdRay& ray, const Node& node, float* entryTimes)
+{
+  ++Application::mStatistics.mWideAabbTests;
+
+  // Rays start at t = 0
+  __m128 tMin = _mm_setzero_ps();
+  __m128 tMax = _mm_set1_ps(Math::PositiveMax());
+  __m128 negativeInfinity = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+  __m128 positiveInfinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.mMin[axis]), ray.mStart[axis]), ray.mInverseDirection[axis]);
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.mMax[axis]), ray.mStart[axis]), ray.mInverseDirection[axis]);
+
+    // A ray with a zero direction starting exactly on a slab plane gives 0 * inf = nan. Like
+    // RayAabb that counts as inside the slab so those lanes don't limit the interval at all.
+    __m128 nanMask = _mm_cmpunord_ps(t0, t1);
+    __m128 slabMin = _mm_or_ps(_mm_andnot_ps(nanMask, _mm_min_ps(t0, t1)), _mm_and_ps(nanMask, negativeInfinity));
+    __m128 slabMax = _mm_or_ps(_mm_andnot_ps(nanMask, _mm_max_ps(t0, t1)), _mm_and_ps(nanMask, positiveInfinity));
+    tMin = _mm_max_ps(tMin, slabMin);
+    tMax = _mm_min_ps(tMax, slabMax);
+  }
+
+  // Pad the exit time a bit so rounding differences with the scalar test never cull a hit (and
+  // the entry time for the same reason when it's used to prune)
+  __m128 padding = _mm_set1_ps(1.0f / 65536.0f);
+  tMax = _mm_add_ps(tMax, _mm_mul_ps(tMax, padding));
+  if(entryTimes != nullptr)
+    _mm_storeu_ps(entryTimes, _mm_sub_ps(tMin, _mm_mul_ps(tMin, padding)));
+  int hitMask = _mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+  return hitMask & ((1 << node.mCount) - 1);
+}
+
+int WideBvh::TestAabb(const Aabb& aabb, const Node& node)
+{
+  ++Application::mStatistics.mWideAabbTests;
+
+  // Same comparisons as AabbAabb, for all children at once
+  __m128 overlap = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(node.mMin[axis]), _mm_set1_ps(aabb.mMax[axis])));
+    overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_set1_ps(aabb.mMin[axis]), _mm_loadu_ps(node.mMax[axis])));
+  }
+  return _mm_movemask_ps(overlap) & ((1 << node.mCount) - 1);
+}
+
+void WideBvh::GetDistancesSquared(const Vector3& point, const Node& node, float* distancesSq)
+{
+  // Same as Aabb::GetDistanceSquared, for all children at once
+  __m128 distanceSq = _mm_setzero_ps();
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    __m128 p = _mm_set1_ps(point[axis]);
+    __m128 offset = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.mMin[axis]), p), _mm_sub_ps(p, _mm_loadu_ps(node.mMax[axis])));
+    offset = _mm_max_ps(offset, _mm_setzero_ps());
+    distanceSq = _mm_add_ps(distanceSq, _mm_mul_ps(offset, offset));
+  }
+  _mm_storeu_ps(distancesSq, distanceSq);
+}
+
+unsigned int WideBvh::Collapse(const DynamicAabbTree& tree, unsigned int treeIndex) const
+{
+  // Start with the binary node's children and keep replacing the largest internal one with its
+  // own children. Opening the largest first keeps the most likely to be hit boxes near the top.
+  unsigned int children[cWidth];
+  int count = 0;
+  const DynamicAabbTree::Node& treeNode = tree.mNodes[treeIndex];
+  if(treeNode.IsLeaf())
+    children[count++] = treeIndex;
+  else
+  {
+    children[count++] = treeNode.mLeft;
+    children[count++] = treeNode.mRight;
+  }
+
+  while(count < cWidth)
+  {
+    int largest = -1;
+    float largestArea = -1.0f;
+    for(int i = 0; i < count; ++i)
+    {
+      const DynamicAabbTree::Node& child = tree.mNodes[children[i]];
+      float area = child.mAabb.GetSurfaceArea();
+      if(!child.IsLeaf() && area > largestArea)
+      {
+        largest = i;
+        largestArea = area;
+      }
+    }
+    if(largest == -1)
+      break;
+
+    const DynamicAabbTree::Node& opened = tree.mNodes[children[largest]];
+    children[largest] = opened.mLeft;
+    children[count++] = opened.mRight;
+  }
+
+  unsigned int index = static_cast<unsigned int>(mNodes.size());
+  mNodes.push_back(Node());
+  mNodes[index].mCount = count;
+  for(int i = 0; i < cWidth; ++i)
+  {
+    // Unused slots are never tested (they're outside the count mask)
+    if(i >= count)
+    {
+      mNodes[index].SetChildAabb(i, Aabb(Vector3::cZero, Vector3::cZero));
+      mNodes[index].mChildren[i] = cLeafBit;
+      continue;
+    }
+
+    const DynamicAabbTree::Node& child = tree.mNodes[children[i]];
+    mNodes[index].SetChildAabb(i, child.mAabb);
+
+    // Collapsing the child can grow mNodes so index it again afterwards
+    unsigned int childIndex;
+    if(child.IsLeaf())
+      childIndex = static_cast<unsigned int>(reinterpret_cast<size_t>(child.mClientData)) | cLeafBit;
+    else
+      childIndex = Collapse(tree, children[i]);
+    mNodes[index].mChildren[i] = childIndex;
+  }
+  return index;
+}
+
+void WideBvh::SelfQuery(unsigned int index, QueryResults& results) const
+{
+  QueryStatistic(QueryStatistics& statistics = GetQueryStatistics(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(QueryDepthScope depthScope(statistics));
+  const Node& node = mNodes[index];
+
+  // Pairs between this node's children, each child tested against all of its siblings at once
+  for(int i = 0; i < node.mCount; ++i)
+  {
+    Aabb aabb = node.GetChildAabb(i);
+    int overlapMask = TestAabb(aabb, node) & ~((2 << i) - 1);
+    for(int j = i + 1; j < node.mCount; ++j)
+    {
+      QueryStatistic(statistics.Visit(IsLeaf(node.mChildren[i]) && IsLeaf(node.mChildren[j])));
+      if(overlapMask & (1 << j))
+        SelfQuery(node.mChildren[i], aabb, node.mChildren[j], node.GetChildAabb(j), results);
+    }
+  }
+
+  for(int i = 0; i < node.mCount; ++i)
+  {
+    if(!IsLeaf(node.mChildren[i]))
+      SelfQuery(node.mChildren[i], results);
+  }
+}
+
+void WideBvh::SelfQuery(unsigned int indexA, const Aabb& aabbA, unsigned int indexB, const Aabb& aabbB, QueryResults& results) const
+{
+  QueryStatistic(QueryStatistics& statistics = GetQueryStatistics(QueryStatisticsTypes::SelfQuery));
+  QueryStatistic(QueryDepthScope depthScope(statistics));
+  bool leafA = IsLeaf(indexA);
+  bool leafB = IsLeaf(indexB);
+  // The pair's bounds were already tested (and counted) by the caller
+  if(leafA && leafB)
+  {
+    results.AddResult(QueryResult(mProxies[indexA & ~cLeafBit].mClientData, mProxies[indexB & ~cLeafBit].mClientData));
+    return;
+  }
+
+  // Split the larger node (by surface area) and test the other one against all of its children at once
+  if(leafB || (!leafA && aabbA.GetSurfaceArea() >= aabbB.GetSurfaceArea()))
+  {
+    const Node& node = mNodes[indexA];
+    int overlapMask = TestAabb(aabbB, node);
+    for(int i = 0; i < node.mCount; ++i)
+    {
+      QueryStatistic(statistics.Visit(IsLeaf(node.mChildren[i]) && leafB));
+      if(overlapMask & (1 << i))
+        SelfQuery(node.mChildren[i], node.GetChildAabb(i), indexB, aabbB, results);
+    }
+  }
+  else
+  {
+    const Node& node = mNodes[indexB];
+    int overlapMask = TestAabb(aabbA, node);
+    for(int i = 0; i < node.mCount; ++i)
+    {
+      QueryStatistic(statistics.Visit(leafA && IsLeaf(node.mChildren[i])));
+      if(overlapMask & (1 << i))
+        SelfQuery(indexA, aabbA, node.mChildren[i], node.GetChildAabb(i), results);
+    }
+  }
+}
+
+void WideBvh::AddAllLeaves(unsigned int index, CastResults& results) const
+{
+  if(IsLeaf(index))
+  {
+    results.AddResult(CastResult(mProxies[index & ~cLeafBit].mClientData, 0.0f));
+    return;
+  }
+
+  const Node& node = mNodes[index];
+  for(int i = 0; i < node.mCount; ++i)
+    AddAllLeaves(node.mChildren[i], results);
+}
+
+void WideBvh::DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const
+{
+  // A node's children are one level below it
+  const Node& node = mNodes[index];
+  for(int i = 0; i < node.mCount; ++i)
+  {
+    if(level == -1 || level == depth + 1)
+      gDebugDrawer->DrawAabb(node.GetChildAabb(i)).Color(color).SetMaskBit(bitMask).SetTransform(transform);
+
+    if(!IsLeaf(node.mChildren[i]) && (level == -1 || depth + 1 < level))
+      DebugDraw(node.mChildren[i], depth + 1, level, transform, color, bitMask);
+  }
+}
+
+void WideBvh::FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const
+{
+  const Node& node = mNodes[index];
+  for(int i = 0; i < node.mCount; ++i)
+  {
+    unsigned int child = node.mChildren[i];
+    SpatialPartitionQueryData data;
+    data.mAabb = node.GetChildAabb(i);
+    data.mClientData = IsLeaf(child) ? mProxies[child & ~cLeafBit].mClientData : nullptr;
+    data.mDepth = depth + 1;
+    results.push_back(data);
+
+    if(!IsLeaf(child))
+      FilloutData(child, depth + 1, results);
+  }
+}
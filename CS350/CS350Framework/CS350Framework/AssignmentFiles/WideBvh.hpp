@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// 4-wide bvh with structure-of-arrays nodes tested with SSE.
+/// Copyright 2026, DigiPen Institute of Technology
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "SpatialPartition.hpp"
+#include "Shapes.hpp"
+#include <xmmintrin.h>
+
+class DynamicAabbTree;
+
+//-----------------------------------------------------------------------------WideBvh
+// A bvh whose nodes have up to cWidth children with their bounds stored as one array per component
+// (all min x's, then all min y's...). A ray or an aabb is tested against every child of a node with
+// one SSE slab/overlap test, and the tree is about half as deep as a binary one. The tree is built
+// by collapsing DynamicAabbTree's binned SAH build: each node keeps opening its largest internal
+// child until it has cWidth children.
+// Like LinearBvh the hierarchy is a cache that's rebuilt on the next query after any change, so it
+// works for both a broadphase and a (static) midphase.
+class WideBvh : public SpatialPartition
+{
+public:
+  WideBvh();
+
+  // Spatial Partition Interface
+  void InsertData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void UpdateData(SpatialPartitionKey& key, SpatialPartitionData& data) override;
+  void RemoveData(SpatialPartitionKey& key) override;
+  void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr) override;
+
+  void DebugDraw(int level, const Math::Matrix4& transform, const Vector4& color = Vector4(1), int bitMask = 0) override;
+
+  // Nodes are culled with the padded SSE test and leaves are confirmed with RayAabb, so the
+  // results (and times) are the same as the binary trees'.
+  void CastRay(const Ray& ray, CastResults& results) override;
+  // Each node's hit children are visited nearest first (by their SIMD entry times) and skipped once
+  // the closest hit so far is before them.
+  bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr) override;
+  // Depth first, skipping nodes entered after maxT, until the first confirmed hit.
+  bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr) override;
+  // Children only test the planes their parent straddles and each child starts with the plane that
+  // last rejected it (see mLastFrustumPlanes).
+  void CastFrustum(const Frustum& frustum, CastResults& results) override;
+  // Best-first with the distances to all of a node's children computed at once.
+  void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results) override;
+  // Each node's children are tested for overlap at once. Fully contained nodes add their whole subtree.
+  void QueryRegion(const RegionQuery& region, CastResults& results) override;
+
+  void SelfQuery(QueryResults& results) override;
+
+  bool GetHierarchyRoot(HierarchyNode& root) override;
+  void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const override;
+
+  void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const override;
+  void FilloutData(std::vector<SpatialPartitionQueryData>& results) const override;
+
+  size_t GetMemoryUsage() const override;
+
+  // Rebuild the hierarchy if anything changed since the last build.
+  void Rebuild() const;
+
+  // Children per node (one SSE register of floats).
+  static const int cWidth = 4;
+  // Child indices with this bit set are proxies instead of nodes.
+  static const unsigned int cLeafBit = 0x80000000u;
+  // The root is always node 0.
+  static const unsigned int cRoot;
+
+  // An object stored in the partition. The key is the proxy's index.
+  struct Proxy
+  {
+    Aabb mAabb;
+    void* mClientData;
+    bool mActive;
+  };
+
+  // Children [0, mCount) are used. mMin[axis][i] is the min of child i on that axis.
+  struct Node
+  {
+    float mMin[3][cWidth];
+    float mMax[3][cWidth];
+    unsigned int mChildren[cWidth];
+    int mCount;
+
+    Aabb GetChildAabb(int child) const;
+    void SetChildAabb(int child, const Aabb& aabb);
+  };
+
+  // A ray splatted across all lanes, ready to be tested against a node.
+  struct SimdRay
+  {
+    __m128 mStart[3];
+    __m128 mInverseDirection[3];
+
+    void Set(const Ray& ray);
+  };
+
+  static bool IsLeaf(unsigned int index) { return (index & cLeafBit) != 0; }
+  // Returns a bit per child of the node whose bounds the ray (conservatively) hits. If entryTimes
+  // isn't null it gets each child's (slightly early) entry time.
+  static int TestRay(const SimdRay& ray, const Node& node, float* entryTimes = nullptr);
+  // Returns a bit per child of the node whose bounds overlap the aabb.
+  static int TestAabb(const Aabb& aabb, const Node& node);
+  // Squared distance from the point to each child's bounds (0 if inside), written to distancesSq.
+  static void GetDistancesSquared(const Vector3& point, const Node& node, float* distancesSq);
+
+  // Adds the wide node for the binary tree's node (and everything below it). Returns its index.
+  unsigned int Collapse(const DynamicAabbTree& tree, unsigned int treeIndex) const;
+
+  void SelfQuery(unsigned int index, QueryResults& results) const;
+  // Every object under child (a leaf or node) that overlaps the aabb of the other child.
+  void SelfQuery(unsigned int indexA, const Aabb& aabbA, unsigned int indexB, const Aabb& aabbB, QueryResults& results) const;
+  void AddAllLeaves(unsigned int index, CastResults& results) const;
+  void DebugDraw(unsigned int index, int depth, int level, const Math::Matrix4& transform, const Vector4& color, int bitMask) const;
+  void FilloutData(unsigned int index, int depth, std::vector<SpatialPartitionQueryData>& results) const;
+
+  std::vector<Proxy> mProxies;
+  std::vector<unsigned int> mFreeProxies;
+  size_t mActiveCount;
+
+  // The built hierarchy is a cache of mProxies so it is rebuilt from const queries.
+  mutable std::vector<Node> mNodes;
+  mutable Aabb mRootAabb;
+  mutable bool mDirty;
+  // Index of the frustum plane that last culled each child (node index * cWidth + child).
+  // Only a hint, so it survives rebuilds as is.
+  std::vector<unsigned char> mLastFrustumPlanes;
+};
@@ -12,14 +12,36 @@
 #include "Geometry.hpp"
 #include "DebugDraw.hpp"
 #include "BspTree.hpp"
+#include "DynamicAabbTree.hpp"
 #include "SimplePropertyBinding.hpp"
 
+//-----------------------------------------------------------------------------TriangleRefiner
+// Confirms a midphase hit against the triangle itself (the midphase's client data is the triangle index).
+class TriangleRefiner : public RayRefiner
+{
+public:
+  explicit TriangleRefiner(Mesh* mesh) : mMesh(mesh) {};
+
+  bool Refine(const Ray& ray, void* clientData, float& t) override
+  {
+    Triangle tri = mMesh->TriangleAt((size_t)clientData);
+    return RayTriangle(ray.mStart, ray.mDirection, tri.mPoints[0], tri.mPoints[1], tri.mPoints[2], t, 0);
+  }
+
+  Mesh* mMesh;
+};
+
 //-----------------------------------------------------------------------------Model
 Model::Model()
 {
   mOverlap = 0;
   mMidPhase = NULL;
+  mStatic = false;
   mMidphaseDrawLevel = 0;
+  mMidPhaseBuildTime = 0;
+  mMidPhaseSahCost = 0;
+  mMidPhaseBytesPerTriangle = 0;
+  mAabbTreeBytesPerTriangle = 0;
 }
 
 void Model::TransformUpdate(TransformUpdateFlags::Enum flags)
@@ -42,7 +64,12 @@ void Model::DisplayProperties(TwBar* bar)
   std::string name = mOwner->mName;
   std::string groupName = "group=" + name + ".Model";
 
+  TwAddVarRO(bar, (name + ".Static").c_str(), TW_TYPE_BOOLCPP, &mStatic, (groupName + " label=Static").c_str());
   TwAddVarRW(bar, (name + ".MidphaseDrawLevel").c_str(), TW_TYPE_INT32, &mMidphaseDrawLevel, (groupName + " label=MidphaseDrawLevel").c_str());
+  TwAddVarRO(bar, (name + ".MidphaseBuildTime").c_str(), TW_TYPE_FLOAT, &mMidPhaseBuildTime, (groupName + " label=MidphaseBuildTime(ms)").c_str());
+  TwAddVarRO(bar, (name + ".MidphaseSahCost").c_str(), TW_TYPE_FLOAT, &mMidPhaseSahCost, (groupName + " label=MidphaseSahCost").c_str());
+  TwAddVarRO(bar, (name + ".MidphaseBytesPerTriangle").c_str(), TW_TYPE_FLOAT, &mMidPhaseBytesPerTriangle, (groupName + " label=MidphaseBytesPerTriangle").c_str());
+  TwAddVarRO(bar, (name + ".AabbTreeBytesPerTriangle").c_str(), TW_TYPE_FLOAT, &mAabbTreeBytesPerTriangle, (groupName + " label=AabbTreeBytesPerTriangle").c_str());
   BindSimpleProperty(bar, name, Model, MeshType, mOwner->mApplication->mMeshTypesEnum, int);
 
   DeclareObjectComponentGroup(bar, name, Model);
@@ -120,23 +147,13 @@ void Model::CheckTriangle(const Ray& ray, const Triangle& tri, float& minT)
 
 bool Model::CastRayMidphase(const Ray& localRay, CastResult& castInfo)
 {
-  CastResults results;
-  mMidPhase->CastRay(localRay, results);
-
-  float minT = Math::PositiveMax();
-  for(size_t i = 0; i < results.mResults.size(); ++i)
-  {
-    CastResult& result = results.mResults[i];
-    size_t triangleIndex = (size_t)result.mClientData;
-
-    Triangle tri = mMesh->TriangleAt(triangleIndex);
-    CheckTriangle(localRay, tri, minT);
-  }
-
-  if(minT >= Math::PositiveMax())
+  // Triangles are tested as the midphase reaches them so it can stop at the closest one
+  TriangleRefiner refiner(mMesh);
+  CastResult result;
+  if(!mMidPhase->CastRayClosest(localRay, result, &refiner))
     return false;
 
-  castInfo.mTime = minT;
+  castInfo.mTime = result.mTime;
   return true;
 }
 
@@ -148,7 +165,7 @@ bool Model::CastRay(const Ray& worldRay, CastResult& castInfo)
   Ray localRay = worldRay.Transform(toLocalMat);
 
   if(mMidPhase != NULL)
-    return CastRayMidphase(worldRay, castInfo);
+    return CastRayMidphase(localRay, castInfo);
 
   float minT = Math::PositiveMax();
   for(size_t i = 0; i < mMesh->TriangleCount(); ++i)
@@ -164,14 +181,14 @@ bool Model::CastRay(const Ray& worldRay, CastResult& castInfo)
   return true;
 }
 
-void Model::SetMidPhase(SpatialPartition* midPhase)
+void Model::SetMidPhase(SpatialPartition* midPhase, bool bulkBuild)
 {
   if(mMidPhase != NULL)
     delete mMidPhase;
 
   mMidPhase = midPhase;
 
-  SpatialPartitionKey dummyKey;
+  std::vector<SpatialPartitionData> triangleData(mMesh->TriangleCount());
   for(size_t i = 0; i < mMesh->TriangleCount(); ++i)
   {
     Triangle tri = mMesh->TriangleAt(i);
@@ -180,14 +197,79 @@ void Model::SetMidPhase(SpatialPartition* midPhase)
     aabb.Expand(tri.mPoints[1]);
     aabb.Expand(tri.mPoints[2]);
 
-    SpatialPartitionData data;
+    SpatialPartitionData& data = triangleData[i];
     //fix this later!
     //data.mBoundingSphere = Sphere(aabb;
     data.mAabb = aabb;
     data.mClientData = (void*)i;
+  }
+
+  // Time the construction so the bulk build can be compared against incremental insertion
+  clock_t startTime = clock();
+  if(bulkBuild)
+    mMidPhase->Build(triangleData.data(), triangleData.size());
+  else
+  {
+    SpatialPartitionKey dummyKey;
+    for(size_t i = 0; i < triangleData.size(); ++i)
+      mMidPhase->InsertData(dummyKey, triangleData[i]);
+  }
+  mMidPhaseBuildTime = 1000.0f * (clock() - startTime) / (float)CLOCKS_PER_SEC;
 
-    mMidPhase->InsertData(dummyKey, data);
+  mMidPhaseSahCost = 0;
+  if(mMidPhase->mType == SpatialPartitionTypes::AabbTree)
+    mMidPhaseSahCost = static_cast<DynamicAabbTree*>(mMidPhase)->GetSahCost();
+
+  mMidPhaseBytesPerTriangle = 0;
+  mAabbTreeBytesPerTriangle = 0;
+  if(triangleData.empty())
+    return;
+
+  mMidPhaseBytesPerTriangle = mMidPhase->GetMemoryUsage() / static_cast<float>(triangleData.size());
+  if(mMidPhase->mType == SpatialPartitionTypes::AabbTree)
+    mAabbTreeBytesPerTriangle = mMidPhaseBytesPerTriangle;
+  else
+  {
+    // Build the default tree over the same triangles so the memory can be compared side by side
+    DynamicAabbTree aabbTree;
+    aabbTree.Build(triangleData.data(), triangleData.size());
+    mAabbTreeBytesPerTriangle = aabbTree.GetMemoryUsage() / static_cast<float>(triangleData.size());
+  }
+}
+
+bool Model::SaveMidPhase(const std::string& path)
+{
+  if(mMidPhase == NULL)
+    return false;
+
+  FlatBvh flatBvh;
+  return flatBvh.Flatten(*mMidPhase) && flatBvh.Save(path);
+}
+
+bool Model::LoadMidPhase(const std::string& path)
+{
+  clock_t startTime = clock();
+  FlatBvh* flatBvh = new FlatBvh();
+  bool valid = flatBvh->Load(path);
+  for(unsigned int i = 0; valid && i < flatBvh->mHeader->mPayloadCount; ++i)
+    valid = flatBvh->mPayload[i] < mMesh->TriangleCount();
+  if(!valid)
+  {
+    delete flatBvh;
+    return false;
   }
+
+  if(mMidPhase != NULL)
+    delete mMidPhase;
+  mMidPhase = flatBvh;
+
+  // Loading replaces building so it's reported as the build time
+  mMidPhaseBuildTime = 1000.0f * (clock() - startTime) / (float)CLOCKS_PER_SEC;
+  mMidPhaseSahCost = 0;
+  mMidPhaseBytesPerTriangle = 0;
+  if(mMesh->TriangleCount() != 0)
+    mMidPhaseBytesPerTriangle = mMidPhase->GetMemoryUsage() / static_cast<float>(mMesh->TriangleCount());
+  return true;
 }
 
 int Model::GetMeshType()
@@ -48,7 +48,15 @@ public:
   bool CastRay(const Ray& worldRay, CastResult& castInfo);
 
 
-  void SetMidPhase(SpatialPartition* midPhase);
+  // Takes ownership of the given midphase and fills it with the mesh's triangles. With bulkBuild the
+  // midphase is built in one pass (SpatialPartition::Build), otherwise each triangle is inserted one at a time.
+  void SetMidPhase(SpatialPartition* midPhase, bool bulkBuild = true);
+  // Saves the midphase's hierarchy as a FlatBvh file (see FlatBvh::Save). Fails if there's no midphase
+  // or it has no hierarchy.
+  bool SaveMidPhase(const std::string& path);
+  // Replaces the midphase with a FlatBvh mapped from the file. Fails (keeping the current midphase) if
+  // the file is invalid or refers to triangles this mesh doesn't have.
+  bool LoadMidPhase(const std::string& path);
 
   int GetMeshType();
   void SetMeshType(const int& meshIndex);
@@ -68,9 +76,21 @@ public:
   Sphere mLocalSphere;
   Sphere mBoundingSphere;
   SpatialPartitionKey mSpatialPartitionKey;
+  // Static models (level geometry) live in the application's static broadphase and are never
+  // tested against each other. Read when the model's insert is flushed, so set it right after
+  // creating the object (changing it afterward isn't supported).
+  bool mStatic;
 
   int mOverlap;
   int mMidphaseDrawLevel;
 
   SpatialPartition* mMidPhase;
+  // How long the last SetMidPhase took (milliseconds) and the resulting tree's SAH cost (0 if not a tree).
+  float mMidPhaseBuildTime;
+  float mMidPhaseSahCost;
+  // Memory used by the midphase per triangle of the mesh (0 if the midphase doesn't report its memory).
+  float mMidPhaseBytesPerTriangle;
+  // The same for a DynamicAabbTree over the mesh, shown next to it to see what the compressed
+  // midphases (e.g. QuantizedBvh) save.
+  float mAabbTreeBytesPerTriangle;
 };
@@ -25,14 +25,26 @@
 #include "Components.hpp"
 #include "DebugDraw.hpp"
 #include "DynamicAabbTree.hpp"
+#include "FlatBvh.hpp"
 #include "Geometry.hpp"
 #include "Gizmo.hpp"
 #include "Gjk.hpp"
+#include "HashGrid.hpp"
+#include "HierarchicalHashGrid.hpp"
+#include "LinearBvh.hpp"
+#include "LooseOctree.hpp"
 #include "Main/Support.hpp"
 #include "Mesh.hpp"
 #include "Model.hpp"
+#include "PairCache.hpp"
+#include "ParallelSelfQuery.hpp"
+#include "PartitionQuery.hpp"
+#include "QuantizedBvh.hpp"
+#include "RayPacket.hpp"
 #include "Shapes.hpp"
 #include "SimpleNSquared.hpp"
 #include "SimplePropertyBinding.hpp"
 #include "SpatialPartition.hpp"
+#include "SweepAndPrune.hpp"
 #include "UnitTests.hpp"
+#include "WideBvh.hpp"
@@ -127,3 +127,382 @@ void QueryResults::AddResult(const QueryResult& result)
 {
   mResults.push_back(result);
 }
+
+//-----------------------------------------------------------------------------NearestQuery
+NearestQuery::NearestQuery(const Vector3& point, size_t k, float maxDistance)
+{
+  mPoint = point;
+  mK = k;
+  mMaxDistanceSq = maxDistance * maxDistance;
+  mClosest.reserve(k);
+}
+
+void NearestQuery::AddObject(void* clientData, const Aabb& aabb)
+{
+  AddObject(clientData, aabb.GetDistanceSquared(mPoint));
+}
+
+void NearestQuery::AddObject(void* clientData, float distanceSq)
+{
+  if(mK == 0 || distanceSq > GetMaxDistanceSq())
+    return;
+
+  // Once there are k objects the new one replaces the farthest
+  if(mClosest.size() == mK)
+  {
+    std::pop_heap(mClosest.begin(), mClosest.end());
+    mClosest.pop_back();
+  }
+  mClosest.push_back(std::make_pair(distanceSq, clientData));
+  std::push_heap(mClosest.begin(), mClosest.end());
+}
+
+float NearestQuery::GetMaxDistanceSq() const
+{
+  if(mK != 0 && mClosest.size() == mK)
+    return Math::Min(mClosest.front().first, mMaxDistanceSq);
+  return mMaxDistanceSq;
+}
+
+void NearestQuery::GetResults(CastResults& results) const
+{
+  std::vector<std::pair<float, void*> > closest = mClosest;
+  std::sort(closest.begin(), closest.end());
+  for(size_t i = 0; i < closest.size(); ++i)
+    results.AddResult(CastResult(closest[i].second, Math::Sqrt(closest[i].first)));
+}
+
+//-----------------------------------------------------------------------------NearestNodeQueue
+static bool CloserNode(const std::pair<float, unsigned int>& lhs, const std::pair<float, unsigned int>& rhs)
+{
+  // Reversed so the heap keeps the closest node on top
+  return lhs.first > rhs.first;
+}
+
+void NearestNodeQueue::Push(float distanceSq, unsigned int node)
+{
+  mNodes.push_back(std::make_pair(distanceSq, node));
+  std::push_heap(mNodes.begin(), mNodes.end(), CloserNode);
+}
+
+bool NearestNodeQueue::Pop(const NearestQuery& query, unsigned int& node)
+{
+  if(mNodes.empty() || mNodes.front().first > query.GetMaxDistanceSq())
+    return false;
+
+  node = mNodes.front().second;
+  std::pop_heap(mNodes.begin(), mNodes.end(), CloserNode);
+  mNodes.pop_back();
+  return true;
+}
+
+//-----------------------------------------------------------------------------ClosestHitQuery
+ClosestHitQuery::ClosestHitQuery(const Ray& ray, RayRefiner* refiner)
+  : mRay(ray)
+{
+  mRefiner = refiner;
+  mHit = false;
+}
+
+void ClosestHitQuery::AddObject(void* clientData, float t)
+{
+  if(t >= GetMaxTime())
+    return;
+
+  if(mRefiner != nullptr && !mRefiner->Refine(mRay, clientData, t))
+    return;
+
+  if(t >= GetMaxTime())
+    return;
+
+  mClosest = CastResult(clientData, t);
+  mHit = true;
+}
+
+float ClosestHitQuery::GetMaxTime() const
+{
+  if(mHit)
+    return mClosest.mTime;
+  return Math::PositiveMax();
+}
+
+bool ClosestHitQuery::GetResult(CastResult& result) const
+{
+  if(mHit)
+    result = mClosest;
+  return mHit;
+}
+
+//-----------------------------------------------------------------------------AnyHitQuery
+AnyHitQuery::AnyHitQuery(const Ray& ray, float maxT, RayRefiner* refiner)
+  : mRay(ray)
+{
+  mMaxT = maxT;
+  mRefiner = refiner;
+}
+
+bool AnyHitQuery::IsHit(void* clientData, float t) const
+{
+  if(t > mMaxT)
+    return false;
+
+  if(mRefiner != nullptr && !mRefiner->Refine(mRay, clientData, t))
+    return false;
+  return t <= mMaxT;
+}
+
+//-----------------------------------------------------------------------------QueryStatistics
+QueryStatistics::QueryStatistics()
+{
+  Clear();
+}
+
+void QueryStatistics::Clear()
+{
+  mQueries = 0;
+  mNodesVisited = 0;
+  mLeavesVisited = 0;
+  mMaxStackDepth = 0;
+  mResults = 0;
+  mDepth = 0;
+}
+
+void QueryStatistics::Visit(bool isLeaf, size_t stackDepth)
+{
+  if(isLeaf)
+    ++mLeavesVisited;
+  else
+    ++mNodesVisited;
+  mMaxStackDepth = Math::Max(mMaxStackDepth, stackDepth);
+}
+
+void QueryStatistics::Add(const QueryStatistics& rhs)
+{
+  mQueries += rhs.mQueries;
+  mNodesVisited += rhs.mNodesVisited;
+  mLeavesVisited += rhs.mLeavesVisited;
+  mMaxStackDepth = Math::Max(mMaxStackDepth, rhs.mMaxStackDepth);
+  mResults += rhs.mResults;
+}
+
+//-----------------------------------------------------------------------------QueryDepthScope
+QueryDepthScope::QueryDepthScope(QueryStatistics& statistics)
+  : mStatistics(statistics)
+{
+  ++mStatistics.mDepth;
+  mStatistics.mMaxStackDepth = Math::Max(mStatistics.mMaxStackDepth, mStatistics.mDepth);
+}
+
+QueryDepthScope::~QueryDepthScope()
+{
+  --mStatistics.mDepth;
+}
+
+//-----------------------------------------------------------------------------PartitionStatistics
+void PartitionStatistics::Clear()
+{
+  for(int i = 0; i < QueryStatisticsTypes::Count; ++i)
+    mQueries[i].Clear();
+}
+
+//-----------------------------------------------------------------------------SweptAabbQuery
+SweptAabbQuery::SweptAabbQuery(const Aabb& start, const Vector3& displacement)
+{
+  mRay.mStart = start.GetCenter();
+  mRay.mDirection = displacement;
+  mHalfExtents = start.GetHalfSize();
+}
+
+bool SweptAabbQuery::Cast(const Aabb& aabb, float& t) const
+{
+  Vector3 min = aabb.mMin - mHalfExtents;
+  Vector3 max = aabb.mMax + mHalfExtents;
+  if(!RayAabb(mRay.mStart, mRay.mDirection, min, max, t) || t > 1.0f)
+    return false;
+
+  // Starting on the grown bounds can give a (tiny) negative time
+  t = Math::Max(t, 0.0f);
+  return true;
+}
+
+//-----------------------------------------------------------------------------RegionQuery
+RegionQuery::RegionQuery(const Aabb& aabb)
+{
+  mIsSphere = false;
+  mAabb = aabb;
+}
+
+RegionQuery::RegionQuery(const Sphere& sphere)
+{
+  mIsSphere = true;
+  mSphere = sphere;
+  Vector3 halfExtents;
+  halfExtents.Splat(sphere.mRadius);
+  mAabb = Aabb::BuildFromCenterAndHalfExtents(sphere.mCenter, halfExtents);
+}
+
+bool RegionQuery::Overlaps(const Aabb& aabb) const
+{
+  if(mIsSphere)
+    return SphereAabb(mSphere.mCenter, mSphere.mRadius, aabb.mMin, aabb.mMax);
+  return AabbAabb(mAabb.mMin, mAabb.mMax, aabb.mMin, aabb.mMax);
+}
+
+bool RegionQuery::Contains(const Aabb& aabb) const
+{
+  if(!mIsSphere)
+    return mAabb.Contains(aabb);
+
+  // The aabb is inside the sphere when its farthest corner is
+  float distanceSq = 0.0f;
+  for(int i = 0; i < 3; ++i)
+  {
+    float offset = Math::Max(Math::Abs(mSphere.mCenter[i] - aabb.mMin[i]), Math::Abs(aabb.mMax[i] - mSphere.mCenter[i]));
+    distanceSq += offset * offset;
+  }
+  return distanceSq <= mSphere.mRadius * mSphere.mRadius;
+}
+
+IntersectionType::Type RegionQuery::Classify(const Aabb& aabb) const
+{
+  if(!Overlaps(aabb))
+    return IntersectionType::Outside;
+  if(Contains(aabb))
+    return IntersectionType::Inside;
+  return IntersectionType::Overlaps;
+}
+
+//-----------------------------------------------------------------------------SpatialPartition
+void SpatialPartition::Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys)
+{
+  SpatialPartitionKey dummyKey;
+  for(size_t i = 0; i < count; ++i)
+  {
+    SpatialPartitionData itemData = data[i];
+    SpatialPartitionKey& key = (keys != nullptr) ? keys[i] : dummyKey;
+    InsertData(key, itemData);
+  }
+}
+
+#if SPATIAL_PARTITION_STATISTICS
+QueryStatistics& SpatialPartition::GetQueryStatistics(QueryStatisticsTypes::Types queryType) const
+{
+  return Application::mStatistics.mPartitionStatistics[mType].mQueries[queryType];
+}
+
+QueryStatistics& SpatialPartition::BeginQuery(QueryStatisticsTypes::Types queryType) const
+{
+  QueryStatistics& statistics = GetQueryStatistics(queryType);
+  ++statistics.mQueries;
+  return statistics;
+}
+#endif
+
+void SpatialPartition::CastRays(const Ray* rays, size_t count, CastResults* results)
+{
+  for(size_t i = 0; i < count; ++i)
+    CastRay(rays[i], results[i]);
+}
+
+bool SpatialPartition::CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner)
+{
+  CastResults results;
+  CastRay(ray, results);
+
+  ClosestHitQuery query(ray, refiner);
+  for(size_t i = 0; i < results.mResults.size() && results.mResults[i].mTime < query.GetMaxTime(); ++i)
+    query.AddObject(results.mResults[i].mClientData, results.mResults[i].mTime);
+  return query.GetResult(result);
+}
+
+bool SpatialPartition::CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner)
+{
+  CastResults results;
+  CastRay(ray, results);
+
+  AnyHitQuery query(ray, maxT, refiner);
+  for(size_t i = 0; i < results.mResults.size() && results.mResults[i].mTime <= maxT; ++i)
+  {
+    if(query.IsHit(results.mResults[i].mClientData, results.mResults[i].mTime))
+      return true;
+  }
+  return false;
+}
+
+void SpatialPartition::CastAabb(const Aabb& start, const Vector3& displacement, CastResults& results)
+{
+  SweptAabbQuery query(start, displacement);
+  float t;
+
+  HierarchyNode root;
+  if(!GetHierarchyRoot(root))
+  {
+    // Trees also fill out their internal nodes, which have no client data
+    std::vector<SpatialPartitionQueryData> data;
+    FilloutData(data);
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+      if(data[i].mClientData != nullptr && query.Cast(data[i].mAabb, t))
+        results.AddResult(CastResult(data[i].mClientData, t));
+    }
+    return;
+  }
+
+  // Children are appended straight onto the stack
+  std::vector<HierarchyNode> stack(1, root);
+  while(!stack.empty())
+  {
+    HierarchyNode node = stack.back();
+    stack.pop_back();
+    if(!query.Cast(node.mAabb, t))
+      continue;
+
+    if(node.mIsObject)
+      results.AddResult(CastResult(node.mClientData, t));
+    else
+      GetHierarchyChildren(node, stack);
+  }
+}
+
+void SpatialPartition::QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results)
+{
+  // Trees also fill out their internal nodes, which have no client data
+  std::vector<SpatialPartitionQueryData> data;
+  FilloutData(data);
+
+  NearestQuery query(point, k, maxDistance);
+  for(size_t i = 0; i < data.size(); ++i)
+  {
+    if(data[i].mClientData != nullptr)
+      query.AddObject(data[i].mClientData, data[i].mAabb);
+  }
+  query.GetResults(results);
+}
+
+void SpatialPartition::QueryAabb(const Aabb& aabb, CastResults& results)
+{
+  QueryRegion(RegionQuery(aabb), results);
+}
+
+void SpatialPartition::QuerySphere(const Sphere& sphere, CastResults& results)
+{
+  QueryRegion(RegionQuery(sphere), results);
+}
+
+void SpatialPartition::InsertBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+    InsertData(keys[i], data[i]);
+}
+
+void SpatialPartition::UpdateBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+    UpdateData(keys[i], data[i]);
+}
+
+void SpatialPartition::RemoveBatch(SpatialPartitionKey* keys, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+    RemoveData(keys[i]);
+}
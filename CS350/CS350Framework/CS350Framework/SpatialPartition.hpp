@@ -7,8 +7,26 @@
 #pragma once
 
 #include "Shapes.hpp"
+#include "Geometry.hpp"
 #include <vector>
 
+// Per-query traversal counters (see QueryStatistics). Like ErrorIf they're only compiled into debug
+// builds unless SPATIAL_PARTITION_STATISTICS is defined otherwise.
+#if !defined(SPATIAL_PARTITION_STATISTICS)
+#   if defined(_DEBUG)
+#       define SPATIAL_PARTITION_STATISTICS 1
+#   else
+#       define SPATIAL_PARTITION_STATISTICS 0
+#   endif
+#endif
+
+// Wraps a statement that only updates query statistics so it disappears when they're compiled out.
+#if SPATIAL_PARTITION_STATISTICS
+#define QueryStatistic(...) __VA_ARGS__
+#else
+#define QueryStatistic(...) ((void)0)
+#endif
+
 //-----------------------------------------------------------------------------SpatialPartitionKey
 // This class is used for uniquely identifying (and quick finding) of any object
 // in a spatial partition. When an object is inserted into the spatial partition
@@ -120,9 +138,199 @@ public:
   Results mResults;
 };
 
+//-----------------------------------------------------------------------------HierarchyNode
+// A node of a partition's hierarchy as seen from outside of it (see QueryPartitions). Objects are the
+// leaves. mIndex is whatever the partition needs to find the node's children again.
+class HierarchyNode
+{
+public:
+  Aabb mAabb;
+  unsigned int mIndex;
+  bool mIsObject;
+  void* mClientData;
+};
+
+//-----------------------------------------------------------------------------NearestQuery
+// Collects the k closest objects to a point for QueryNearest. Objects can be added in any order.
+class NearestQuery
+{
+public:
+  NearestQuery(const Vector3& point, size_t k, float maxDistance);
+
+  // Considers an object at the distance of the closest point on its aabb.
+  void AddObject(void* clientData, const Aabb& aabb);
+  void AddObject(void* clientData, float distanceSq);
+  // Anything (object or subtree) farther than this (squared) can't make it into the results.
+  float GetMaxDistanceSq() const;
+  // Adds the objects found, closest first, with their distance as the time.
+  void GetResults(CastResults& results) const;
+
+  Vector3 mPoint;
+  size_t mK;
+  float mMaxDistanceSq;
+  // Max heap (by squared distance) of the closest objects found so far.
+  std::vector<std::pair<float, void*> > mClosest;
+};
+
+//-----------------------------------------------------------------------------NearestNodeQueue
+// The nodes waiting to be visited by a best-first QueryNearest, closest first.
+class NearestNodeQueue
+{
+public:
+  void Push(float distanceSq, unsigned int node);
+  // Gets the closest node. Returns false once the queue is empty or the closest node is too far
+  // away to hold anything the query would keep (so nothing left in the queue can either).
+  bool Pop(const NearestQuery& query, unsigned int& node);
+
+  // Min heap of (squared distance, node).
+  std::vector<std::pair<float, unsigned int> > mNodes;
+};
+
+//-----------------------------------------------------------------------------RayRefiner
+// Lets CastRayClosest/CastRayAny confirm a hit on an object's bounds against the object itself (e.g. a
+// model's triangles). Returns false if the ray misses the object, otherwise sets t to the exact hit time.
+// The exact time can never be before the bounds' entry time.
+class RayRefiner
+{
+public:
+  virtual ~RayRefiner() {};
+  virtual bool Refine(const Ray& ray, void* clientData, float& t) = 0;
+};
+
+//-----------------------------------------------------------------------------ClosestHitQuery
+// The closest hit a CastRayClosest has found so far. Objects are refined as soon as they're found,
+// so every node or object the ray enters at or after GetMaxTime() can be skipped.
+class ClosestHitQuery
+{
+public:
+  ClosestHitQuery(const Ray& ray, RayRefiner* refiner);
+
+  // Considers an object whose bounds the ray enters at time t.
+  void AddObject(void* clientData, float t);
+  // Nothing entered at or after this time can be closer than the current hit.
+  float GetMaxTime() const;
+  // Fills out the closest hit. Returns false if nothing was hit.
+  bool GetResult(CastResult& result) const;
+
+  const Ray& mRay;
+  RayRefiner* mRefiner;
+  CastResult mClosest;
+  bool mHit;
+};
+
+//-----------------------------------------------------------------------------AnyHitQuery
+// The ray and max time of a CastRayAny. Objects are confirmed one at a time until one is hit.
+class AnyHitQuery
+{
+public:
+  AnyHitQuery(const Ray& ray, float maxT, RayRefiner* refiner);
+
+  // Is the object whose bounds the ray enters at time t hit within the max time (after refining)?
+  bool IsHit(void* clientData, float t) const;
+
+  const Ray& mRay;
+  float mMaxT;
+  RayRefiner* mRefiner;
+};
+
+//-----------------------------------------------------------------------------SweptAabbQuery
+// The moving box of a CastAabb. Bounds are grown by the box's half extents (their Minkowski sum with
+// the box) so the box touches them exactly when the ray from its center along the displacement hits
+// the grown bounds. Times are the fraction of the displacement (0 to 1).
+class SweptAabbQuery
+{
+public:
+  SweptAabbQuery(const Aabb& start, const Vector3& displacement);
+
+  // Does the box touch the aabb before the end of the sweep? t is when it first does (0 if it already does).
+  bool Cast(const Aabb& aabb, float& t) const;
+
+  // From the box's center along the displacement.
+  Ray mRay;
+  Vector3 mHalfExtents;
+};
+
+//-----------------------------------------------------------------------------RegionQuery
+// The aabb or sphere of a QueryAabb/QuerySphere. Trees use Classify on their nodes so a node that's
+// fully inside the region adds its whole subtree without testing anything below it.
+class RegionQuery
+{
+public:
+  explicit RegionQuery(const Aabb& aabb);
+  explicit RegionQuery(const Sphere& sphere);
+
+  // Does the aabb touch the region (AabbAabb or SphereAabb)?
+  bool Overlaps(const Aabb& aabb) const;
+  // Is the aabb completely inside the region?
+  bool Contains(const Aabb& aabb) const;
+  // Outside, Inside (Contains) or Overlaps.
+  IntersectionType::Type Classify(const Aabb& aabb) const;
+
+  bool mIsSphere;
+  Sphere mSphere;
+  // The region itself, or the sphere's bounds.
+  Aabb mAabb;
+};
+
+namespace QueryStatisticsTypes
+{
+  enum Types{CastRay, CastFrustum, SelfQuery, Count};
+  static const char* const Names[Count] = {"CastRay", "CastFrustum", "SelfQuery"};
+}//namespace QueryStatisticsTypes
+
+//-----------------------------------------------------------------------------QueryStatistics
+// How much traversing one kind of query did, summed over every query of that kind. Nodes are counted
+// each time their bounds are tested (each child of a simd test counts) and leaves each time an object's
+// bounds are tested (for a SelfQuery, the pairs of nodes and pairs of objects tested). Partitions
+// without a hierarchy (grids, sweep and prune) only count objects, and ones that test nothing only
+// count queries and results. Many nodes per query point at the tree's quality, many queries at how
+// it's being used.
+class QueryStatistics
+{
+public:
+  QueryStatistics();
+  void Clear();
+
+  // Counts a node or leaf. stackDepth is how many entries the traversal stack had including this one.
+  void Visit(bool isLeaf, size_t stackDepth = 0);
+  void Add(const QueryStatistics& rhs);
+
+  size_t mQueries;
+  size_t mNodesVisited;
+  size_t mLeavesVisited;
+  // The deepest stack (or recursion, see QueryDepthScope) of any one query.
+  size_t mMaxStackDepth;
+  size_t mResults;
+  // How deep the recursive query in progress is.
+  size_t mDepth;
+};
+
+//-----------------------------------------------------------------------------QueryDepthScope
+// Counts one level of a recursive query's depth for as long as it's in scope.
+class QueryDepthScope
+{
+public:
+  QueryDepthScope(QueryStatistics& statistics);
+  ~QueryDepthScope();
+
+  QueryStatistics& mStatistics;
+};
+
+//-----------------------------------------------------------------------------PartitionStatistics
+// The statistics of each kind of query run on one type of partition.
+class PartitionStatistics
+{
+public:
+  void Clear();
+
+  QueryStatistics mQueries[QueryStatisticsTypes::Count];
+};
+
 namespace SpatialPartitionTypes
 {
-  enum Types{NSquared, NSquaredSphere, AabbTree, Unknown};
+  enum Types{NSquared, NSquaredSphere, AabbTree, LinearBvh, SweepAndPrune, HashGrid, HierarchicalHashGrid, LooseOctree, WideBvh, QuantizedBvh, FlatBvh, Unknown};
+  static const char* const Names[Unknown] = {"NSquared", "NSquaredSphere", "AabbTree", "LinearBvh", "SweepAndPrune", "HashGrid",
+                                             "HierarchicalHashGrid", "LooseOctree", "WideBvh", "QuantizedBvh", "FlatBvh"};
 }
 
 //-----------------------------------------------------------------------------SpatialPartition
@@ -140,6 +348,18 @@ public:
   // Remove the object represented by the key from this spatial partition.
   virtual void RemoveData(SpatialPartitionKey& key) = 0;
 
+  // Bulk insert count objects into an empty spatial partition. Partitions that can do better than
+  // inserting one at a time (e.g. a top-down tree build) should override this. If keys is not null
+  // it must hold count keys which are filled out the same as InsertData would.
+  virtual void Build(const SpatialPartitionData* data, size_t count, SpatialPartitionKey* keys = nullptr);
+
+  // Batched InsertData/UpdateData/RemoveData over count contiguous keys (and data). Partitions that can
+  // do better than one call and one search per object (e.g. by bulk building or by restructuring once
+  // after the whole batch is applied) should override these. The defaults just call the single versions.
+  virtual void InsertBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count);
+  virtual void UpdateBatch(SpatialPartitionKey* keys, SpatialPartitionData* data, size_t count);
+  virtual void RemoveBatch(SpatialPartitionKey* keys, size_t count);
+
   // Debug draw this spatial partition with a transform. Level of -1 means draw the entire spatial partition.
   // Otherwise the level signifies which level (height) of the tree to draw.
   // The transform should be applied to any shape you draw (for mid-phase debug drawing). You should set the color and
@@ -150,19 +370,59 @@ public:
   // Finds out what objects in the spatial partition are hit by the given ray.
   // Inserts all hits into the cast results (which sorts them by t automatically).
   virtual void CastRay(const Ray& ray, CastResults& results) = 0;
+  // Casts count rays, filling out results[i] for rays[i] exactly as CastRay would. Trees can
+  // override this to traverse with packets of (ideally coherent) rays. The default casts one at a time.
+  virtual void CastRays(const Ray* rays, size_t count, CastResults* results);
+  // Finds only the closest object hit by the ray. With a refiner each object is confirmed as it's
+  // found and the result's time is the refined one. Trees override this to visit the nearer child
+  // first and skip everything entered after the closest hit so far. The default refines CastRay's
+  // (sorted) results until the next one starts after the closest hit. Returns false on a miss.
+  virtual bool CastRayClosest(const Ray& ray, CastResult& result, RayRefiner* refiner = nullptr);
+  // Is any object hit by the ray within [0, maxT] (after refining)? Stops at the first hit found, in
+  // no particular order, and doesn't build any results. Partitions skip everything the ray enters
+  // after maxT. The default checks CastRay's results.
+  virtual bool CastRayAny(const Ray& ray, float maxT, RayRefiner* refiner = nullptr);
+  // Finds every object that the aabb touches while it moves from start to start + displacement. Each
+  // result's time is the time of impact as a fraction of the displacement (0 if they already touch).
+  // Node and object bounds are tested with a ray against their Minkowski sum with the box (see
+  // SweptAabbQuery). The default walks the hierarchy (see GetHierarchyRoot) or, without one, tests
+  // every object in FilloutData.
+  virtual void CastAabb(const Aabb& start, const Vector3& displacement, CastResults& results);
   // Finds out what objects hit the frustum. This test is expected to be a
   // bit loose (as accurate frustum tests can be a bit expensive).
   // Also the CastResult's time should be set to 0.
   virtual void CastFrustum(const Frustum& frustum, CastResults& results) = 0;
+  // Finds the (up to) k objects closest to the point that are at most maxDistance away, measured to
+  // the closest point on their bounds. They are added closest first with the distance as the time.
+  // Trees override this with a best-first traversal. The default checks every object in FilloutData.
+  virtual void QueryNearest(const Vector3& point, size_t k, float maxDistance, CastResults& results);
+  // Finds every object whose bounds touch the aabb/sphere (with a time of 0). Both are a QueryRegion.
+  void QueryAabb(const Aabb& aabb, CastResults& results);
+  void QuerySphere(const Sphere& sphere, CastResults& results);
+  virtual void QueryRegion(const RegionQuery& region, CastResults& results) = 0;
 
   // Returns pairs of all objects that are overlapping in this spatial partition.
   // This represents what physics might do to determine overlapping pairs.
   virtual void SelfQuery(QueryResults& results) = 0;
 
+  // Hierarchy access for walking two partitions at once (see QueryPartitions). Partitions with a
+  // hierarchy bring it up to date, fill out the root and return true. Objects have no children.
+  virtual bool GetHierarchyRoot(HierarchyNode& root) { return false; };
+  virtual void GetHierarchyChildren(const HierarchyNode& node, std::vector<HierarchyNode>& children) const {};
+
   // Debug Interface
   virtual void GetDataFromKey(const SpatialPartitionKey& key, SpatialPartitionData& data) const {};
   // Fill out all contained data (whichever is relevant between sphere and aabb). If this is a tree then it should fill out the data in a pre-order depth first traversal.
   virtual void FilloutData(std::vector<SpatialPartitionQueryData>& results) const {};
+  // Roughly how many bytes the partition uses (0 if it doesn't say). Used to compare midphases.
+  virtual size_t GetMemoryUsage() const { return 0; };
+
+#if SPATIAL_PARTITION_STATISTICS
+  // This type of partition's statistics for the kind of query (see Statistics::mPartitionStatistics).
+  QueryStatistics& GetQueryStatistics(QueryStatisticsTypes::Types queryType) const;
+  // Counts one more query of the kind and returns its statistics.
+  QueryStatistics& BeginQuery(QueryStatisticsTypes::Types queryType) const;
+#endif
 
   // What kind of spatial partition this is. Used for anttweakbar binding.
   SpatialPartitionTypes::Types mType; 